@@ -1,7 +1,7 @@
 QT -= gui
-QT += serialport
+QT += serialport concurrent network
 
-CONFIG += c++11 console
+CONFIG += c++17 console
 CONFIG -= app_bundle
 
 # The following define makes your compiler emit warnings if you use
@@ -15,10 +15,25 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(gps.pri)
+
 SOURCES += \
         main.cpp \
-    tinygps.cpp \
-    serialport.cpp
+    serialport.cpp \
+    bufferpool.cpp \
+    serialiothread.cpp \
+    nmeareplay.cpp \
+    nmeacapture.cpp \
+    trackformat.cpp \
+    geofence.cpp \
+    statsexporter.cpp \
+    receivercommand.cpp \
+    receiverconfigurator.cpp
+
+linux {
+    SOURCES += gpshub.cpp
+    HEADERS += gpshub.h
+}
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -26,5 +41,15 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
-    tinygps.h \
-    serialport.h
+    serialport.h \
+    bufferpool.h \
+    fixcoalescer.h \
+    bytering.h \
+    serialiothread.h \
+    nmeareplay.h \
+    nmeacapture.h \
+    trackformat.h \
+    geofence.h \
+    statsexporter.h \
+    receivercommand.h \
+    receiverconfigurator.h
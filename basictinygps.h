@@ -0,0 +1,2214 @@
+/*
+TinyGPS - a small GPS library for Arduino providing basic NMEA parsing
+Based on work by and "distance_to" and "course_to" courtesy of Maarten Lamers.
+Suggestion to add satellites(), course_to(), and cardinal(), by Matt Monson.
+Precision improvements suggested by Wayne Holder.
+Copyright (C) 2008-2013 Mikal Hart
+All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef BASICTINYGPS_H
+#define BASICTINYGPS_H
+
+#include "gpsglobal.h"
+
+#include <cstddef>
+#include <cstring>
+
+#include "gpsfix.h"
+#include "gpsstats.h"
+#include "gpstime.h"
+#include "latency.h"
+#include "nmeanum.h"
+#include "nmeascan.h"
+#include "seqlock.h"
+
+#define GPS_VERSION            13 // software version of this library
+#define GPS_MPH_PER_KNOT       1.15077945
+#define GPS_MPS_PER_KNOT       0.51444444
+#define GPS_KMPH_PER_KNOT      1.852
+#define GPS_MILES_PER_METER    0.00062137112
+#define GPS_KM_PER_METER       0.001
+#define GPS_MAX_CHANNELS       12 // satellite slots in a GSA sentence
+#define GPS_MAX_SATS_IN_VIEW   16 // GSV slots kept per talker
+#define GPS_TERM_SIZE          15 // longest term kept, including the NUL
+#define GPS_MAX_SENTENCE_LENGTH 82 // NMEA 0183, from '$' to the closing LF
+#define GPS_UBX_MAX_LENGTH     3068 // longest UBX payload framed, NAV-SAT with 255 satellites
+#define GPS_UBX_MAX_SATS       32 // NAV-SAT satellites decoded
+#define GPS_UBX_BUFFER_SIZE    (8 + 12 * GPS_UBX_MAX_SATS) // payload bytes kept, NAV-PVT needs 92
+
+#define GPS_FORMATTER_PACK(a, b, c) (((quint32)(quint8)(a) << 16) | ((quint32)(quint8)(b) << 8) | (quint8)(c))
+#define GPS_FORMATTER(str)          GPS_FORMATTER_PACK((str)[0], (str)[1], (str)[2])
+#define GPS_TALKER(a, b)            (((unsigned)(quint8)(a) << 8) | (quint8)(b))
+#define GPS_UBX_MESSAGE(cls, id)    (((unsigned)(quint8)(cls) << 8) | (quint8)(id))
+
+// one satellite as reported by GSV
+struct GpsSatellite
+{
+    quint8 prn;
+    quint8 elevation;   // degrees
+    quint16 azimuth;    // degrees true
+    quint8 snr;         // dB-Hz, GPS_INVALID_SNR when not tracking
+};
+
+// Acknowledgement of a configuration command, from $PMTK001 or UBX ACK-ACK
+// and ACK-NAK
+struct GpsAck
+{
+    enum { PMTK, UBX };
+    enum { PMTK_INVALID, PMTK_UNSUPPORTED, PMTK_FAILED, PMTK_SUCCEEDED };
+
+    quint8 protocol;    // PMTK or UBX
+    quint8 result;      // PMTK_*, or 1 for ACK-ACK and 0 for ACK-NAK
+    quint16 command;    // PMTK command number, or GPS_UBX_MESSAGE(class, id)
+
+    bool accepted() const { return protocol == UBX ? result == 1 : result == PMTK_SUCCEEDED; }
+};
+
+#ifndef GPS_NO_QT
+#include <QMetaType>
+// for queued acknowledged() connections
+Q_DECLARE_METATYPE(GpsAck)
+#endif
+
+// Fields a BasicTinyGPS parses and stores; anything left out of the mask has
+// no storage, its terms are skipped and its accessors do not compile.
+enum GpsFields : unsigned {
+    GPS_FIELD_POSITION   = 0x001,   // latitude, longitude and their fix age
+    GPS_FIELD_TIME       = 0x002,   // UTC time and its fix age
+    GPS_FIELD_DATE       = 0x004,
+    GPS_FIELD_ALTITUDE   = 0x008,
+    GPS_FIELD_SPEED      = 0x010,
+    GPS_FIELD_COURSE     = 0x020,
+    GPS_FIELD_HDOP       = 0x040,
+    GPS_FIELD_SATELLITES = 0x080,   // satellites used, from GGA
+    GPS_FIELD_GSA        = 0x100,   // fix type, PDOP, VDOP and PRNs used
+    GPS_FIELD_GSV        = 0x200,   // satellites in view per talker
+    GPS_FIELD_ZDA        = 0x400,   // four-digit year and local zone
+    GPS_FIELD_UBX        = 0x800,   // UBX NAV-PVT and NAV-SAT, decoded into the fields above
+    GPS_FIELDS_ALL       = 0xFFF
+};
+
+// Constants and helpers shared by every BasicTinyGPS instantiation
+struct TinyGPSBase
+{
+    enum {
+        GPS_INVALID_AGE = 0xFFFFFFFF,
+        GPS_INVALID_ANGLE = 999999999,
+        GPS_INVALID_E7 = 0x7FFFFFFF,    // latitude and longitude as kept, in 10^-7 degrees up to 1.81e9
+        GPS_INVALID_ALTITUDE = 999999999,
+        GPS_INVALID_DATE = 0,
+        GPS_INVALID_TIME = 0xFFFFFFFF,
+        GPS_INVALID_SPEED = 999999999,
+        GPS_INVALID_FIX_TIME = 0xFFFFFFFF,
+        GPS_INVALID_SATELLITES = 0xFF,
+        GPS_INVALID_HDOP = 0xFFFFFFFF,
+        GPS_INVALID_DOP = 0xFFFFFFFF,
+        GPS_INVALID_SNR = 0xFF,
+        GPS_INVALID_YEAR = 0,
+        GPS_INVALID_ZONE = 0x7FFF
+    };
+
+    // talker IDs (first two characters of the sentence header)
+    enum {
+        GPS_TALKER_GP,  // GPS
+        GPS_TALKER_GL,  // GLONASS
+        GPS_TALKER_GA,  // Galileo
+        GPS_TALKER_GB,  // BeiDou (GB or BD)
+        GPS_TALKER_GQ,  // QZSS
+        GPS_TALKER_GN,  // combined GNSS solution
+        GPS_TALKER_OTHER,
+        GPS_TALKER_COUNT = GPS_TALKER_OTHER
+    };
+
+    // sentence formatters understood by the parser, any talker
+    enum {
+        GPS_SENTENCE_GGA,
+        GPS_SENTENCE_RMC,
+        GPS_SENTENCE_GSA,
+        GPS_SENTENCE_GSV,
+        GPS_SENTENCE_VTG,
+        GPS_SENTENCE_GLL,
+        GPS_SENTENCE_ZDA,
+        GPS_SENTENCE_UBX_PVT,   // UBX NAV-PVT, reported with the GN talker
+        GPS_SENTENCE_UBX_SAT,   // UBX NAV-SAT
+        GPS_SENTENCE_OTHER
+    };
+
+    // UBX messages understood by the parser
+    enum {
+        GPS_UBX_NAV_PVT = GPS_UBX_MESSAGE(0x01, 0x07),
+        GPS_UBX_NAV_SAT = GPS_UBX_MESSAGE(0x01, 0x35)
+    };
+
+    // GSA fix type
+    enum {GPS_FIX_NONE = 1, GPS_FIX_2D = 2, GPS_FIX_3D = 3};
+
+    static constexpr float GPS_INVALID_F_ANGLE = 1000.0f;
+    static constexpr float GPS_INVALID_F_ALTITUDE = 1000000.0f;
+    static constexpr float GPS_INVALID_F_SPEED = -1.0f;
+
+    // receives every published fix, see set_fix_callback()
+    typedef void (*FixCallback)(const GpsFix &fix, void *context);
+    // receives every acknowledgement, see set_ack_callback()
+    typedef void (*AckCallback)(const GpsAck &ack, void *context);
+
+    static int library_version() { return GPS_VERSION; }
+
+    // single pair versions of geodesy::distance_between() and geodesy::course_to()
+    static float distance_between (float lat1, float long1, float lat2, float long2);
+    static float course_to (float lat1, float long1, float lat2, float long2);
+    static const char *cardinal(float course);
+
+protected:
+    static unsigned long millis() { return (unsigned long)(gps_clock_ns() / 1000000); }
+    static bool gpsisdigit(char c) { return c >= '0' && c <= '9'; }
+    static long gpsatol(const char *str)
+    {
+        long ret = 0;
+        while (gpsisdigit(*str))
+            ret = 10 * ret + *str++ - '0';
+        return ret;
+    }
+    // value of a hex digit, either case, or -1
+    static int hex_digit(char a)
+    {
+        if (a >= '0' && a <= '9')
+            return a - '0';
+        else if (a >= 'A' && a <= 'F')
+            return a - 'A' + 10;
+        else if (a >= 'a' && a <= 'f')
+            return a - 'a' + 10;
+        else
+            return -1;
+    }
+};
+
+static_assert(TinyGPSBase::GPS_SENTENCE_OTHER + 1 == GPS_STATS_SENTENCE_TYPES, "update GPS_STATS_SENTENCE_TYPES");
+static_assert(TinyGPSBase::GPS_TALKER_OTHER + 1 == GPS_STATS_TALKERS, "update GPS_STATS_TALKERS");
+
+// Storage of the optional fields: the current value of each and the m_new_*
+// copy being parsed. A disabled group is an empty base and takes no space.
+// Every member has an initializer so that the parser can be built constexpr.
+namespace tinygps_fields {
+
+template<bool> struct Position {};
+template<> struct Position<true> {
+    // 10^-7 degrees; the public API rounds to millionths
+    long m_latitude = TinyGPSBase::GPS_INVALID_E7, m_new_latitude = 0;
+    long m_longitude = TinyGPSBase::GPS_INVALID_E7, m_new_longitude = 0;
+    unsigned long m_last_position_fix = TinyGPSBase::GPS_INVALID_FIX_TIME;
+    unsigned long m_new_position_fix = TinyGPSBase::GPS_INVALID_FIX_TIME;
+};
+
+template<bool> struct Time {};
+template<> struct Time<true> {
+    unsigned long m_time = TinyGPSBase::GPS_INVALID_TIME, m_new_time = 0;
+    unsigned long m_last_time_fix = TinyGPSBase::GPS_INVALID_FIX_TIME;
+    unsigned long m_new_time_fix = TinyGPSBase::GPS_INVALID_FIX_TIME;
+};
+
+template<bool> struct Date {};
+template<> struct Date<true> {
+    unsigned long m_date = TinyGPSBase::GPS_INVALID_DATE, m_new_date = 0;
+    // m_date and ZDA year the epoch day was computed from; recomputed only
+    // when they change. Days and milliseconds since 1970, 0 when unknown.
+    unsigned long m_epoch_date = TinyGPSBase::GPS_INVALID_DATE;
+    int m_epoch_year = 0;
+    qint64 m_epoch_days = 0;
+    qint64 m_epoch_ms = 0;
+    qint64 m_rollover_floor_days = 0;
+};
+
+template<bool> struct Altitude {};
+template<> struct Altitude<true> {
+    // millimeters; altitude() truncates to centimeters
+    long m_altitude = TinyGPSBase::GPS_INVALID_ALTITUDE, m_new_altitude = 0;
+};
+
+template<bool> struct Speed {};
+template<> struct Speed<true> {
+    // 1000ths of a knot; speed() truncates to 100ths
+    unsigned long m_speed = TinyGPSBase::GPS_INVALID_SPEED, m_new_speed = 0;
+};
+
+template<bool> struct Course {};
+template<> struct Course<true> {
+    // 1000ths of a degree; course() truncates to 100ths
+    unsigned long m_course = TinyGPSBase::GPS_INVALID_ANGLE, m_new_course = 0;
+};
+
+template<bool> struct Hdop {};
+template<> struct Hdop<true> {
+    unsigned long m_hdop = TinyGPSBase::GPS_INVALID_HDOP, m_new_hdop = 0;
+};
+
+template<bool> struct Satellites {};
+template<> struct Satellites<true> {
+    unsigned short m_numsats = TinyGPSBase::GPS_INVALID_SATELLITES, m_new_numsats = 0;
+};
+
+template<bool> struct Gsa {};
+template<> struct Gsa<true> {
+    quint8 m_fix_type = 0, m_new_fix_type = 0;
+    unsigned long m_pdop = TinyGPSBase::GPS_INVALID_DOP, m_new_pdop = 0;
+    unsigned long m_vdop = TinyGPSBase::GPS_INVALID_DOP, m_new_vdop = 0;
+    quint8 m_sats_used[GPS_MAX_CHANNELS] = {}, m_new_sats_used[GPS_MAX_CHANNELS] = {};
+    quint8 m_sats_used_count = 0, m_new_sats_used_count = 0;
+};
+
+template<bool> struct Gsv {};
+template<> struct Gsv<true> {
+    GpsSatellite m_sats_in_view[TinyGPSBase::GPS_TALKER_COUNT][GPS_MAX_SATS_IN_VIEW] = {};
+    quint8 m_sats_in_view_count[TinyGPSBase::GPS_TALKER_COUNT] = {};
+    GpsSatellite m_new_gsv_sats[4] = {};
+    quint8 m_new_gsv_message = 0, m_new_sats_in_view = 0;
+};
+
+template<bool> struct Zda {};
+template<> struct Zda<true> {
+    int m_year = TinyGPSBase::GPS_INVALID_YEAR, m_new_year = 0;
+    int m_local_zone = TinyGPSBase::GPS_INVALID_ZONE, m_new_local_zone = 0;
+};
+
+template<bool> struct Ubx {};
+template<> struct Ubx<true> {
+    // payload of the UBX frame being received, up to GPS_UBX_BUFFER_SIZE
+    // bytes; it is the m_new_* copy of the UBX messages
+    quint8 m_ubx_payload[GPS_UBX_BUFFER_SIZE] = {};
+};
+
+} // namespace tinygps_fields
+
+// NMEA parser keeping only the fields in the Fields mask (GPS_FIELD_*).
+// TinyGPS is the instantiation with every field; a consumer that needs only
+// position and time can use BasicTinyGPS<GPS_FIELD_POSITION | GPS_FIELD_TIME>
+// and carry a fraction of the state.
+//
+// A parser is a plain value: it never allocates, can be constructed at compile
+// time and is trivially copyable, so thousands of them fit in one contiguous
+// array. The channel, callback and latency pointers are copied as they are.
+//
+// u-blox UBX frames may be interleaved with the sentences: outside a sentence
+// the sync bytes 0xB5 0x62 start a frame, which is checked (Fletcher
+// checksum) and skipped as a whole. With GPS_FIELD_UBX, NAV-PVT and NAV-SAT
+// fill the same fields as RMC+GGA+GSA and GSV and are published like them;
+// other frames, and all frames without it, only count as passed_checksum.
+template<unsigned Fields>
+class BasicTinyGPS
+        : public TinyGPSBase
+        , private tinygps_fields::Position<(Fields & GPS_FIELD_POSITION) != 0>
+        , private tinygps_fields::Time<(Fields & GPS_FIELD_TIME) != 0>
+        , private tinygps_fields::Date<(Fields & GPS_FIELD_DATE) != 0>
+        , private tinygps_fields::Altitude<(Fields & GPS_FIELD_ALTITUDE) != 0>
+        , private tinygps_fields::Speed<(Fields & GPS_FIELD_SPEED) != 0>
+        , private tinygps_fields::Course<(Fields & GPS_FIELD_COURSE) != 0>
+        , private tinygps_fields::Hdop<(Fields & GPS_FIELD_HDOP) != 0>
+        , private tinygps_fields::Satellites<(Fields & GPS_FIELD_SATELLITES) != 0>
+        , private tinygps_fields::Gsa<(Fields & GPS_FIELD_GSA) != 0>
+        , private tinygps_fields::Gsv<(Fields & GPS_FIELD_GSV) != 0>
+        , private tinygps_fields::Zda<(Fields & GPS_FIELD_ZDA) != 0>
+        , private tinygps_fields::Ubx<(Fields & GPS_FIELD_UBX) != 0>
+{
+public:
+    static constexpr bool has(unsigned fields) { return (Fields & fields) == fields; }
+
+    constexpr BasicTinyGPS() = default;
+
+    bool encode(char c); // process one character received from GPS
+    BasicTinyGPS &operator << (char c) {encode(c); return *this;}
+
+    // process a block of characters, same results as feeding them one at a time;
+    // returns the number of sentences that passed the checksum test
+    int encode(const char *buf, size_t len);
+    // any contiguous container of char with data() and size(), e.g. QByteArray
+    template<typename Bytes>
+    auto encode(const Bytes &data) -> decltype(data.data(), data.size(), int())
+    { return encode(data.data(), size_t(data.size())); }
+    template<typename Bytes>
+    auto operator << (const Bytes &data) -> decltype(data.data(), data.size(), *this)
+    { encode(data); return *this; }
+
+    // lat/long in MILLIONTHs of a degree and age of fix in milliseconds
+    // (note: versions 12 and earlier gave lat/long in 100,000ths of a degree.
+    void get_position(long *latitude, long *longitude, unsigned long *fix_age = nullptr);
+
+    // date as ddmmyy, time as hhmmsscc, and age in milliseconds
+    void get_datetime(unsigned long *date, unsigned long *time, unsigned long *age = nullptr);
+
+    // UTC milliseconds since 1970 of the last date and time, 0 until both
+    // are known; kept up to date while parsing, see gpstime.h for the
+    // century and GPS week rollover policy
+    inline qint64 epoch_ms() { static_assert(has(GPS_FIELD_DATE | GPS_FIELD_TIME), "date and time not parsed"); return this->m_epoch_ms; }
+    // dates before floor_ms are taken as reported across a GPS week
+    // rollover and moved forward 1024 weeks; 0, the default, accepts any date
+    void set_rollover_floor(qint64 floor_ms);
+
+    // signed altitude in centimeters (from GPGGA sentence)
+    inline long altitude() { static_assert(has(GPS_FIELD_ALTITUDE), "altitude not parsed"); return from_milli(this->m_altitude, GPS_INVALID_ALTITUDE); }
+
+    // course in last full GPRMC sentence in 100th of a degree
+    inline unsigned long course() { static_assert(has(GPS_FIELD_COURSE), "course not parsed"); return from_milli(this->m_course, GPS_INVALID_ANGLE); }
+
+    // speed in last full GPRMC sentence in 100ths of a knot
+    inline unsigned long speed() { static_assert(has(GPS_FIELD_SPEED), "speed not parsed"); return from_milli(this->m_speed, GPS_INVALID_SPEED); }
+
+    // satellites used in last full GPGGA sentence
+    inline unsigned short satellites() { static_assert(has(GPS_FIELD_SATELLITES), "satellites not parsed"); return this->m_numsats; }
+
+    // horizontal dilution of precision in 100ths
+    inline unsigned long hdop() { static_assert(has(GPS_FIELD_HDOP), "hdop not parsed"); return this->m_hdop; }
+
+    // talker and formatter of the last sentence that passed the checksum test
+    inline quint8 talker() { return m_talker; }
+    inline quint8 sentence_type() { return m_last_sentence_type; }
+
+    // fix type (GPS_FIX_*), dilutions of precision in 100ths and PRNs used
+    // in the last full GSA sentence
+    inline quint8 fix_type() { static_assert(has(GPS_FIELD_GSA), "GSA not parsed"); return this->m_fix_type; }
+    inline unsigned long pdop() { static_assert(has(GPS_FIELD_GSA), "GSA not parsed"); return this->m_pdop; }
+    inline unsigned long vdop() { static_assert(has(GPS_FIELD_GSA), "GSA not parsed"); return this->m_vdop; }
+    const quint8 *satellites_used(quint8 *count);
+
+    // satellites in view for one talker (GPS_TALKER_*), from GSV
+    quint8 satellites_in_view(quint8 talker);
+    const GpsSatellite *satellite_view(quint8 talker, quint8 *count);
+
+    // four-digit year and local zone offset in minutes from the last ZDA sentence
+    inline int zda_year() { static_assert(has(GPS_FIELD_ZDA), "ZDA not parsed"); return this->m_year; }
+    inline int local_zone() { static_assert(has(GPS_FIELD_ZDA), "ZDA not parsed"); return this->m_local_zone; }
+
+    // consistent copy of all the fields above; call from the parsing thread,
+    // other threads read the channel set with set_fix_channel(). Fields that
+    // are not parsed are reported invalid.
+    void get_fix(GpsFix *fix);
+
+    // every sentence that passes the checksum test is published to channel
+    void set_fix_channel(SeqLock<GpsFix> *channel) { m_fix_channel = channel; }
+
+    // ...and handed to callback, on the parsing thread, as soon as it is
+    // validated; context is passed back as is. Keep it short, the next
+    // character waits for it.
+    void set_fix_callback(FixCallback callback, void *context = nullptr) { m_fix_callback = callback; m_fix_context = context; }
+
+    // acknowledgements of configuration commands that pass the checksum
+    // test are handed to callback, on the parsing thread; they are not
+    // fixes and publish nothing
+    void set_ack_callback(AckCallback callback, void *context = nullptr) { m_ack_callback = callback; m_ack_context = context; }
+
+    // Framing: a sentence is dropped, and everything up to the next '$'
+    // skipped, as soon as it holds a control or non-ASCII byte, grows past
+    // the maximum length, has a term longer than GPS_TERM_SIZE - 1 or a '*'
+    // not followed by exactly two hex digits. Each reason has a counter in
+    // GpsStats.
+    // longest sentence accepted, '$' to LF; 0 lifts the limit
+    void set_max_sentence_length(unsigned length)
+    {
+        m_sentence_limit = length == 0 || length > 0xFFFF ? 0xFFFF : length < 3 ? 1 : quint16(length - 2);
+    }
+    // take sentences that end without '*hh' as valid; they are counted as
+    // missing_checksum and, like checked ones, as passed_checksum
+    void set_accept_missing_checksum(bool accept) { m_accept_missing_checksum = accept; }
+
+    // record read->parse and parse->publish latencies into latency
+    void set_latency(GpsLatency *latency) { m_latency = latency; }
+    // gps_clock_ns() at which the characters about to be encoded were read
+    void mark_received(quint64 ns) { m_received_ns = ns; }
+
+    void f_get_position(float *latitude, float *longitude, unsigned long *fix_age = nullptr);
+    // full precision of the parsed position (10^-7 degrees, about 1 cm); see
+    // geodesy::GeoPoint for WGS-84 distances
+    void d_get_position(double *latitude, double *longitude, unsigned long *fix_age = nullptr);
+    void crack_datetime(int *year, quint8 *month, quint8 *day,
+                        quint8 *hour, quint8 *minute, quint8 *second, quint8 *hundredths = nullptr, unsigned long *fix_age = nullptr);
+    // full precision of the parsed terms, up to 1000ths
+    float f_altitude();
+    float f_course();
+    float f_speed_knots();
+    float f_speed_mph();
+    float f_speed_mps();
+    float f_speed_kmph();
+
+#ifndef GPS_NO_STATS
+    // the counters wrap at the width of the arguments; prefer stats(GpsStats *)
+    void stats(unsigned long *chars, unsigned short *good_sentences, unsigned short *failed_cs);
+    // consistent per counter, not across counters; safe from any thread
+    void stats(GpsStats *stats) const;
+#endif
+
+private:
+    typedef void (BasicTinyGPS::*TermHandler)();
+    typedef void (BasicTinyGPS::*CommitHandler)();
+
+    // one row of the sentence registry, see the term tables below
+    struct SentenceParser
+    {
+        quint32 formatter;      // GPS_FORMATTER("RMC") etc.
+        quint8 sentence_type;
+        bool valid_by_default;  // no status term, data is good unless a term says otherwise
+        const TermHandler *terms;
+        quint8 term_count;
+        CommitHandler commit;
+    };
+
+    // handler if any of the field groups it stores is parsed, otherwise none
+    static constexpr TermHandler term(unsigned fields, TermHandler handler) { return Fields & fields ? handler : nullptr; }
+
+    static const SentenceParser s_parsers[];
+    static const TermHandler s_rmc_terms[10], s_gga_terms[10], s_gsa_terms[18],
+    s_gsv_terms[20], s_vtg_terms[10], s_gll_terms[7], s_zda_terms[7];
+
+    // UBX framing, see encode_ubx()
+    enum UbxState {
+        UBX_IDLE,
+        UBX_SYNC_2,
+        UBX_CLASS,
+        UBX_ID,
+        UBX_LENGTH_1,
+        UBX_LENGTH_2,
+        UBX_PAYLOAD,
+        UBX_CHECKSUM_A,
+        UBX_CHECKSUM_B
+    };
+    static const quint16 UBX_NAV_PVT_LENGTH = 92;
+
+    quint8 m_talker = GPS_TALKER_OTHER, m_new_talker = GPS_TALKER_OTHER;
+    quint8 m_last_sentence_type = GPS_SENTENCE_OTHER;
+
+    // parsing state variables
+    quint8 m_parity = 0;
+    bool m_is_checksum_term = false;
+    char m_term[GPS_TERM_SIZE + 8] = {}; // padded for nmeanum's 8-byte loads
+    quint8 m_sentence_type = GPS_SENTENCE_OTHER;
+    quint8 m_term_number = 0;
+    quint8 m_term_offset = 0;
+    bool m_gps_data_good = false;
+
+    SeqLock<GpsFix> *m_fix_channel = nullptr;
+    FixCallback m_fix_callback = nullptr;
+    void *m_fix_context = nullptr;
+    AckCallback m_ack_callback = nullptr;
+    void *m_ack_context = nullptr;
+    GpsLatency *m_latency = nullptr;
+    quint64 m_received_ns = 0;
+    quint64 m_sentence_start_ns = 0;
+
+    bool m_in_sentence = false;     // false while skipping to the next '$'
+    quint16 m_sentence_length = 0;  // from the '$', line end excluded
+    quint16 m_sentence_limit = GPS_MAX_SENTENCE_LENGTH - 2;
+    bool m_accept_missing_checksum = false;
+
+    quint8 m_ubx_state = UBX_IDLE;
+    quint8 m_ubx_ck_a = 0, m_ubx_ck_b = 0;
+    quint16 m_ubx_message = 0;      // GPS_UBX_MESSAGE(class, id)
+    quint16 m_ubx_length = 0, m_ubx_offset = 0;
+    quint8 m_ubx_prefix[2] = {};    // first payload bytes, the acknowledged message of ACK-*
+
+    // $PMTK001 being parsed, with m_ack_callback set
+    bool m_parsing_ack = false;
+    quint8 m_ack_result = 0;
+    quint16 m_ack_command = 0;
+
+#ifndef GPS_NO_STATS
+    // statistics
+    GpsCounter m_encoded_characters = {};
+    GpsCounter m_good_sentences = {};
+    GpsCounter m_failed_checksum = {};
+    GpsCounter m_passed_checksum = {};
+    GpsCounter m_term_overflows = {};
+    GpsCounter m_framing_errors = {};
+    GpsCounter m_missing_checksums = {};
+    GpsCounter m_malformed_checksums = {};
+    GpsCounter m_oversized_sentences = {};
+    GpsCounter m_illegal_characters = {};
+    GpsCounter m_dropped_bytes = {};
+    GpsCounter m_sentence_counts[GPS_STATS_SENTENCE_TYPES] = {};
+    GpsCounter m_talker_counts[GPS_STATS_TALKERS] = {};
+    GpsCounter m_sentence_rate_milli = {};  // good sentences per 1000 s, last window
+    unsigned long m_rate_window_start = 0;  // millis(), 0 before the first good sentence
+    unsigned long m_rate_window_count = 0;
+#endif
+
+    // internal utilities
+    void publish();
+    void update_epoch();
+#ifndef GPS_NO_STATS
+    void count_rate();
+#endif
+    void encode_run(const char *buf, size_t len);
+    bool parse_decimal(int scale, qint64 *value);
+    long parse_degrees();
+    static long from_milli(long value, long invalid) { return value == invalid ? invalid : value / 10; }
+    static long e7_to_micro(long value)
+    {
+        if (value == GPS_INVALID_E7)
+            return GPS_INVALID_ANGLE;
+        return value < 0 ? -((5 - value) / 10) : (value + 5) / 10;
+    }
+    // why a sentence was dropped
+    enum Rejection {
+        REJECT_ILLEGAL_CHARACTER,
+        REJECT_OVERSIZED,
+        REJECT_TERM_OVERFLOW,
+        REJECT_MALFORMED_CHECKSUM
+    };
+    void begin_sentence();
+    bool end_sentence();
+    void reject(Rejection reason, size_t dropped);
+    bool sentence_accepted();
+    bool sentence_complete();
+    bool encode_ubx(char c);
+    void encode_ubx_run(const char *buf, size_t len);
+    bool ubx_frame_complete();
+    void ubx_nav_pvt();
+    void ubx_nav_sat();
+    static quint16 ubx_u2(const quint8 *p) { return quint16(p[0] | p[1] << 8); }
+    static quint32 ubx_u4(const quint8 *p) { return quint32(p[0]) | quint32(p[1]) << 8 | quint32(p[2]) << 16 | quint32(p[3]) << 24; }
+    void next_term();
+    void term_complete();
+    void sentence_header();
+
+    // term handlers, indexed by term number in the s_*_terms tables
+    void term_time();
+    void term_status();
+    void term_latitude();
+    void term_north_south();
+    void term_longitude();
+    void term_east_west();
+    void term_speed();
+    void term_course();
+    void term_date();
+    void term_fix_quality();
+    void term_satellites();
+    void term_hdop();
+    void term_altitude();
+    void term_gsa_fix_type();
+    void term_gsa_prn();
+    void term_pdop();
+    void term_vdop();
+    void term_gsv_message();
+    void term_gsv_sats_in_view();
+    void term_gsv_satellite();
+    void term_vtg_mode();
+    void term_zda_day();
+    void term_zda_month();
+    void term_zda_year();
+    void term_zda_zone_hours();
+    void term_zda_zone_minutes();
+
+    // copy the m_new_* fields of a validated sentence
+    void commit_rmc();
+    void commit_gga();
+    void commit_gsa();
+    void commit_gsv();
+    void commit_vtg();
+    void commit_gll();
+    void commit_zda();
+    void commit_ubx_pvt();
+    void commit_ubx_sat();
+};
+
+//
+// public methods
+//
+
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::encode(char c)
+{
+#ifndef GPS_NO_STATS
+    m_encoded_characters.add();
+#endif
+    if (m_ubx_state != UBX_IDLE)
+        return encode_ubx(c);
+
+    if (c == '$') // sentence begin, also in the middle of another
+    {
+#ifndef GPS_NO_STATS
+        if (m_in_sentence)
+            m_framing_errors.add(); // previous sentence cut short
+#endif
+        begin_sentence();
+        return false;
+    }
+
+    if (quint8(c) == 0xB5) // UBX sync, also in the middle of a sentence
+    {
+#ifndef GPS_NO_STATS
+        if (m_in_sentence)
+            m_framing_errors.add();
+#endif
+        m_in_sentence = false;
+        m_ubx_state = UBX_SYNC_2;
+        m_sentence_start_ns = gps_clock_ns();
+        return false;
+    }
+
+    if (!m_in_sentence)
+    {
+#ifndef GPS_NO_STATS
+        if (c != '\r' && c != '\n')
+            m_dropped_bytes.add();
+#endif
+        return false;
+    }
+
+    if (c == '\r' || c == '\n')
+        return end_sentence();
+
+    if (quint8(c) < 0x20 || quint8(c) > 0x7E)
+    {
+        reject(REJECT_ILLEGAL_CHARACTER, 1);
+        return false;
+    }
+    if (m_sentence_length >= m_sentence_limit)
+    {
+        reject(REJECT_OVERSIZED, 1);
+        return false;
+    }
+    ++m_sentence_length;
+
+    switch (c)
+    {
+    case ',': // term terminators
+        if (m_is_checksum_term)
+        {
+            reject(REJECT_MALFORMED_CHECKSUM, 1);
+            return false;
+        }
+        m_parity ^= c;
+        next_term();
+        return false;
+
+    case '*':
+        if (m_is_checksum_term)
+        {
+            reject(REJECT_MALFORMED_CHECKSUM, 1);
+            return false;
+        }
+        next_term();
+        m_is_checksum_term = true;
+        return false;
+    }
+
+    // ordinary characters
+    if (m_is_checksum_term)
+    {
+        if (m_term_offset >= 2 || hex_digit(c) < 0)
+        {
+            reject(REJECT_MALFORMED_CHECKSUM, 1);
+            return false;
+        }
+        m_term[m_term_offset++] = c;
+        return false;
+    }
+    if (m_term_offset >= GPS_TERM_SIZE - 1)
+    {
+        reject(REJECT_TERM_OVERFLOW, 1);
+        return false;
+    }
+    m_term[m_term_offset++] = c;
+    m_parity ^= c;
+    return false;
+}
+
+template<unsigned Fields>
+int BasicTinyGPS<Fields>::encode(const char *buf, size_t len)
+{
+    int valid_sentences = 0;
+    const char *end = buf + len;
+
+    while (buf < end)
+    {
+        if (m_ubx_state == UBX_PAYLOAD)
+        {
+            size_t n = size_t(m_ubx_length - m_ubx_offset);
+            n = n < size_t(end - buf) ? n : size_t(end - buf);
+#ifndef GPS_NO_STATS
+            m_encoded_characters.add(n);
+#endif
+            encode_ubx_run(buf, n);
+            buf += n;
+            continue;
+        }
+        if (m_ubx_state != UBX_IDLE)
+        {
+            if (encode(*buf++))
+                ++valid_sentences;
+            continue;
+        }
+
+        if (!m_in_sentence)
+        {
+            // only the next '$' or UBX sync matters
+            const char *start = nmeascan::find_frame_start(buf, end);
+#ifndef GPS_NO_STATS
+            m_encoded_characters.add(size_t(start - buf));
+            m_dropped_bytes.add(size_t(start - buf) - nmeascan::count_line_ends(buf, start));
+#endif
+            if (start == end)
+                break;
+            buf = start;
+        }
+
+        // a sentence, or its '$' or sync byte
+        const char *special = nmeascan::find_special(buf, end);
+        if (special != buf)
+            encode_run(buf, size_t(special - buf));
+        if (special == end)
+            break;
+        if (encode(*special))
+            ++valid_sentences;
+        buf = special + 1;
+    }
+
+    return valid_sentences;
+}
+
+#ifndef GPS_NO_STATS
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::stats(unsigned long *chars, unsigned short *sentences, unsigned short *failed_cs)
+{
+    if (chars) *chars = (unsigned long)m_encoded_characters.load();
+    if (sentences) *sentences = (unsigned short)m_good_sentences.load();
+    if (failed_cs) *failed_cs = (unsigned short)m_failed_checksum.load();
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::stats(GpsStats *stats) const
+{
+    stats->chars = m_encoded_characters.load();
+    stats->passed_checksum = m_passed_checksum.load();
+    stats->good_sentences = m_good_sentences.load();
+    stats->failed_checksum = m_failed_checksum.load();
+    stats->term_overflows = m_term_overflows.load();
+    stats->framing_errors = m_framing_errors.load();
+    stats->missing_checksum = m_missing_checksums.load();
+    stats->malformed_checksum = m_malformed_checksums.load();
+    stats->oversized_sentences = m_oversized_sentences.load();
+    stats->illegal_characters = m_illegal_characters.load();
+    stats->dropped_bytes = m_dropped_bytes.load();
+    for (int i = 0; i < GPS_STATS_SENTENCE_TYPES; ++i)
+        stats->sentences[i] = m_sentence_counts[i].load();
+    for (int i = 0; i < GPS_STATS_TALKERS; ++i)
+        stats->talkers[i] = m_talker_counts[i].load();
+    stats->sentences_per_second = m_sentence_rate_milli.load() / 1000.0;
+}
+#endif
+
+//
+// internal utilities
+//
+
+// Equivalent to calling encode() for each of the len ordinary characters in
+// buf (printable, not a delimiter), inside a sentence
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::encode_run(const char *buf, size_t len)
+{
+#ifndef GPS_NO_STATS
+    m_encoded_characters.add(len);
+#endif
+    if (m_is_checksum_term)
+    {
+        // two characters at most, checked one by one
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (m_sentence_length >= m_sentence_limit)
+            {
+                reject(REJECT_OVERSIZED, len - i);
+                return;
+            }
+            ++m_sentence_length;
+            if (m_term_offset >= 2 || hex_digit(buf[i]) < 0)
+            {
+                reject(REJECT_MALFORMED_CHECKSUM, len - i);
+                return;
+            }
+            m_term[m_term_offset++] = buf[i];
+        }
+        return;
+    }
+
+    // the first character past either limit drops the sentence, the length
+    // being checked first
+    const size_t length_room = m_sentence_length < m_sentence_limit ? size_t(m_sentence_limit - m_sentence_length) : 0;
+    const size_t term_room = size_t(GPS_TERM_SIZE - 1 - m_term_offset);
+    size_t n = len < length_room ? len : length_room;
+    n = n < term_room ? n : term_room;
+    memcpy(m_term + m_term_offset, buf, n);
+    m_term_offset += quint8(n);
+    m_sentence_length += quint16(n);
+    m_parity ^= nmeascan::xor_bytes(buf, n);
+    if (n < len)
+        reject(n == length_room ? REJECT_OVERSIZED : REJECT_TERM_OVERFLOW, len - n);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::begin_sentence()
+{
+    m_in_sentence = true;
+    m_sentence_length = 1;
+    m_term_number = m_term_offset = 0;
+    m_parity = 0;
+    m_sentence_type = GPS_SENTENCE_OTHER;
+    m_is_checksum_term = false;
+    m_gps_data_good = false;
+    m_parsing_ack = false;
+    m_sentence_start_ns = gps_clock_ns();
+}
+
+// CR or LF inside a sentence; true if it was valid
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::end_sentence()
+{
+    m_in_sentence = false;
+
+    if (!m_is_checksum_term)
+    {
+        // line ended before '*hh'
+        next_term();
+#ifndef GPS_NO_STATS
+        m_missing_checksums.add();
+#endif
+        return m_accept_missing_checksum && sentence_accepted();
+    }
+
+    if (m_term_offset != 2)
+    {
+#ifndef GPS_NO_STATS
+        m_malformed_checksums.add();
+#endif
+        return false;
+    }
+
+    quint8 checksum = quint8(16 * hex_digit(m_term[0]) + hex_digit(m_term[1]));
+    if (checksum != m_parity)
+    {
+#ifndef GPS_NO_STATS
+        m_failed_checksum.add();
+#endif
+        return false;
+    }
+
+    return sentence_accepted();
+}
+
+// A sentence that passed its checksum, or has none and is accepted anyway:
+// counts it and hands an acknowledgement to its callback
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::sentence_accepted()
+{
+#ifndef GPS_NO_STATS
+    m_passed_checksum.add();
+    m_sentence_counts[m_sentence_type].add();
+    m_talker_counts[m_new_talker].add();
+#endif
+    if (m_parsing_ack)
+        m_ack_callback(GpsAck{GpsAck::PMTK, m_ack_result, m_ack_command}, m_ack_context);
+    return sentence_complete();
+}
+
+// Drops the sentence being parsed; dropped characters, the offending one
+// included, count as skipped
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::reject(Rejection reason, size_t dropped)
+{
+    m_in_sentence = false;
+#ifndef GPS_NO_STATS
+    switch (reason)
+    {
+    case REJECT_ILLEGAL_CHARACTER: m_illegal_characters.add(); break;
+    case REJECT_OVERSIZED: m_oversized_sentences.add(); break;
+    case REJECT_TERM_OVERFLOW: m_term_overflows.add(); break;
+    case REJECT_MALFORMED_CHECKSUM: m_malformed_checksums.add(); break;
+    }
+    m_dropped_bytes.add(dropped);
+#else
+    (void)reason;
+    (void)dropped;
+#endif
+}
+
+// Commits and publishes a sentence whose framing and checksum are good
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::sentence_complete()
+{
+    if (!m_gps_data_good || m_sentence_type == GPS_SENTENCE_OTHER)
+        return false;
+
+#ifndef GPS_NO_STATS
+    m_good_sentences.add();
+    count_rate();
+#endif
+    if constexpr (has(GPS_FIELD_TIME))
+        this->m_last_time_fix = this->m_new_time_fix;
+    if constexpr (has(GPS_FIELD_POSITION))
+        this->m_last_position_fix = this->m_new_position_fix;
+    m_talker = m_new_talker;
+    m_last_sentence_type = m_sentence_type;
+
+    (this->*s_parsers[m_sentence_type].commit)();
+    update_epoch();
+    publish();
+    return true;
+}
+
+// One byte of a UBX frame; the sync byte 0xB5 has been seen. True if the
+// frame completed a valid fix.
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::encode_ubx(char c)
+{
+    const quint8 b = quint8(c);
+    switch (m_ubx_state)
+    {
+    case UBX_SYNC_2:
+        if (b != 0x62)
+        {
+            // not a frame after all: 0xB5 is dropped and c taken as if
+            // outside a sentence
+#ifndef GPS_NO_STATS
+            m_dropped_bytes.add(c == '$' || b == 0xB5 || c == '\r' || c == '\n' ? 1 : 2);
+#endif
+            if (b == 0xB5)
+                return false;
+            m_ubx_state = UBX_IDLE;
+            if (c == '$')
+                begin_sentence();
+            return false;
+        }
+        m_ubx_state = UBX_CLASS;
+        m_ubx_ck_a = m_ubx_ck_b = 0;
+        return false;
+
+    case UBX_CLASS:
+        m_ubx_message = quint16(b << 8);
+        m_ubx_state = UBX_ID;
+        break;
+
+    case UBX_ID:
+        m_ubx_message |= b;
+        m_ubx_state = UBX_LENGTH_1;
+        break;
+
+    case UBX_LENGTH_1:
+        m_ubx_length = b;
+        m_ubx_state = UBX_LENGTH_2;
+        break;
+
+    case UBX_LENGTH_2:
+        m_ubx_length |= quint16(b << 8);
+        if (m_ubx_length > GPS_UBX_MAX_LENGTH)
+        {
+            // most likely 0xB5 0x62 in line noise; do not swallow what follows
+            m_ubx_state = UBX_IDLE;
+#ifndef GPS_NO_STATS
+            m_dropped_bytes.add(6);
+#endif
+            return false;
+        }
+        m_ubx_offset = 0;
+        m_ubx_state = m_ubx_length ? UBX_PAYLOAD : UBX_CHECKSUM_A;
+        break;
+
+    case UBX_PAYLOAD:
+        encode_ubx_run(&c, 1);
+        return false;
+
+    case UBX_CHECKSUM_A:
+        m_ubx_ck_a ^= b; // 0 if it matches
+        m_ubx_state = UBX_CHECKSUM_B;
+        return false;
+
+    case UBX_CHECKSUM_B:
+        m_ubx_state = UBX_IDLE;
+        if (m_ubx_ck_a != 0 || m_ubx_ck_b != b)
+        {
+#ifndef GPS_NO_STATS
+            m_failed_checksum.add();
+#endif
+            return false;
+        }
+        return ubx_frame_complete();
+    }
+
+    // header bytes are checksummed
+    m_ubx_ck_a += b;
+    m_ubx_ck_b += m_ubx_ck_a;
+    return false;
+}
+
+// len payload bytes of the frame being received, no more than it has left
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::encode_ubx_run(const char *buf, size_t len)
+{
+    if constexpr (has(GPS_FIELD_UBX))
+    {
+        if (m_ubx_offset < GPS_UBX_BUFFER_SIZE)
+        {
+            size_t kept = GPS_UBX_BUFFER_SIZE - m_ubx_offset;
+            memcpy(this->m_ubx_payload + m_ubx_offset, buf, len < kept ? len : kept);
+        }
+    }
+    for (size_t i = 0; m_ubx_offset + i < 2 && i < len; ++i)
+        m_ubx_prefix[m_ubx_offset + i] = quint8(buf[i]);
+    nmeascan::fletcher8(buf, len, &m_ubx_ck_a, &m_ubx_ck_b);
+    m_ubx_offset += quint16(len);
+    if (m_ubx_offset == m_ubx_length)
+        m_ubx_state = UBX_CHECKSUM_A;
+}
+
+// A UBX frame passed its checksum: decodes the messages the parser knows
+// and commits them like a sentence
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::ubx_frame_complete()
+{
+    m_sentence_type = GPS_SENTENCE_OTHER;
+    m_gps_data_good = false;
+    if constexpr (has(GPS_FIELD_UBX))
+    {
+        switch (m_ubx_message)
+        {
+        case GPS_UBX_NAV_PVT:
+            if (m_ubx_length >= UBX_NAV_PVT_LENGTH)
+                ubx_nav_pvt();
+            break;
+        case GPS_UBX_NAV_SAT:
+            if (m_ubx_length >= 8 && m_ubx_length == 8 + 12 * this->m_ubx_payload[5])
+                ubx_nav_sat();
+            break;
+        }
+    }
+
+#ifndef GPS_NO_STATS
+    m_passed_checksum.add();
+    m_sentence_counts[m_sentence_type].add();
+#endif
+    // ACK-ACK (0x05 0x01) and ACK-NAK (0x05 0x00) carry the class and id
+    // of the configuration message
+    if (m_ack_callback && (m_ubx_message >> 8) == 0x05 && (m_ubx_message & 0xFF) <= 1 && m_ubx_length == 2)
+    {
+        const GpsAck ack = {GpsAck::UBX, quint8(m_ubx_message & 0xFF), quint16(GPS_UBX_MESSAGE(m_ubx_prefix[0], m_ubx_prefix[1]))};
+        m_ack_callback(ack, m_ack_context);
+    }
+    return sentence_complete();
+}
+
+// Hands the data term just ended to its handler and starts the next one
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::next_term()
+{
+    m_term[m_term_offset] = 0;
+    term_complete();
+    if (m_term_number < 0xFF)
+        ++m_term_number;
+    m_term_offset = 0;
+}
+
+// m_term as a fixed-point number with scale decimals (2 = 100ths), truncated.
+// False when the term is not a number or its magnitude reaches the
+// GPS_INVALID_* range, so callers store the invalid value instead.
+template<unsigned Fields>
+bool BasicTinyGPS<Fields>::parse_decimal(int scale, qint64 *value)
+{
+    nmeanum::Fixed number;
+    if (!nmeanum::parse(m_term, &number) || !nmeanum::rescale(number, scale, value))
+        return false;
+    const qint64 limit = GPS_INVALID_ANGLE;
+    return *value > -limit && *value < limit;
+}
+
+// Parse a string in the form ddmm.mmmmmmm... into 10^-7 degrees
+template<unsigned Fields>
+long BasicTinyGPS<Fields>::parse_degrees()
+{
+    nmeanum::Fixed number;
+    qint64 degrees;
+    if (!nmeanum::parse(m_term, &number) || !nmeanum::degrees_e7(number, &degrees))
+        return GPS_INVALID_E7;
+    return long(degrees);
+}
+
+//
+// sentence registry
+//
+// Each supported formatter has one row in s_parsers and a term table that maps
+// the term number to the handler storing it. The talker ID is kept apart, so
+// GPRMC, GNRMC and GLRMC all share the RMC row. Supporting another sentence is
+// a matter of adding a row, its term table and a commit handler. Terms of
+// fields left out of the instantiation have no handler.
+//
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_rmc_terms[10] = {
+    nullptr,
+    term(GPS_FIELD_TIME, &BasicTinyGPS::term_time),                 // 1 UTC time
+    &BasicTinyGPS::term_status,                                     // 2 A = valid, V = warning
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_latitude),         // 3
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_north_south),      // 4
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_longitude),        // 5
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_east_west),        // 6
+    term(GPS_FIELD_SPEED, &BasicTinyGPS::term_speed),               // 7 speed over ground, knots
+    term(GPS_FIELD_COURSE, &BasicTinyGPS::term_course),             // 8 course over ground, degrees true
+    term(GPS_FIELD_DATE, &BasicTinyGPS::term_date)                  // 9 ddmmyy
+};
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_gga_terms[10] = {
+    nullptr,
+    term(GPS_FIELD_TIME, &BasicTinyGPS::term_time),                 // 1 UTC time
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_latitude),         // 2
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_north_south),      // 3
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_longitude),        // 4
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_east_west),        // 5
+    &BasicTinyGPS::term_fix_quality,                                // 6 0 = invalid
+    term(GPS_FIELD_SATELLITES, &BasicTinyGPS::term_satellites),     // 7 satellites used
+    term(GPS_FIELD_HDOP, &BasicTinyGPS::term_hdop),                 // 8
+    term(GPS_FIELD_ALTITUDE, &BasicTinyGPS::term_altitude)          // 9 meters above mean sea level
+};
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_gsa_terms[18] = {
+    nullptr,
+    nullptr,                                                        // 1 M = manual, A = automatic 2D/3D
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_fix_type),          // 2 1 = none, 2 = 2D, 3 = 3D
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),               // 3..14 PRNs of satellites used
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_gsa_prn),
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_pdop),                  // 15
+    term(GPS_FIELD_HDOP, &BasicTinyGPS::term_hdop),                 // 16
+    term(GPS_FIELD_GSA, &BasicTinyGPS::term_vdop)                   // 17
+};
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_gsv_terms[20] = {
+    nullptr,
+    nullptr,                                                        // 1 total number of messages
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_message),           // 2 message number
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_sats_in_view),      // 3 satellites in view
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),         // 4..19 PRN, elevation, azimuth, SNR x 4
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite),
+    term(GPS_FIELD_GSV, &BasicTinyGPS::term_gsv_satellite)
+};
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_vtg_terms[10] = {
+    nullptr,
+    term(GPS_FIELD_COURSE, &BasicTinyGPS::term_course),             // 1 course over ground, degrees true
+    nullptr,                                                        // 2 T
+    nullptr,                                                        // 3 course over ground, degrees magnetic
+    nullptr,                                                        // 4 M
+    term(GPS_FIELD_SPEED, &BasicTinyGPS::term_speed),               // 5 speed over ground, knots
+    nullptr,                                                        // 6 N
+    nullptr,                                                        // 7 speed over ground, km/h
+    nullptr,                                                        // 8 K
+    &BasicTinyGPS::term_vtg_mode                                    // 9 mode indicator, N = not valid
+};
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_gll_terms[7] = {
+    nullptr,
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_latitude),         // 1
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_north_south),      // 2
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_longitude),        // 3
+    term(GPS_FIELD_POSITION, &BasicTinyGPS::term_east_west),        // 4
+    term(GPS_FIELD_TIME, &BasicTinyGPS::term_time),                 // 5 UTC time
+    &BasicTinyGPS::term_status                                      // 6 A = valid, V = warning
+};
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::TermHandler BasicTinyGPS<Fields>::s_zda_terms[7] = {
+    nullptr,
+    term(GPS_FIELD_TIME, &BasicTinyGPS::term_time),                 // 1 UTC time
+    term(GPS_FIELD_DATE, &BasicTinyGPS::term_zda_day),              // 2
+    term(GPS_FIELD_DATE, &BasicTinyGPS::term_zda_month),            // 3
+    term(GPS_FIELD_DATE | GPS_FIELD_ZDA, &BasicTinyGPS::term_zda_year), // 4 four digits
+    term(GPS_FIELD_ZDA, &BasicTinyGPS::term_zda_zone_hours),        // 5 local zone hours, -13..13
+    term(GPS_FIELD_ZDA, &BasicTinyGPS::term_zda_zone_minutes)       // 6 local zone minutes
+};
+
+#define GPS_TERMS(table) table, sizeof(table) / sizeof(table[0])
+
+template<unsigned Fields>
+const typename BasicTinyGPS<Fields>::SentenceParser BasicTinyGPS<Fields>::s_parsers[] = {
+    {GPS_FORMATTER("GGA"), GPS_SENTENCE_GGA, false, GPS_TERMS(s_gga_terms), &BasicTinyGPS::commit_gga},
+    {GPS_FORMATTER("RMC"), GPS_SENTENCE_RMC, false, GPS_TERMS(s_rmc_terms), &BasicTinyGPS::commit_rmc},
+    {GPS_FORMATTER("GSA"), GPS_SENTENCE_GSA, true,  GPS_TERMS(s_gsa_terms), &BasicTinyGPS::commit_gsa},
+    {GPS_FORMATTER("GSV"), GPS_SENTENCE_GSV, true,  GPS_TERMS(s_gsv_terms), &BasicTinyGPS::commit_gsv},
+    {GPS_FORMATTER("VTG"), GPS_SENTENCE_VTG, true,  GPS_TERMS(s_vtg_terms), &BasicTinyGPS::commit_vtg},
+    {GPS_FORMATTER("GLL"), GPS_SENTENCE_GLL, false, GPS_TERMS(s_gll_terms), &BasicTinyGPS::commit_gll},
+    {GPS_FORMATTER("ZDA"), GPS_SENTENCE_ZDA, true,  GPS_TERMS(s_zda_terms), &BasicTinyGPS::commit_zda},
+    // UBX messages: no formatter or terms, see ubx_frame_complete()
+    {0, GPS_SENTENCE_UBX_PVT, false, nullptr, 0, &BasicTinyGPS::commit_ubx_pvt},
+    {0, GPS_SENTENCE_UBX_SAT, true,  nullptr, 0, &BasicTinyGPS::commit_ubx_sat}
+};
+
+#undef GPS_TERMS
+
+// Processes a just-completed data term
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_complete()
+{
+    // the first term determines the sentence type
+    if (m_term_number == 0)
+    {
+        sentence_header();
+        return;
+    }
+
+    if (m_parsing_ack)
+    {
+        // $PMTK001,command,result
+        if (m_term_number == 1)
+            m_ack_command = quint16(gpsatol(m_term));
+        else if (m_term_number == 2)
+            m_ack_result = quint8(gpsatol(m_term));
+        return;
+    }
+
+    if (m_sentence_type != GPS_SENTENCE_OTHER && m_term[0])
+    {
+        const SentenceParser &parser = s_parsers[m_sentence_type];
+        if (m_term_number < parser.term_count && parser.terms[m_term_number])
+            (this->*parser.terms[m_term_number])();
+    }
+}
+
+#ifndef GPS_NO_STATS
+// Good sentences per second, over windows of at least one second
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::count_rate()
+{
+    unsigned long now = millis();
+    if (!m_rate_window_start)
+        m_rate_window_start = now;
+    ++m_rate_window_count;
+    unsigned long elapsed = now - m_rate_window_start;
+    if (elapsed >= 1000)
+    {
+        m_sentence_rate_milli.store(1000000ULL * m_rate_window_count / elapsed);
+        m_rate_window_start = now;
+        m_rate_window_count = 0;
+    }
+}
+#endif
+
+// Hands the fix of a just-validated sentence to the channel and the callback
+// and records the latencies up to the channel
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::publish()
+{
+    if (!m_fix_channel && !m_fix_callback && !m_latency)
+        return;
+
+    quint64 parsed_ns = gps_clock_ns();
+    if (m_latency)
+    {
+        // characters not marked by the I/O layer count from the '$'
+        quint64 received_ns = m_received_ns > m_sentence_start_ns ? m_received_ns : m_sentence_start_ns;
+        m_latency->read_to_parse.record(parsed_ns - received_ns);
+    }
+
+    if (m_fix_channel || m_fix_callback)
+    {
+        GpsFix fix;
+        get_fix(&fix);
+        fix.published_ns = gps_clock_ns();
+        if (m_fix_channel)
+            m_fix_channel->store(fix);
+        if (m_latency)
+            m_latency->parse_to_publish.record(fix.published_ns - parsed_ns);
+        if (m_fix_callback)
+            m_fix_callback(fix, m_fix_context);
+    }
+}
+
+// Splits a header such as "GNRMC" into talker and formatter; the formatter is
+// looked up as a packed 3-byte integer
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::sentence_header()
+{
+    m_sentence_type = GPS_SENTENCE_OTHER;
+    m_new_talker = GPS_TALKER_OTHER;
+    if (m_term_offset == 7 && m_ack_callback && memcmp(m_term, "PMTK001", 7) == 0)
+    {
+        m_parsing_ack = true;
+        m_ack_command = 0;
+        m_ack_result = GpsAck::PMTK_INVALID;
+        return;
+    }
+    if (m_term_offset != 5)
+        return;
+
+    switch (GPS_TALKER(m_term[0], m_term[1]))
+    {
+    case GPS_TALKER('G', 'P'): m_new_talker = GPS_TALKER_GP; break;
+    case GPS_TALKER('G', 'L'): m_new_talker = GPS_TALKER_GL; break;
+    case GPS_TALKER('G', 'A'): m_new_talker = GPS_TALKER_GA; break;
+    case GPS_TALKER('G', 'B'):
+    case GPS_TALKER('B', 'D'): m_new_talker = GPS_TALKER_GB; break;
+    case GPS_TALKER('G', 'Q'): m_new_talker = GPS_TALKER_GQ; break;
+    case GPS_TALKER('G', 'N'): m_new_talker = GPS_TALKER_GN; break;
+    default: return; // proprietary or unknown
+    }
+
+    quint32 formatter = GPS_FORMATTER_PACK(m_term[2], m_term[3], m_term[4]);
+    for (const SentenceParser &parser : s_parsers)
+    {
+        if (parser.formatter == formatter)
+        {
+            m_sentence_type = parser.sentence_type;
+            m_gps_data_good = parser.valid_by_default;
+            break;
+        }
+    }
+
+    switch (m_sentence_type)
+    {
+    case GPS_SENTENCE_GSA:
+        if constexpr (has(GPS_FIELD_GSA))
+        {
+            this->m_new_sats_used_count = 0;
+            this->m_new_pdop = this->m_new_vdop = GPS_INVALID_DOP;
+        }
+        if constexpr (has(GPS_FIELD_HDOP))
+            this->m_new_hdop = GPS_INVALID_DOP;
+        break;
+    case GPS_SENTENCE_GSV:
+        if constexpr (has(GPS_FIELD_GSV))
+        {
+            for (GpsSatellite &sat : this->m_new_gsv_sats)
+            {
+                sat.prn = 0;
+                sat.elevation = 0;
+                sat.azimuth = 0;
+                sat.snr = GPS_INVALID_SNR;
+            }
+        }
+        break;
+    case GPS_SENTENCE_ZDA:
+        if constexpr (has(GPS_FIELD_ZDA))
+            this->m_new_local_zone = 0;
+        break;
+    }
+}
+
+//
+// term handlers
+//
+// Each body compiles away when its field group is not parsed; the term
+// tables do not reference those handlers then.
+//
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_time()
+{
+    if constexpr (has(GPS_FIELD_TIME))
+    {
+        qint64 time;
+        this->m_new_time = parse_decimal(2, &time) && time >= 0 ? (unsigned long)time : (unsigned long)GPS_INVALID_TIME;
+        this->m_new_time_fix = millis();
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_status()
+{
+    m_gps_data_good = m_term[0] == 'A';
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_latitude()
+{
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        this->m_new_latitude = parse_degrees();
+        this->m_new_position_fix = millis();
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_north_south()
+{
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        if (m_term[0] == 'S' && this->m_new_latitude != GPS_INVALID_E7)
+            this->m_new_latitude = -this->m_new_latitude;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_longitude()
+{
+    if constexpr (has(GPS_FIELD_POSITION))
+        this->m_new_longitude = parse_degrees();
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_east_west()
+{
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        if (m_term[0] == 'W' && this->m_new_longitude != GPS_INVALID_E7)
+            this->m_new_longitude = -this->m_new_longitude;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_speed()
+{
+    if constexpr (has(GPS_FIELD_SPEED))
+    {
+        qint64 speed;
+        this->m_new_speed = parse_decimal(3, &speed) && speed >= 0 ? (unsigned long)speed : (unsigned long)GPS_INVALID_SPEED;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_course()
+{
+    if constexpr (has(GPS_FIELD_COURSE))
+    {
+        qint64 course;
+        this->m_new_course = parse_decimal(3, &course) && course >= 0 ? (unsigned long)course : (unsigned long)GPS_INVALID_ANGLE;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_date()
+{
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_new_date = gpsatol(m_term);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_fix_quality()
+{
+    m_gps_data_good = m_term[0] > '0';
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_satellites()
+{
+    if constexpr (has(GPS_FIELD_SATELLITES))
+        this->m_new_numsats = (unsigned char)atoi(m_term);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_hdop()
+{
+    if constexpr (has(GPS_FIELD_HDOP))
+    {
+        qint64 hdop;
+        this->m_new_hdop = parse_decimal(2, &hdop) && hdop >= 0 ? (unsigned long)hdop : (unsigned long)GPS_INVALID_HDOP;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_altitude()
+{
+    if constexpr (has(GPS_FIELD_ALTITUDE))
+    {
+        qint64 altitude;
+        this->m_new_altitude = parse_decimal(3, &altitude) ? long(altitude) : long(GPS_INVALID_ALTITUDE);
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_gsa_fix_type()
+{
+    if constexpr (has(GPS_FIELD_GSA))
+        this->m_new_fix_type = quint8(gpsatol(m_term));
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_gsa_prn()
+{
+    if constexpr (has(GPS_FIELD_GSA))
+        this->m_new_sats_used[this->m_new_sats_used_count++] = quint8(gpsatol(m_term));
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_pdop()
+{
+    if constexpr (has(GPS_FIELD_GSA))
+    {
+        qint64 pdop;
+        this->m_new_pdop = parse_decimal(2, &pdop) && pdop >= 0 ? (unsigned long)pdop : (unsigned long)GPS_INVALID_DOP;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_vdop()
+{
+    if constexpr (has(GPS_FIELD_GSA))
+    {
+        qint64 vdop;
+        this->m_new_vdop = parse_decimal(2, &vdop) && vdop >= 0 ? (unsigned long)vdop : (unsigned long)GPS_INVALID_DOP;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_gsv_message()
+{
+    if constexpr (has(GPS_FIELD_GSV))
+        this->m_new_gsv_message = quint8(gpsatol(m_term));
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_gsv_sats_in_view()
+{
+    if constexpr (has(GPS_FIELD_GSV))
+        this->m_new_sats_in_view = quint8(gpsatol(m_term));
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_gsv_satellite()
+{
+    if constexpr (has(GPS_FIELD_GSV))
+    {
+        GpsSatellite &sat = this->m_new_gsv_sats[(m_term_number - 4) / 4];
+        switch ((m_term_number - 4) % 4)
+        {
+        case 0: sat.prn = quint8(gpsatol(m_term)); break;
+        case 1: sat.elevation = quint8(gpsatol(m_term)); break;
+        case 2: sat.azimuth = quint16(gpsatol(m_term)); break;
+        case 3: sat.snr = quint8(gpsatol(m_term)); break;
+        }
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_vtg_mode()
+{
+    m_gps_data_good = m_term[0] != 'N';
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_zda_day()
+{
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_new_date = 10000 * gpsatol(m_term);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_zda_month()
+{
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_new_date += 100 * gpsatol(m_term);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_zda_year()
+{
+    int year = int(gpsatol(m_term));
+    if constexpr (has(GPS_FIELD_ZDA))
+        this->m_new_year = year;
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_new_date += year % 100;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_zda_zone_hours()
+{
+    if constexpr (has(GPS_FIELD_ZDA))
+    {
+        bool isneg = m_term[0] == '-';
+        long hours = gpsatol(isneg || m_term[0] == '+' ? m_term + 1 : m_term) % 100; // two digits
+        this->m_new_local_zone = int(isneg ? -60 * hours : 60 * hours);
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::term_zda_zone_minutes()
+{
+    if constexpr (has(GPS_FIELD_ZDA))
+    {
+        int minutes = int(gpsatol(m_term) % 100);
+        this->m_new_local_zone += this->m_new_local_zone < 0 ? -minutes : minutes;
+    }
+}
+
+//
+// UBX decoders, filling the m_new_* fields from m_ubx_payload like the term
+// handlers do from the terms
+//
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::ubx_nav_pvt()
+{
+    if constexpr (has(GPS_FIELD_UBX))
+    {
+        const quint8 *p = this->m_ubx_payload;
+        const quint8 valid = p[11];     // 0x01 date, 0x02 time
+        const quint8 fix_type = p[20];  // 2 = 2D, 3 = 3D, 4 = GNSS + dead reckoning
+        const quint8 flags = p[21];     // 0x01 fix within accuracy limits
+
+        m_sentence_type = GPS_SENTENCE_UBX_PVT;
+        m_new_talker = GPS_TALKER_GN;
+        m_gps_data_good = (flags & 0x01) && fix_type >= 2 && fix_type <= 4;
+        if (!m_gps_data_good)
+            return;
+
+        if constexpr (has(GPS_FIELD_TIME) || has(GPS_FIELD_DATE) || has(GPS_FIELD_ZDA))
+        {
+            // the fields are rounded to the second, nano corrects them by up to
+            // a second either way and can move the time into the previous day
+            const int year = ubx_u2(p + 4);
+            const unsigned month = p[6], day = p[7], hour = p[8], minute = p[9], second = p[10];
+            const qint32 nano = qint32(ubx_u4(p + 16));
+            const bool date_ok = (valid & 0x01) && month - 1 < 12 && day - 1 < 31;
+            const bool time_ok = (valid & 0x02) && hour < 24 && minute < 60 && second <= 60;
+
+            qint64 days = date_ok ? gpstime::days_from_civil(year, month, day) : 0;
+            qint64 ms = qint64((hour * 60 + minute) * 60 + second) * 1000
+                    + (nano >= 0 ? nano / 1000000 : -((999999 - qint64(nano)) / 1000000));
+            if (ms < 0)
+            {
+                ms += gpstime::MsPerDay;
+                --days;
+            }
+            int civil_year = year;
+            unsigned civil_month = month, civil_day = day;
+            if (date_ok)
+                gpstime::civil_from_days(days, &civil_year, &civil_month, &civil_day);
+
+            if constexpr (has(GPS_FIELD_TIME))
+            {
+                this->m_new_time = time_ok ? (unsigned long)(ms / 3600000 * 1000000 + ms / 60000 % 60 * 10000
+                                                              + ms / 1000 % 60 * 100 + ms % 1000 / 10)
+                                           : (unsigned long)GPS_INVALID_TIME;
+                this->m_new_time_fix = millis();
+            }
+            if constexpr (has(GPS_FIELD_DATE))
+                this->m_new_date = date_ok ? civil_day * 10000 + civil_month * 100 + unsigned(civil_year % 100)
+                                           : (unsigned long)GPS_INVALID_DATE;
+            if constexpr (has(GPS_FIELD_ZDA))
+                this->m_new_year = date_ok ? civil_year : int(GPS_INVALID_YEAR);
+        }
+        if constexpr (has(GPS_FIELD_POSITION))
+        {
+            this->m_new_longitude = long(qint32(ubx_u4(p + 24)));
+            this->m_new_latitude = long(qint32(ubx_u4(p + 28)));
+            this->m_new_position_fix = millis();
+        }
+        if constexpr (has(GPS_FIELD_ALTITUDE))
+            this->m_new_altitude = long(qint32(ubx_u4(p + 36)));  // mm above mean sea level
+        if constexpr (has(GPS_FIELD_SPEED))
+        {
+            // mm/s to 1000ths of a knot
+            const qint32 speed = qint32(ubx_u4(p + 60));
+            this->m_new_speed = speed > 0 ? (unsigned long)((qint64(speed) * 3600 + 926) / 1852) : 0;
+        }
+        if constexpr (has(GPS_FIELD_COURSE))
+        {
+            // 10^-5 degrees to 1000ths
+            const qint32 heading = qint32(ubx_u4(p + 64));
+            const long course = long((qint64(heading) + 50) / 100 % 360000);
+            this->m_new_course = (unsigned long)(course < 0 ? course + 360000 : course);
+        }
+        if constexpr (has(GPS_FIELD_SATELLITES))
+            this->m_new_numsats = p[23];
+        if constexpr (has(GPS_FIELD_GSA))
+        {
+            this->m_new_fix_type = fix_type == 2 ? GPS_FIX_2D : GPS_FIX_3D;
+            this->m_new_pdop = ubx_u2(p + 76); // 100ths
+        }
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::ubx_nav_sat()
+{
+    // the satellites are read from the payload at commit time
+    m_sentence_type = GPS_SENTENCE_UBX_SAT;
+    m_new_talker = GPS_TALKER_GN;
+    m_gps_data_good = true;
+}
+
+//
+// commit handlers
+//
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_rmc()
+{
+    if constexpr (has(GPS_FIELD_TIME))
+        this->m_time      = this->m_new_time;
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_date      = this->m_new_date;
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        this->m_latitude  = this->m_new_latitude;
+        this->m_longitude = this->m_new_longitude;
+    }
+    if constexpr (has(GPS_FIELD_SPEED))
+        this->m_speed     = this->m_new_speed;
+    if constexpr (has(GPS_FIELD_COURSE))
+        this->m_course    = this->m_new_course;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_gga()
+{
+    if constexpr (has(GPS_FIELD_ALTITUDE))
+        this->m_altitude  = this->m_new_altitude;
+    if constexpr (has(GPS_FIELD_TIME))
+        this->m_time      = this->m_new_time;
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        this->m_latitude  = this->m_new_latitude;
+        this->m_longitude = this->m_new_longitude;
+    }
+    if constexpr (has(GPS_FIELD_SATELLITES))
+        this->m_numsats   = this->m_new_numsats;
+    if constexpr (has(GPS_FIELD_HDOP))
+        this->m_hdop      = this->m_new_hdop;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_gsa()
+{
+    if constexpr (has(GPS_FIELD_GSA))
+    {
+        this->m_fix_type  = this->m_new_fix_type;
+        this->m_pdop      = this->m_new_pdop;
+        this->m_vdop      = this->m_new_vdop;
+        memcpy(this->m_sats_used, this->m_new_sats_used, this->m_new_sats_used_count);
+        this->m_sats_used_count = this->m_new_sats_used_count;
+    }
+    if constexpr (has(GPS_FIELD_HDOP))
+        this->m_hdop      = this->m_new_hdop;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_gsv()
+{
+    if constexpr (has(GPS_FIELD_GSV))
+    {
+        if (this->m_new_gsv_message < 1 || this->m_new_gsv_message > GPS_MAX_SATS_IN_VIEW / 4)
+            return;
+
+        memcpy(&this->m_sats_in_view[m_talker][(this->m_new_gsv_message - 1) * 4], this->m_new_gsv_sats,
+                sizeof(this->m_new_gsv_sats));
+        this->m_sats_in_view_count[m_talker] = this->m_new_sats_in_view;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_vtg()
+{
+    if constexpr (has(GPS_FIELD_SPEED))
+        this->m_speed     = this->m_new_speed;
+    if constexpr (has(GPS_FIELD_COURSE))
+        this->m_course    = this->m_new_course;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_gll()
+{
+    if constexpr (has(GPS_FIELD_TIME))
+        this->m_time      = this->m_new_time;
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        this->m_latitude  = this->m_new_latitude;
+        this->m_longitude = this->m_new_longitude;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_zda()
+{
+    if constexpr (has(GPS_FIELD_TIME))
+        this->m_time       = this->m_new_time;
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_date       = this->m_new_date;
+    if constexpr (has(GPS_FIELD_ZDA))
+    {
+        this->m_year       = this->m_new_year;
+        this->m_local_zone = this->m_new_local_zone;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_ubx_pvt()
+{
+    if constexpr (has(GPS_FIELD_TIME))
+        this->m_time      = this->m_new_time;
+    if constexpr (has(GPS_FIELD_DATE))
+        this->m_date      = this->m_new_date;
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        this->m_latitude  = this->m_new_latitude;
+        this->m_longitude = this->m_new_longitude;
+    }
+    if constexpr (has(GPS_FIELD_ALTITUDE))
+        this->m_altitude  = this->m_new_altitude;
+    if constexpr (has(GPS_FIELD_SPEED))
+        this->m_speed     = this->m_new_speed;
+    if constexpr (has(GPS_FIELD_COURSE))
+        this->m_course    = this->m_new_course;
+    if constexpr (has(GPS_FIELD_SATELLITES))
+        this->m_numsats   = this->m_new_numsats;
+    if constexpr (has(GPS_FIELD_GSA))
+    {
+        this->m_fix_type  = this->m_new_fix_type;
+        this->m_pdop      = this->m_new_pdop;
+    }
+    if constexpr (has(GPS_FIELD_ZDA))
+        this->m_year      = this->m_new_year;
+}
+
+// NAV-SAT lists every constellation at once: it replaces the satellites in
+// view of each talker and, with GSA, the PRNs used (NMEA numbering)
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::commit_ubx_sat()
+{
+    if constexpr (has(GPS_FIELD_UBX) && (has(GPS_FIELD_GSV) || has(GPS_FIELD_GSA)))
+    {
+        if constexpr (has(GPS_FIELD_GSV))
+            memset(this->m_sats_in_view_count, 0, sizeof(this->m_sats_in_view_count));
+        if constexpr (has(GPS_FIELD_GSA))
+            this->m_sats_used_count = 0;
+
+        const unsigned count = this->m_ubx_payload[5] < GPS_UBX_MAX_SATS ? this->m_ubx_payload[5] : GPS_UBX_MAX_SATS;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            const quint8 *sv = this->m_ubx_payload + 8 + 12 * i;
+            quint8 talker;
+            unsigned prn = sv[1];
+            switch (sv[0]) // gnssId
+            {
+            case 0: talker = GPS_TALKER_GP; break;
+            case 1: talker = GPS_TALKER_GP; prn -= 87; break;   // SBAS 120-158 as 33-71
+            case 2: talker = GPS_TALKER_GA; break;
+            case 3: talker = GPS_TALKER_GB; break;
+            case 5: talker = GPS_TALKER_GQ; prn += 192; break;
+            case 6: talker = GPS_TALKER_GL; prn += 64; break;
+            default: continue;
+            }
+
+            if constexpr (has(GPS_FIELD_GSV))
+            {
+                quint8 &n = this->m_sats_in_view_count[talker];
+                if (n < GPS_MAX_SATS_IN_VIEW)
+                {
+                    const qint8 elevation = qint8(sv[3]);
+                    const qint16 azimuth = qint16(ubx_u2(sv + 4));
+                    GpsSatellite &sat = this->m_sats_in_view[talker][n];
+                    sat.prn = quint8(prn);
+                    sat.elevation = quint8(elevation > 0 ? elevation : 0);
+                    sat.azimuth = quint16(azimuth > 0 ? azimuth : 0);
+                    sat.snr = sv[2] ? sv[2] : quint8(GPS_INVALID_SNR);
+                }
+                ++n;
+            }
+            if constexpr (has(GPS_FIELD_GSA))
+            {
+                if ((ubx_u4(sv + 8) & 0x08) && this->m_sats_used_count < GPS_MAX_CHANNELS) // svUsed
+                    this->m_sats_used[this->m_sats_used_count++] = quint8(prn);
+            }
+        }
+    }
+}
+
+//
+// accessors
+//
+
+// lat/long in MILLIONTHs of a degree and age of fix in milliseconds
+// (note: versions 12 and earlier gave this value in 100,000ths of a degree.
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::get_position(long *latitude, long *longitude, unsigned long *fix_age)
+{
+    static_assert(has(GPS_FIELD_POSITION), "position not parsed");
+    if (latitude) *latitude = e7_to_micro(this->m_latitude);
+    if (longitude) *longitude = e7_to_micro(this->m_longitude);
+    if (fix_age) *fix_age = this->m_last_position_fix == GPS_INVALID_FIX_TIME ?
+                (unsigned long)GPS_INVALID_AGE : millis() - this->m_last_position_fix;
+}
+
+// date as ddmmyy, time as hhmmsscc, and age in milliseconds
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::get_datetime(unsigned long *date, unsigned long *time, unsigned long *age)
+{
+    static_assert(has(GPS_FIELD_DATE | GPS_FIELD_TIME), "date and time not parsed");
+    if (date) *date = this->m_date;
+    if (time) *time = this->m_time;
+    if (age) *age = this->m_last_time_fix == GPS_INVALID_FIX_TIME ?
+                (unsigned long)GPS_INVALID_AGE : millis() - this->m_last_time_fix;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::get_fix(GpsFix *fix)
+{
+    fix->latitude = GPS_INVALID_ANGLE;
+    fix->longitude = GPS_INVALID_ANGLE;
+    fix->time = GPS_INVALID_TIME;
+    fix->date = GPS_INVALID_DATE;
+    fix->speed = GPS_INVALID_SPEED;
+    fix->course = GPS_INVALID_ANGLE;
+    fix->altitude = GPS_INVALID_ALTITUDE;
+    fix->hdop = GPS_INVALID_HDOP;
+    fix->satellites = GPS_INVALID_SATELLITES;
+    fix->talker = m_talker;
+    fix->sentence_type = m_last_sentence_type;
+    fix->published_ns = 0;
+    fix->epoch_ms = 0;
+    fix->valid = 0;
+
+    if constexpr (has(GPS_FIELD_POSITION))
+    {
+        fix->latitude = e7_to_micro(this->m_latitude);
+        fix->longitude = e7_to_micro(this->m_longitude);
+        if (this->m_latitude != GPS_INVALID_E7 && this->m_longitude != GPS_INVALID_E7)
+            fix->valid |= GpsFix::VALID_POSITION;
+    }
+    if constexpr (has(GPS_FIELD_TIME))
+    {
+        fix->time = this->m_time;
+        if (this->m_time != GPS_INVALID_TIME)
+            fix->valid |= GpsFix::VALID_TIME;
+    }
+    if constexpr (has(GPS_FIELD_DATE))
+    {
+        fix->date = this->m_date;
+        if (this->m_date != GPS_INVALID_DATE)
+            fix->valid |= GpsFix::VALID_DATE;
+    }
+    if constexpr (has(GPS_FIELD_DATE | GPS_FIELD_TIME))
+        fix->epoch_ms = this->m_epoch_ms;
+    if constexpr (has(GPS_FIELD_SPEED))
+    {
+        fix->speed = from_milli(this->m_speed, GPS_INVALID_SPEED);
+        if (this->m_speed != GPS_INVALID_SPEED)
+            fix->valid |= GpsFix::VALID_SPEED;
+    }
+    if constexpr (has(GPS_FIELD_COURSE))
+    {
+        fix->course = from_milli(this->m_course, GPS_INVALID_ANGLE);
+        if (this->m_course != GPS_INVALID_ANGLE)
+            fix->valid |= GpsFix::VALID_COURSE;
+    }
+    if constexpr (has(GPS_FIELD_ALTITUDE))
+    {
+        fix->altitude = from_milli(this->m_altitude, GPS_INVALID_ALTITUDE);
+        if (this->m_altitude != GPS_INVALID_ALTITUDE)
+            fix->valid |= GpsFix::VALID_ALTITUDE;
+    }
+    if constexpr (has(GPS_FIELD_HDOP))
+    {
+        fix->hdop = this->m_hdop;
+        if (this->m_hdop != GPS_INVALID_HDOP)
+            fix->valid |= GpsFix::VALID_HDOP;
+    }
+    if constexpr (has(GPS_FIELD_SATELLITES))
+    {
+        fix->satellites = quint8(this->m_numsats);
+        if (this->m_numsats != GPS_INVALID_SATELLITES)
+            fix->valid |= GpsFix::VALID_SATELLITES;
+    }
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::f_get_position(float *latitude, float *longitude, unsigned long *fix_age)
+{
+    long lat, lon;
+    get_position(&lat, &lon, fix_age);
+    *latitude = lat == GPS_INVALID_ANGLE ? GPS_INVALID_F_ANGLE : (lat / 1000000.0);
+    *longitude = lon == GPS_INVALID_ANGLE ? GPS_INVALID_F_ANGLE : (lon / 1000000.0);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::d_get_position(double *latitude, double *longitude, unsigned long *fix_age)
+{
+    get_position(nullptr, nullptr, fix_age);
+    *latitude = this->m_latitude == GPS_INVALID_E7 ? GPS_INVALID_F_ANGLE : (this->m_latitude / 10000000.0);
+    *longitude = this->m_longitude == GPS_INVALID_E7 ? GPS_INVALID_F_ANGLE : (this->m_longitude / 10000000.0);
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::crack_datetime(int *year, quint8 *month, quint8 *day,
+                             quint8 *hour, quint8 *minute, quint8 *second, quint8 *hundredths, unsigned long *age)
+{
+    unsigned long date, time;
+    get_datetime(&date, &time, age);
+    if (year || month || day)
+    {
+        // the epoch day has the century, rollover and midnight already applied
+        int y = GPS_INVALID_YEAR;
+        unsigned m = 0, d = 0;
+        if (this->m_epoch_days)
+            gpstime::civil_from_days(this->m_epoch_days, &y, &m, &d);
+        else if (date != GPS_INVALID_DATE)
+        {
+            y = gpstime::full_year(int(date % 100));
+            m = date / 100 % 100;
+            d = date / 10000;
+        }
+        if (year) *year = y;
+        if (month) *month = quint8(m);
+        if (day) *day = quint8(d);
+    }
+    if (hour) *hour = time / 1000000;
+    if (minute) *minute = (time / 10000) % 100;
+    if (second) *second = (time / 100) % 100;
+    if (hundredths) *hundredths = time % 100;
+}
+
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::set_rollover_floor(qint64 floor_ms)
+{
+    static_assert(has(GPS_FIELD_DATE), "date not parsed");
+    this->m_rollover_floor_days = floor_ms > 0 ? (floor_ms + gpstime::MsPerDay - 1) / gpstime::MsPerDay : 0;
+    this->m_epoch_date = GPS_INVALID_DATE; // recompute with the new floor
+    this->m_epoch_days = 0;
+}
+
+// Keeps m_epoch_ms in step with the date and time of the last sentence
+template<unsigned Fields>
+void BasicTinyGPS<Fields>::update_epoch()
+{
+    if constexpr (has(GPS_FIELD_DATE))
+    {
+        int zda_year = 0;
+        if constexpr (has(GPS_FIELD_ZDA))
+            zda_year = this->m_year == GPS_INVALID_YEAR ? 0 : this->m_year;
+
+        bool new_day = this->m_date != this->m_epoch_date || zda_year != this->m_epoch_year;
+        if (new_day)
+        {
+            this->m_epoch_date = this->m_date;
+            this->m_epoch_year = zda_year;
+            if (!gpstime::date_days(quint32(this->m_date), zda_year, this->m_rollover_floor_days, &this->m_epoch_days))
+                this->m_epoch_days = 0;
+        }
+
+        if constexpr (has(GPS_FIELD_TIME))
+        {
+            qint64 ms = this->m_time == GPS_INVALID_TIME ? -1 : gpstime::ms_of_day(quint32(this->m_time));
+            if (!this->m_epoch_days || ms < 0)
+            {
+                this->m_epoch_ms = 0;
+                return;
+            }
+            qint64 epoch = this->m_epoch_days * gpstime::MsPerDay + ms;
+            // a time-only sentence (GGA) just past midnight, before the next dated one
+            if (!new_day && this->m_epoch_ms && epoch + gpstime::MsPerDay / 2 < this->m_epoch_ms)
+            {
+                ++this->m_epoch_days;
+                epoch += gpstime::MsPerDay;
+            }
+            this->m_epoch_ms = epoch;
+        }
+    }
+}
+
+template<unsigned Fields>
+const quint8 *BasicTinyGPS<Fields>::satellites_used(quint8 *count)
+{
+    static_assert(has(GPS_FIELD_GSA), "GSA not parsed");
+    if (count) *count = this->m_sats_used_count;
+    return this->m_sats_used;
+}
+
+template<unsigned Fields>
+quint8 BasicTinyGPS<Fields>::satellites_in_view(quint8 talker)
+{
+    static_assert(has(GPS_FIELD_GSV), "GSV not parsed");
+    return talker < GPS_TALKER_COUNT ? this->m_sats_in_view_count[talker] : 0;
+}
+
+// satellites reported for one talker; count is capped at GPS_MAX_SATS_IN_VIEW
+template<unsigned Fields>
+const GpsSatellite *BasicTinyGPS<Fields>::satellite_view(quint8 talker, quint8 *count)
+{
+    static_assert(has(GPS_FIELD_GSV), "GSV not parsed");
+    if (talker >= GPS_TALKER_COUNT)
+    {
+        if (count) *count = 0;
+        return nullptr;
+    }
+    if (count)
+        *count = this->m_sats_in_view_count[talker] < GPS_MAX_SATS_IN_VIEW ?
+                    this->m_sats_in_view_count[talker] : GPS_MAX_SATS_IN_VIEW;
+    return this->m_sats_in_view[talker];
+}
+
+template<unsigned Fields>
+float BasicTinyGPS<Fields>::f_altitude()
+{
+    static_assert(has(GPS_FIELD_ALTITUDE), "altitude not parsed");
+    return this->m_altitude == GPS_INVALID_ALTITUDE ? GPS_INVALID_F_ALTITUDE : this->m_altitude / 1000.0;
+}
+
+template<unsigned Fields>
+float BasicTinyGPS<Fields>::f_course()
+{
+    static_assert(has(GPS_FIELD_COURSE), "course not parsed");
+    return this->m_course == GPS_INVALID_ANGLE ? GPS_INVALID_F_ANGLE : this->m_course / 1000.0;
+}
+
+template<unsigned Fields>
+float BasicTinyGPS<Fields>::f_speed_knots()
+{
+    static_assert(has(GPS_FIELD_SPEED), "speed not parsed");
+    return this->m_speed == GPS_INVALID_SPEED ? GPS_INVALID_F_SPEED : this->m_speed / 1000.0;
+}
+
+template<unsigned Fields>
+float BasicTinyGPS<Fields>::f_speed_mph()
+{
+    float sk = f_speed_knots();
+    return sk == GPS_INVALID_F_SPEED ? GPS_INVALID_F_SPEED : GPS_MPH_PER_KNOT * sk;
+}
+
+template<unsigned Fields>
+float BasicTinyGPS<Fields>::f_speed_mps()
+{
+    float sk = f_speed_knots();
+    return sk == GPS_INVALID_F_SPEED ? GPS_INVALID_F_SPEED : GPS_MPS_PER_KNOT * sk;
+}
+
+template<unsigned Fields>
+float BasicTinyGPS<Fields>::f_speed_kmph()
+{
+    float sk = f_speed_knots();
+    return sk == GPS_INVALID_F_SPEED ? GPS_INVALID_F_SPEED : GPS_KMPH_PER_KNOT * sk;
+}
+
+#endif // BASICTINYGPS_H
@@ -0,0 +1,16 @@
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = bench_gps
+
+include(../gps.pri)
+
+# recorded captures can be benchmarked as well as raw logs
+SOURCES += \
+    bench_gps.cpp \
+    ../nmeacapture.cpp
+
+HEADERS += \
+    ../nmeacapture.h
@@ -0,0 +1,416 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "geodesy.h"
+#include "nmeacapture.h"
+#include "nmeanum.h"
+#include "tinygps.h"
+
+// Microbenchmarks for the parser and the geodesy kernels, on a synthetic
+// stream and on any recorded logs or captures given on the command line.
+// Every run is written as one JSON document so results can be compared
+// over time.
+
+// every heap allocation in the process, to report allocations per sentence
+static std::atomic<quint64> s_allocations(0);
+
+void *operator new(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+volatile quint64 s_sink; // keeps results alive
+
+typedef BasicTinyGPS<GPS_FIELD_POSITION | GPS_FIELD_TIME> PositionGPS;
+
+QByteArray sentence(const QByteArray &body)
+{
+    quint8 checksum = 0;
+    for (char c : body)
+        checksum ^= quint8(c);
+    return '$' + body + '*' + QByteArray::number(checksum, 16).toUpper().rightJustified(2, '0') + "\r\n";
+}
+
+// A 10 Hz receiver's output: GGA, RMC, GSA and three GSV per epoch
+QByteArray syntheticStream(int epochs)
+{
+    std::mt19937 random(4807);
+    QByteArray stream;
+    double latitude = 4807.038, longitude = 1131.0;
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        int tenths = epoch % 864000;
+        QByteArray time = QString::asprintf("%02d%02d%02d.%d0", tenths / 36000, tenths / 600 % 60,
+                                            tenths / 10 % 60, tenths % 10).toLatin1();
+        latitude += (random() % 200) / 1e7;
+        longitude += (random() % 200) / 1e7;
+        QByteArray lat = QString::asprintf("%09.7f", latitude).toLatin1();
+        QByteArray lon = QString::asprintf("%010.7f", longitude).toLatin1();
+        QByteArray speed = QString::asprintf("%.3f", (random() % 30000) / 1000.0).toLatin1();
+        QByteArray course = QString::asprintf("%.2f", (random() % 36000) / 100.0).toLatin1();
+
+        stream += sentence("GPGGA," + time + ',' + lat + ",N," + lon + ",E,1,12,0.8,545.4,M,46.9,M,,");
+        stream += sentence("GPRMC," + time + ",A," + lat + ",N," + lon + ",E," + speed + ',' + course + ",230394,003.1,W,A");
+        stream += sentence("GPGSA,A,3,04,05,09,12,24,25,29,31,,,,,1.5,0.8,1.2");
+        stream += sentence("GPGSV,3,1,12,04,40,083,46,05,17,308,41,09,07,344,39,12,22,228,45");
+        stream += sentence("GPGSV,3,2,12,24,16,079,42,25,59,208,48,29,15,040,40,31,31,232,44");
+        stream += sentence("GPGSV,3,3,12,02,10,010,30,06,12,120,32,19,05,200,,20,45,300,41");
+    }
+    return stream;
+}
+
+QByteArray ubxFrame(quint8 messageClass, quint8 id, const QByteArray &payload)
+{
+    QByteArray frame("\xB5\x62");
+    frame += char(messageClass);
+    frame += char(id);
+    frame += char(payload.size() & 0xFF);
+    frame += char(payload.size() >> 8);
+    frame += payload;
+    quint8 a = 0, b = 0;
+    for (int i = 2; i < frame.size(); ++i) {
+        a += quint8(frame[i]);
+        b += a;
+    }
+    return frame + char(a) + char(b);
+}
+
+template<typename T>
+void put(QByteArray *payload, int offset, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i)
+        (*payload)[offset + int(i)] = char(quint64(value) >> (8 * i));
+}
+
+// The same receiver reporting in UBX: NAV-PVT and a 12-satellite NAV-SAT per epoch
+QByteArray syntheticUbxStream(int epochs)
+{
+    std::mt19937 random(4807);
+    QByteArray stream;
+    qint32 latitude = 481173000, longitude = 115166667;
+    for (int epoch = 0; epoch < epochs; ++epoch) {
+        int tenths = epoch % 864000;
+        latitude += qint32(random() % 200) * 10 / 6;
+        longitude += qint32(random() % 200) * 10 / 6;
+
+        QByteArray pvt(92, '\0');
+        put(&pvt, 4, quint16(1994));
+        put(&pvt, 6, quint8(3));
+        put(&pvt, 7, quint8(23));
+        put(&pvt, 8, quint8(tenths / 36000));
+        put(&pvt, 9, quint8(tenths / 600 % 60));
+        put(&pvt, 10, quint8(tenths / 10 % 60));
+        put(&pvt, 11, quint8(0x07));                    // date, time, fully resolved
+        put(&pvt, 16, qint32(tenths % 10 * 100000000));
+        put(&pvt, 20, quint8(3));                       // 3D
+        put(&pvt, 21, quint8(0x01));                    // fix OK
+        put(&pvt, 23, quint8(12));
+        put(&pvt, 24, longitude);
+        put(&pvt, 28, latitude);
+        put(&pvt, 36, qint32(545400));
+        put(&pvt, 60, qint32(random() % 15000));        // mm/s
+        put(&pvt, 64, qint32(random() % 36000000));     // 10^-5 degrees
+        put(&pvt, 76, quint16(150));
+        stream += ubxFrame(0x01, 0x07, pvt);
+
+        QByteArray sat(8 + 12 * 12, '\0');
+        put(&sat, 4, quint8(1));
+        put(&sat, 5, quint8(12));
+        for (int i = 0; i < 12; ++i) {
+            put(&sat, 8 + 12 * i + 1, quint8(i + 2));
+            put(&sat, 8 + 12 * i + 2, quint8(30 + i));
+            put(&sat, 8 + 12 * i + 3, qint8(5 * i));
+            put(&sat, 8 + 12 * i + 4, qint16(30 * i));
+            put(&sat, 8 + 12 * i + 8, quint32(i < 8 ? 0x0F : 0x07));
+        }
+        stream += ubxFrame(0x01, 0x35, sat);
+    }
+    return stream;
+}
+
+// raw NMEA, or the chunks of a capture file
+QByteArray loadStream(const QString &fileName, QString *error)
+{
+    CaptureReader capture(fileName);
+    if (capture.open()) {
+        QByteArray stream;
+        Capture::Chunk chunk;
+        while (capture.next(&chunk))
+            stream.append(chunk.data, chunk.size);
+        return stream;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+class Bench
+{
+public:
+    explicit Bench(double minSeconds) : m_minSeconds(minSeconds) {}
+
+    // repeats pass until it has run for the minimum time; pass returns the
+    // number of operations (bytes, pairs, terms) it did
+    template<typename Pass>
+    QJsonObject run(const QString &name, Pass pass, quint64 *operations, quint64 *allocations, double *seconds)
+    {
+        pass(); // warm up caches and branch predictors
+
+        *operations = 0;
+        quint64 iterations = 0;
+        quint64 allocated = s_allocations.load(std::memory_order_relaxed);
+        QElapsedTimer timer;
+        timer.start();
+        do {
+            *operations += pass();
+            ++iterations;
+        } while (timer.nsecsElapsed() < qint64(m_minSeconds * 1e9));
+        *seconds = timer.nsecsElapsed() / 1e9;
+        *allocations = s_allocations.load(std::memory_order_relaxed) - allocated;
+
+        QJsonObject result;
+        result["name"] = name;
+        result["iterations"] = double(iterations);
+        result["seconds"] = *seconds;
+        return result;
+    }
+
+private:
+    const double m_minSeconds;
+};
+
+// sentences in the stream the parser accepts
+template<typename Parser>
+quint64 countSentences(const QByteArray &stream)
+{
+    Parser gps;
+    return quint64(gps.encode(stream.constData(), size_t(stream.size())));
+}
+
+template<typename Parser>
+QJsonObject benchEncode(Bench &bench, const QString &name, const QByteArray &stream, int chunk)
+{
+    auto pass = [&]() -> quint64 {
+        Parser gps;
+        const char *data = stream.constData();
+        const int size = stream.size();
+        quint64 sentences = 0;
+        if (chunk == 1) {
+            for (int i = 0; i < size; ++i)
+                sentences += gps.encode(data[i]);
+        } else {
+            for (int offset = 0; offset < size; offset += chunk)
+                sentences += quint64(gps.encode(data + offset, size_t(qMin(chunk, size - offset))));
+        }
+        s_sink = sentences;
+        return quint64(size);
+    };
+
+    quint64 bytes, allocations;
+    double seconds;
+    QJsonObject result = bench.run(name, pass, &bytes, &allocations, &seconds);
+    const quint64 sentences = countSentences<Parser>(stream) * (bytes / quint64(stream.size()));
+    result["bytes"] = double(bytes);
+    result["sentences"] = double(sentences);
+    result["ns_per_byte"] = seconds * 1e9 / bytes;
+    result["mb_per_s"] = bytes / seconds / 1e6;
+    result["sentences_per_s"] = sentences / seconds;
+    result["allocations_per_sentence"] = sentences ? double(allocations) / sentences : 0.0;
+    return result;
+}
+
+QJsonObject benchTerms(Bench &bench)
+{
+    std::mt19937 random(60);
+    std::vector<QByteArray> terms;
+    for (int i = 0; i < 4096; ++i) {
+        QByteArray term = QByteArray::number(int(random() % 18000)) + '.';
+        for (int digits = int(random() % 8); digits >= 0; --digits)
+            term += char('0' + random() % 10);
+        term += QByteArray(8, '\0'); // the padding nmeanum reads into
+        terms.push_back(term);
+    }
+
+    auto pass = [&]() -> quint64 {
+        quint64 sum = 0;
+        for (const QByteArray &term : terms) {
+            nmeanum::Fixed value;
+            nmeanum::parse(term.constData(), &value);
+            sum += quint64(value.mantissa);
+        }
+        s_sink = sum;
+        return terms.size();
+    };
+
+    quint64 parsed, allocations;
+    double seconds;
+    QJsonObject result = bench.run("nmeanum/parse", pass, &parsed, &allocations, &seconds);
+    result["ns_per_term"] = seconds * 1e9 / parsed;
+    return result;
+}
+
+// double precision reference on the sphere the float kernels use
+double referenceDistance(double lat1, double long1, double lat2, double long2)
+{
+    const double radians = M_PI / 180.0;
+    double delta = (long1 - long2) * radians;
+    lat1 *= radians;
+    lat2 *= radians;
+    double a = std::cos(lat1) * std::sin(lat2) - std::sin(lat1) * std::cos(lat2) * std::cos(delta);
+    double b = std::cos(lat2) * std::sin(delta);
+    double c = std::sin(lat1) * std::sin(lat2) + std::cos(lat1) * std::cos(lat2) * std::cos(delta);
+    return std::atan2(std::sqrt(a * a + b * b), c) * 6372795.0;
+}
+
+QJsonArray benchGeodesy(Bench &bench)
+{
+    const size_t count = 4096;
+    std::vector<float> lat1(count), long1(count), lat2(count), long2(count), out(count);
+    std::vector<geodesy::GeoPoint> points(count);
+    std::mt19937 random(6372795);
+    std::uniform_real_distribution<float> latitude(-89.0f, 89.0f), longitude(-180.0f, 180.0f);
+    for (size_t i = 0; i < count; ++i) {
+        lat1[i] = latitude(random);
+        long1[i] = longitude(random);
+        lat2[i] = latitude(random);
+        long2[i] = longitude(random);
+        points[i] = geodesy::GeoPoint::from_degrees(lat2[i], long2[i]);
+    }
+
+    QJsonArray results;
+    quint64 pairs, allocations;
+    double seconds;
+
+    QJsonObject result = bench.run("geodesy/distance_between batch", [&]() -> quint64 {
+        geodesy::distance_between(lat1.data(), long1.data(), lat2.data(), long2.data(), out.data(), count);
+        return count;
+    }, &pairs, &allocations, &seconds);
+    result["ops_per_s"] = pairs / seconds;
+    double maxError = 0;
+    for (size_t i = 0; i < count; ++i)
+        maxError = qMax(maxError, std::fabs(out[i] - referenceDistance(lat1[i], long1[i], lat2[i], long2[i])));
+    result["max_error_m"] = maxError;
+    results.append(result);
+
+    result = bench.run("geodesy/distance_between single", [&]() -> quint64 {
+        float sum = 0;
+        for (size_t i = 0; i < count; ++i)
+            sum += TinyGPS::distance_between(lat1[i], long1[i], lat2[i], long2[i]);
+        s_sink = quint64(sum);
+        return count;
+    }, &pairs, &allocations, &seconds);
+    result["ops_per_s"] = pairs / seconds;
+    results.append(result);
+
+    result = bench.run("geodesy/course_to batch", [&]() -> quint64 {
+        geodesy::course_to(lat1.data(), long1.data(), lat2.data(), long2.data(), out.data(), count);
+        return count;
+    }, &pairs, &allocations, &seconds);
+    result["ops_per_s"] = pairs / seconds;
+    results.append(result);
+
+    std::vector<double> distances(count);
+    const geodesy::GeoPoint origin = geodesy::GeoPoint::from_degrees(48.1173, 11.516667);
+    result = bench.run("geodesy/distances_from wgs84", [&]() -> quint64 {
+        geodesy::distances_from(origin, points.data(), distances.data(), count);
+        return count;
+    }, &pairs, &allocations, &seconds);
+    result["ops_per_s"] = pairs / seconds;
+    results.append(result);
+
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption jsonOption("json", "Write the results to this file instead of stdout.", "file");
+    QCommandLineOption timeOption("min-time", "Run each benchmark for at least this long.", "seconds", "0.5");
+    parser.addOptions({jsonOption, timeOption});
+    parser.addPositionalArgument("logs", "Recorded NMEA logs or capture files to parse as well.", "[logs...]");
+    parser.process(a);
+
+    Bench bench(qMax(0.01, parser.value(timeOption).toDouble()));
+
+    std::vector<std::pair<QString, QByteArray>> streams;
+    streams.emplace_back("synthetic", syntheticStream(20000));
+    streams.emplace_back("synthetic-ubx", syntheticUbxStream(20000));
+    for (const QString &fileName : parser.positionalArguments()) {
+        QString error;
+        QByteArray stream = loadStream(fileName, &error);
+        if (stream.isEmpty()) {
+            QTextStream(stderr) << fileName << ": " << (error.isEmpty() ? QString("empty") : error) << '\n';
+            return 1;
+        }
+        streams.emplace_back(fileName, stream);
+    }
+
+    QJsonArray results;
+    for (const auto &stream : streams) {
+        const QString prefix = "encode/" + stream.first;
+        results.append(benchEncode<TinyGPS>(bench, prefix + " block", stream.second, 4096));
+        results.append(benchEncode<TinyGPS>(bench, prefix + " char", stream.second, 1));
+        results.append(benchEncode<PositionGPS>(bench, prefix + " position+time block", stream.second, 4096));
+    }
+    results.append(benchTerms(bench));
+    for (const QJsonValue &result : benchGeodesy(bench))
+        results.append(result);
+
+    QJsonObject run;
+    run["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    run["library_version"] = TinyGPS::library_version();
+    run["kernel_isa"] = QString(geodesy::kernel_isa());
+#ifdef __VERSION__
+    run["compiler"] = QString(__VERSION__);
+#endif
+    run["results"] = results;
+    const QByteArray json = QJsonDocument(run).toJson();
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size()) {
+            QTextStream(stderr) << file.fileName() << ": " << file.errorString() << '\n';
+            return 1;
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "bufferpool.h"
+
+#include <QMutexLocker>
+
+// Reference counted by the pool's writer and by every slice into it; the
+// pool pointer is only held while the slab is in use, so free slabs do not
+// keep the pool alive
+struct ByteSlice::Slab
+{
+    std::atomic<int> refs;
+    std::shared_ptr<BufferPool::Shared> pool;
+    std::unique_ptr<char[]> data;
+};
+
+struct BufferPool::Shared
+{
+    explicit Shared(int slabSize) : slabSize(slabSize) {}
+    ~Shared()
+    {
+        for (ByteSlice::Slab *slab : free)
+            delete slab;
+    }
+
+    const int slabSize;
+    mutable QMutex lock;
+    std::vector<ByteSlice::Slab *> free;
+    int slabs = 0;
+};
+
+ByteSlice::ByteSlice(Slab *slab, const char *data, int size)
+    : m_slab(slab)
+    , m_data(data)
+    , m_size(size)
+{
+    m_slab->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+ByteSlice::ByteSlice(const ByteSlice &other)
+    : m_slab(other.m_slab)
+    , m_data(other.m_data)
+    , m_size(other.m_size)
+{
+    if (m_slab)
+        m_slab->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+ByteSlice::ByteSlice(ByteSlice &&other) noexcept
+{
+    swap(other);
+}
+
+ByteSlice &ByteSlice::operator=(ByteSlice other) noexcept
+{
+    swap(other);
+    return *this;
+}
+
+ByteSlice::~ByteSlice()
+{
+    if (m_slab)
+        BufferPool::release(m_slab);
+}
+
+ByteSlice ByteSlice::mid(int pos, int len) const
+{
+    if (pos < 0 || pos >= m_size)
+        return ByteSlice();
+    if (len < 0 || len > m_size - pos)
+        len = m_size - pos;
+    return ByteSlice(m_slab, m_data + pos, len);
+}
+
+void ByteSlice::swap(ByteSlice &other) noexcept
+{
+    std::swap(m_slab, other.m_slab);
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+}
+
+BufferPool::BufferPool(int slabSize, int preallocate)
+    : m_shared(std::make_shared<Shared>(qMax(256, slabSize)))
+{
+    QMutexLocker locker(&m_shared->lock);
+    for (int i = 0; i < preallocate; ++i) {
+        ByteSlice::Slab *slab = new ByteSlice::Slab;
+        slab->data.reset(new char[size_t(m_shared->slabSize)]);
+        m_shared->free.push_back(slab);
+        ++m_shared->slabs;
+    }
+}
+
+BufferPool::~BufferPool()
+{
+    // slices still in flight keep the shared part, and their slabs, alive
+    if (m_current)
+        release(m_current);
+}
+
+char *BufferPool::writeSpan(int *room)
+{
+    if (!m_current || m_shared->slabSize - m_offset < m_shared->slabSize / 16) {
+        if (m_current)
+            release(m_current);
+        m_current = acquire();
+        m_offset = 0;
+    }
+    *room = m_shared->slabSize - m_offset;
+    return m_current->data.get() + m_offset;
+}
+
+ByteSlice BufferPool::commit(int len)
+{
+    ByteSlice slice(m_current, m_current->data.get() + m_offset, len);
+    m_offset += len;
+    return slice;
+}
+
+BufferPool::Stats BufferPool::stats() const
+{
+    QMutexLocker locker(&m_shared->lock);
+    Stats stats;
+    stats.slabs = m_shared->slabs;
+    stats.free = int(m_shared->free.size());
+    return stats;
+}
+
+// A free slab, or a new one when all are in use; the caller holds its only reference
+ByteSlice::Slab *BufferPool::acquire()
+{
+    ByteSlice::Slab *slab = nullptr;
+    {
+        QMutexLocker locker(&m_shared->lock);
+        if (!m_shared->free.empty()) {
+            slab = m_shared->free.back();
+            m_shared->free.pop_back();
+        } else {
+            ++m_shared->slabs;
+        }
+    }
+    if (!slab) {
+        slab = new ByteSlice::Slab;
+        slab->data.reset(new char[size_t(m_shared->slabSize)]);
+    }
+    slab->refs.store(1, std::memory_order_relaxed);
+    slab->pool = m_shared;
+    return slab;
+}
+
+// Drops one reference; the last one puts the slab back on its free list
+void BufferPool::release(ByteSlice::Slab *slab)
+{
+    if (slab->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+
+    std::shared_ptr<Shared> shared = std::move(slab->pool);
+    QMutexLocker locker(&shared->lock);
+    shared->free.push_back(slab);
+}
@@ -0,0 +1,88 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QMutex>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class BufferPool;
+
+// Read-only view of bytes in a pooled slab. Copies share the bytes and keep
+// the slab alive; it goes back to its pool when the last view is destroyed,
+// from whatever thread that happens on.
+class ByteSlice
+{
+public:
+    ByteSlice() = default;
+    ByteSlice(const ByteSlice &other);
+    ByteSlice(ByteSlice &&other) noexcept;
+    ByteSlice &operator=(ByteSlice other) noexcept;
+    ~ByteSlice();
+
+    const char *data() const { return m_data; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    // sub-view sharing the same slab
+    ByteSlice mid(int pos, int len = -1) const;
+    // deep copy, for consumers that keep the bytes around
+    QByteArray toByteArray() const { return QByteArray(data(), m_size); }
+
+    void swap(ByteSlice &other) noexcept;
+
+private:
+    friend class BufferPool;
+    struct Slab;
+
+    ByteSlice(Slab *slab, const char *data, int size);
+
+    Slab *m_slab = nullptr;
+    const char *m_data = nullptr;
+    int m_size = 0;
+};
+
+Q_DECLARE_METATYPE(ByteSlice)
+
+// Fixed-size slabs for a reader that fills them with read(char *, qint64)
+// and hands the bytes on as ByteSlices. Released slabs are reused, so once
+// the pool has grown to the number of slabs in flight no more memory is
+// allocated. One writer thread; slices may be released on any thread and
+// may outlive the pool.
+class BufferPool
+{
+public:
+    struct Stats {
+        int slabs;          // allocated so far
+        int free;           // waiting for reuse
+    };
+
+    explicit BufferPool(int slabSize = 4096, int preallocate = 8);
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // free space in the current slab, at least a sixteenth of a slab
+    char *writeSpan(int *room);
+    // the next len bytes written at writeSpan() as a slice
+    ByteSlice commit(int len);
+
+    Stats stats() const;
+
+private:
+    friend class ByteSlice;
+    struct Shared;
+
+    ByteSlice::Slab *acquire();
+    static void release(ByteSlice::Slab *slab);
+
+    std::shared_ptr<Shared> m_shared;
+    ByteSlice::Slab *m_current = nullptr; // the writer holds one reference
+    int m_offset = 0;
+};
+
+#endif // BUFFERPOOL_H
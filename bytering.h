@@ -0,0 +1,85 @@
+#ifndef BYTERING_H
+#define BYTERING_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Single-producer/single-consumer byte ring. The storage is allocated once in
+// the constructor; producer and consumer work on contiguous spans of it so data
+// is copied only once, straight from the device into the ring.
+class ByteRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit ByteRing(size_t capacity)
+        : m_capacity(round_up(capacity))
+        , m_mask(m_capacity - 1)
+        , m_buffer(new char[m_capacity])
+        , m_head(0)
+        , m_tail(0)
+    {
+    }
+
+    ByteRing(const ByteRing &) = delete;
+    ByteRing &operator=(const ByteRing &) = delete;
+
+    size_t capacity() const { return m_capacity; }
+
+    // bytes currently stored; exact on either side, a lower/upper bound elsewhere
+    size_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    // producer: contiguous free space starting at *data, then commit_write()
+    size_t write_span(char **data)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t free = m_capacity - (head - m_tail.load(std::memory_order_acquire));
+        size_t offset = head & m_mask;
+        *data = m_buffer.get() + offset;
+        return free < m_capacity - offset ? free : m_capacity - offset;
+    }
+
+    void commit_write(size_t len)
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    // consumer: contiguous stored bytes starting at *data, then commit_read()
+    size_t read_span(const char **data)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t used = m_head.load(std::memory_order_acquire) - tail;
+        size_t offset = tail & m_mask;
+        *data = m_buffer.get() + offset;
+        return used < m_capacity - offset ? used : m_capacity - offset;
+    }
+
+    void commit_read(size_t len)
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+private:
+    static size_t round_up(size_t n)
+    {
+        size_t capacity = 64;
+        while (capacity < n)
+            capacity <<= 1;
+        return capacity;
+    }
+
+    const size_t m_capacity;
+    const size_t m_mask;
+    std::unique_ptr<char[]> m_buffer;
+
+    // written by the producer and by the consumer; keep them on separate lines
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+};
+
+#endif // BYTERING_H
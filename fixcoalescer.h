@@ -0,0 +1,80 @@
+#ifndef FIXCOALESCER_H
+#define FIXCOALESCER_H
+
+#include "gpsfix.h"
+
+// Thins out the stream of published fixes for consumers that do not want
+// every sentence: passes at most max_rate fixes per second and, if asked,
+// only fixes whose data differ from the last one passed. A fix held back by
+// the rate limit becomes pending, replaced by any newer one, and is due at
+// the end of the interval, so the latest state always gets through.
+// Not thread safe.
+class FixCoalescer
+{
+public:
+    // 0 passes every fix
+    void set_max_rate(unsigned per_second) { m_interval_ns = per_second ? 1000000000ULL / per_second : 0; }
+    // skip fixes that repeat the last one passed (talker, sentence type and
+    // timestamp aside)
+    void set_changes_only(bool changes_only) { m_changes_only = changes_only; }
+
+    // true if fix should be delivered now, otherwise it may become pending
+    bool offer(const GpsFix &fix, quint64 now_ns)
+    {
+        if (m_changes_only && m_passed && same_data(fix, m_last))
+        {
+            m_pending = false; // back where we were, nothing new to report
+            return false;
+        }
+        if (m_passed && now_ns - m_last_ns < m_interval_ns)
+        {
+            m_pending_fix = fix;
+            m_pending = true;
+            return false;
+        }
+        pass(fix, now_ns);
+        return true;
+    }
+
+    bool has_pending() const { return m_pending; }
+    // gps_clock_ns() at which the pending fix may be delivered
+    quint64 due_ns() const { return m_last_ns + m_interval_ns; }
+
+    // the pending fix, to deliver now
+    bool take_pending(quint64 now_ns, GpsFix *fix)
+    {
+        if (!m_pending)
+            return false;
+        *fix = m_pending_fix;
+        pass(m_pending_fix, now_ns);
+        return true;
+    }
+
+    static bool same_data(const GpsFix &a, const GpsFix &b)
+    {
+        return a.valid == b.valid && a.latitude == b.latitude && a.longitude == b.longitude
+                && a.time == b.time && a.date == b.date && a.speed == b.speed
+                && a.course == b.course && a.altitude == b.altitude && a.hdop == b.hdop
+                && a.satellites == b.satellites;
+    }
+
+private:
+    void pass(const GpsFix &fix, quint64 now_ns)
+    {
+        m_last = fix;
+        m_last_ns = now_ns;
+        m_passed = true;
+        m_pending = false;
+    }
+
+    quint64 m_interval_ns = 0;
+    bool m_changes_only = false;
+
+    bool m_passed = false;
+    bool m_pending = false;
+    quint64 m_last_ns = 0;
+    GpsFix m_last = {};
+    GpsFix m_pending_fix = {};
+};
+
+#endif // FIXCOALESCER_H
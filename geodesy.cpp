@@ -0,0 +1,367 @@
+#include "geodesy.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#define GEODESY_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GEODESY_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const float EarthRadius = 6372795.0f;
+const float DegToRad = 0.017453292519943295f;
+const float RadToDeg = 57.295779513082321f;
+const float TwoPi = 6.2831853071795865f;
+const float Pi = 3.1415926535897932f;
+const float PiOver2 = 1.5707963267948966f;
+const float PiOver4 = 0.78539816339744831f;
+const float TwoOverPi = 0.63661977236758134f;
+const float TanPiOver8 = 0.41421356237309505f;
+const double DegToRadD = 0.017453292519943295;
+const double RadToDegD = 57.295779513082321;
+const double Wgs84A = 6378137.0;
+const double Wgs84F = 1.0 / 298.257223563;
+// Cody-Waite split of pi/2 for the argument reduction
+const float PiOver2Hi = 1.5707963705062866f;
+const float PiOver2Lo = -4.3711388286737929e-08f;
+
+//
+// lane types: the kernels below are written once against this small
+// interface, for plain float and for SSE2/AVX2 registers
+//
+
+inline float select(bool mask, float a, float b) { return mask ? a : b; }
+inline float vsqrt(float a) { return std::sqrt(a); }
+inline float vabs(float a) { return std::fabs(a); }
+inline float vround(float a) { return std::nearbyint(a); }
+inline float vmin(float a, float b) { return a < b ? a : b; }
+inline float vmax(float a, float b) { return a > b ? a : b; }
+inline float load(const float *p, float) { return *p; }
+inline void store(float *p, float a) { *p = a; }
+
+#if defined(GEODESY_SSE2) || defined(GEODESY_AVX2)
+struct F4 {
+    __m128 v;
+    F4() {}
+    F4(__m128 x) : v(x) {}
+    F4(float x) : v(_mm_set1_ps(x)) {}
+};
+struct M4 { __m128 v; };
+
+inline F4 operator+(F4 a, F4 b) { return _mm_add_ps(a.v, b.v); }
+inline F4 operator-(F4 a, F4 b) { return _mm_sub_ps(a.v, b.v); }
+inline F4 operator*(F4 a, F4 b) { return _mm_mul_ps(a.v, b.v); }
+inline F4 operator/(F4 a, F4 b) { return _mm_div_ps(a.v, b.v); }
+inline F4 operator-(F4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+inline M4 operator<(F4 a, F4 b) { return M4{_mm_cmplt_ps(a.v, b.v)}; }
+inline M4 operator>(F4 a, F4 b) { return M4{_mm_cmpgt_ps(a.v, b.v)}; }
+inline M4 operator==(F4 a, F4 b) { return M4{_mm_cmpeq_ps(a.v, b.v)}; }
+inline M4 operator|(M4 a, M4 b) { return M4{_mm_or_ps(a.v, b.v)}; }
+inline F4 select(M4 m, F4 a, F4 b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+inline F4 vsqrt(F4 a) { return _mm_sqrt_ps(a.v); }
+inline F4 vabs(F4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline F4 vround(F4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+inline F4 vmin(F4 a, F4 b) { return _mm_min_ps(a.v, b.v); }
+inline F4 vmax(F4 a, F4 b) { return _mm_max_ps(a.v, b.v); }
+inline F4 load(const float *p, F4) { return _mm_loadu_ps(p); }
+inline void store(float *p, F4 a) { _mm_storeu_ps(p, a.v); }
+#endif
+
+#if defined(GEODESY_AVX2)
+struct F8 {
+    __m256 v;
+    F8() {}
+    F8(__m256 x) : v(x) {}
+    F8(float x) : v(_mm256_set1_ps(x)) {}
+};
+struct M8 { __m256 v; };
+
+inline F8 operator+(F8 a, F8 b) { return _mm256_add_ps(a.v, b.v); }
+inline F8 operator-(F8 a, F8 b) { return _mm256_sub_ps(a.v, b.v); }
+inline F8 operator*(F8 a, F8 b) { return _mm256_mul_ps(a.v, b.v); }
+inline F8 operator/(F8 a, F8 b) { return _mm256_div_ps(a.v, b.v); }
+inline F8 operator-(F8 a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+inline M8 operator<(F8 a, F8 b) { return M8{_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline M8 operator>(F8 a, F8 b) { return M8{_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline M8 operator==(F8 a, F8 b) { return M8{_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+inline M8 operator|(M8 a, M8 b) { return M8{_mm256_or_ps(a.v, b.v)}; }
+inline F8 select(M8 m, F8 a, F8 b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+inline F8 vsqrt(F8 a) { return _mm256_sqrt_ps(a.v); }
+inline F8 vabs(F8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline F8 vround(F8 a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline F8 vmin(F8 a, F8 b) { return _mm256_min_ps(a.v, b.v); }
+inline F8 vmax(F8 a, F8 b) { return _mm256_max_ps(a.v, b.v); }
+inline F8 load(const float *p, F8) { return _mm256_loadu_ps(p); }
+inline void store(float *p, F8 a) { _mm256_storeu_ps(p, a.v); }
+#endif
+
+//
+// polynomial approximations (Cephes single precision coefficients)
+//
+
+template <typename V>
+inline void sincos(V x, V *s, V *c)
+{
+    // x = q * pi/2 + r, |r| <= pi/4
+    V q = vround(x * V(TwoOverPi));
+    V r = x - q * V(PiOver2Hi) - q * V(PiOver2Lo);
+    V z = r * r;
+
+    V sin_r = r + r * z * (V(-1.6666654611e-1f) + z * (V(8.3321608736e-3f) + z * V(-1.9515295891e-4f)));
+    V cos_r = V(1.0f) - V(0.5f) * z
+            + z * z * (V(4.166664568298827e-2f) + z * (V(-1.388731625493765e-3f) + z * V(2.443315711809948e-5f)));
+
+    // quadrant q mod 4
+    V q4 = vround(q * V(0.25f));
+    q4 = select(q4 * V(4.0f) > q, q4 - V(1.0f), q4);
+    V n = q - q4 * V(4.0f);
+
+    auto odd = (n == V(1.0f)) | (n == V(3.0f));
+    V sv = select(odd, cos_r, sin_r);
+    V cv = select(odd, sin_r, cos_r);
+    *s = select(n > V(1.5f), -sv, sv);
+    *c = select((n == V(1.0f)) | (n == V(2.0f)), -cv, cv);
+}
+
+template <typename V>
+inline V atan2(V y, V x)
+{
+    V ax = vabs(x);
+    V ay = vabs(y);
+    V hi = vmax(ax, ay);
+    V lo = vmin(ax, ay);
+    V t = select(hi > V(0.0f), lo / hi, V(0.0f)); // [0, 1]
+
+    // reduce to |t| <= tan(pi/8)
+    auto reduce = t > V(TanPiOver8);
+    V offset = select(reduce, V(PiOver4), V(0.0f));
+    t = select(reduce, (t - V(1.0f)) / (t + V(1.0f)), t);
+
+    V z = t * t;
+    V a = offset + t + t * z * (V(-3.33329491539e-1f)
+                                + z * (V(1.99777106478e-1f)
+                                       + z * (V(-1.38776856032e-1f) + z * V(8.05374449538e-2f))));
+
+    a = select(ay > ax, V(PiOver2) - a, a);
+    a = select(x < V(0.0f), V(Pi) - a, a);
+    return select(y < V(0.0f), -a, a);
+}
+
+//
+// kernels
+//
+
+template <typename V>
+inline V distance(V lat1, V long1, V lat2, V long2)
+{
+    V sdlong, cdlong, slat1, clat1, slat2, clat2;
+    sincos((long1 - long2) * V(DegToRad), &sdlong, &cdlong);
+    sincos(lat1 * V(DegToRad), &slat1, &clat1);
+    sincos(lat2 * V(DegToRad), &slat2, &clat2);
+
+    V a = clat1 * slat2 - slat1 * clat2 * cdlong;
+    V b = clat2 * sdlong;
+    V denom = slat1 * slat2 + clat1 * clat2 * cdlong;
+    return atan2(vsqrt(a * a + b * b), denom) * V(EarthRadius);
+}
+
+template <typename V>
+inline V course(V lat1, V long1, V lat2, V long2)
+{
+    V sdlong, cdlong, slat1, clat1, slat2, clat2;
+    sincos((long2 - long1) * V(DegToRad), &sdlong, &cdlong);
+    sincos(lat1 * V(DegToRad), &slat1, &clat1);
+    sincos(lat2 * V(DegToRad), &slat2, &clat2);
+
+    V a = atan2(sdlong * clat2, clat1 * slat2 - slat1 * clat2 * cdlong);
+    a = select(a < V(0.0f), a + V(TwoPi), a);
+    return a * V(RadToDeg);
+}
+
+template <typename V, typename Kernel>
+size_t run(Kernel kernel, size_t width, const float *lat1, const float *long1,
+           const float *lat2, const float *long2, float *out, size_t count)
+{
+    size_t i = 0;
+    for (; i + width <= count; i += width)
+        store(out + i, kernel(load(lat1 + i, V()), load(long1 + i, V()),
+                              load(lat2 + i, V()), load(long2 + i, V())));
+    return i;
+}
+
+template <typename Kernel32, typename Kernel128, typename Kernel256>
+void dispatch(Kernel32 scalar, Kernel128 sse, Kernel256 avx,
+              const float *lat1, const float *long1,
+              const float *lat2, const float *long2, float *out, size_t count)
+{
+    size_t i = 0;
+#if defined(GEODESY_AVX2)
+    i = run<F8>(avx, 8, lat1, long1, lat2, long2, out, count);
+#endif
+#if defined(GEODESY_SSE2) || defined(GEODESY_AVX2)
+    i += run<F4>(sse, 4, lat1 + i, long1 + i, lat2 + i, long2 + i, out + i, count - i);
+#endif
+    (void)sse;
+    (void)avx;
+    for (; i < count; ++i)
+        out[i] = scalar(lat1[i], long1[i], lat2[i], long2[i]);
+}
+
+} // namespace
+
+namespace geodesy {
+
+void distance_between(const float *lat1, const float *long1,
+                      const float *lat2, const float *long2,
+                      float *distance, size_t count)
+{
+    dispatch(
+        [](float a, float b, float c, float d) { return ::distance(a, b, c, d); },
+#if defined(GEODESY_SSE2) || defined(GEODESY_AVX2)
+        [](F4 a, F4 b, F4 c, F4 d) { return ::distance(a, b, c, d); },
+#else
+        nullptr,
+#endif
+#if defined(GEODESY_AVX2)
+        [](F8 a, F8 b, F8 c, F8 d) { return ::distance(a, b, c, d); },
+#else
+        nullptr,
+#endif
+        lat1, long1, lat2, long2, distance, count);
+}
+
+void course_to(const float *lat1, const float *long1,
+               const float *lat2, const float *long2,
+               float *course, size_t count)
+{
+    dispatch(
+        [](float a, float b, float c, float d) { return ::course(a, b, c, d); },
+#if defined(GEODESY_SSE2) || defined(GEODESY_AVX2)
+        [](F4 a, F4 b, F4 c, F4 d) { return ::course(a, b, c, d); },
+#else
+        nullptr,
+#endif
+#if defined(GEODESY_AVX2)
+        [](F8 a, F8 b, F8 c, F8 d) { return ::course(a, b, c, d); },
+#else
+        nullptr,
+#endif
+        lat1, long1, lat2, long2, course, count);
+}
+
+GeoPoint GeoPoint::from_degrees(double latitude, double longitude)
+{
+    GeoPoint point;
+    point.latitude = latitude;
+    point.longitude = longitude;
+    point.lambda = longitude * DegToRadD;
+    double tan_u = (1.0 - Wgs84F) * std::tan(latitude * DegToRadD);
+    point.cos_u = 1.0 / std::sqrt(1.0 + tan_u * tan_u);
+    point.sin_u = tan_u * point.cos_u;
+    return point;
+}
+
+GeoPoint GeoPoint::from_microdegrees(long latitude, long longitude)
+{
+    return from_degrees(latitude / 1000000.0, longitude / 1000000.0);
+}
+
+bool inverse(const GeoPoint &from, const GeoPoint &to,
+             double *distance, double *initial_course, double *final_course)
+{
+    const double b = Wgs84A * (1.0 - Wgs84F);
+    const double L = to.lambda - from.lambda;
+    const double sin_u1 = from.sin_u, cos_u1 = from.cos_u;
+    const double sin_u2 = to.sin_u, cos_u2 = to.cos_u;
+
+    double lambda = L, previous;
+    double sin_lambda, cos_lambda, sin_sigma, cos_sigma, sigma, cos2_alpha, cos_2sigma_m;
+    bool converged = false;
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        sin_lambda = std::sin(lambda);
+        cos_lambda = std::cos(lambda);
+        double t1 = cos_u2 * sin_lambda;
+        double t2 = cos_u1 * sin_u2 - sin_u1 * cos_u2 * cos_lambda;
+        sin_sigma = std::sqrt(t1 * t1 + t2 * t2);
+        if (sin_sigma == 0.0) {
+            // coincident points
+            if (distance) *distance = 0.0;
+            if (initial_course) *initial_course = 0.0;
+            if (final_course) *final_course = 0.0;
+            return true;
+        }
+        cos_sigma = sin_u1 * sin_u2 + cos_u1 * cos_u2 * cos_lambda;
+        sigma = std::atan2(sin_sigma, cos_sigma);
+        double sin_alpha = cos_u1 * cos_u2 * sin_lambda / sin_sigma;
+        cos2_alpha = 1.0 - sin_alpha * sin_alpha;
+        cos_2sigma_m = cos2_alpha != 0.0 ? cos_sigma - 2.0 * sin_u1 * sin_u2 / cos2_alpha : 0.0; // equatorial line
+        double C = Wgs84F / 16.0 * cos2_alpha * (4.0 + Wgs84F * (4.0 - 3.0 * cos2_alpha));
+        previous = lambda;
+        lambda = L + (1.0 - C) * Wgs84F * sin_alpha
+                * (sigma + C * sin_sigma * (cos_2sigma_m + C * cos_sigma * (-1.0 + 2.0 * cos_2sigma_m * cos_2sigma_m)));
+        if (std::fabs(lambda - previous) < 1e-12) {
+            converged = true;
+            break;
+        }
+    }
+
+    if (!converged) {
+        // nearly antipodal: spherical estimate with the mean radius
+        double s1 = std::sin(from.latitude * DegToRadD), c1 = std::cos(from.latitude * DegToRadD);
+        double s2 = std::sin(to.latitude * DegToRadD), c2 = std::cos(to.latitude * DegToRadD);
+        double a = c1 * s2 - s1 * c2 * std::cos(L);
+        double y = c2 * std::sin(L);
+        if (distance)
+            *distance = std::atan2(std::sqrt(a * a + y * y), s1 * s2 + c1 * c2 * std::cos(L)) * 6371008.8;
+        if (initial_course)
+            *initial_course = std::fmod(std::atan2(y, a) * RadToDegD + 360.0, 360.0);
+        if (final_course)
+            *final_course = std::fmod(std::atan2(c1 * std::sin(L), -s1 * c2 + c1 * s2 * std::cos(L)) * RadToDegD + 360.0, 360.0);
+        return false;
+    }
+
+    if (distance) {
+        double u2 = cos2_alpha * (Wgs84A * Wgs84A - b * b) / (b * b);
+        double A = 1.0 + u2 / 16384.0 * (4096.0 + u2 * (-768.0 + u2 * (320.0 - 175.0 * u2)));
+        double B = u2 / 1024.0 * (256.0 + u2 * (-128.0 + u2 * (74.0 - 47.0 * u2)));
+        double delta_sigma = B * sin_sigma
+                * (cos_2sigma_m + B / 4.0
+                   * (cos_sigma * (-1.0 + 2.0 * cos_2sigma_m * cos_2sigma_m)
+                      - B / 6.0 * cos_2sigma_m * (-3.0 + 4.0 * sin_sigma * sin_sigma)
+                      * (-3.0 + 4.0 * cos_2sigma_m * cos_2sigma_m)));
+        *distance = b * A * (sigma - delta_sigma);
+    }
+    if (initial_course) {
+        double a1 = std::atan2(cos_u2 * sin_lambda, cos_u1 * sin_u2 - sin_u1 * cos_u2 * cos_lambda);
+        *initial_course = std::fmod(a1 * RadToDegD + 360.0, 360.0);
+    }
+    if (final_course) {
+        double a2 = std::atan2(cos_u1 * sin_lambda, -sin_u1 * cos_u2 + cos_u1 * sin_u2 * cos_lambda);
+        *final_course = std::fmod(a2 * RadToDegD + 360.0, 360.0);
+    }
+    return true;
+}
+
+void distances_from(const GeoPoint &origin, const GeoPoint *points, double *distance, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        inverse(origin, points[i], &distance[i]);
+}
+
+const char *kernel_isa()
+{
+#if defined(GEODESY_AVX2)
+    return "avx2";
+#elif defined(GEODESY_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace geodesy
@@ -0,0 +1,301 @@
+#include "geofence.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double MetersPerMicrodegree = 6371008.8 * 3.14159265358979324 / 180.0 / 1000000.0;
+
+qint32 toMicrodegrees(const QString &text, bool *ok)
+{
+    return qint32(qRound64(text.toDouble(ok) * 1000000.0));
+}
+
+} // namespace
+
+GeofenceIndex::GeofenceIndex(qint32 cellSize)
+    : m_cellSize(cellSize > 0 ? cellSize : 10000)
+{
+}
+
+int GeofenceIndex::addFence(int id, const QString &name, const std::vector<qint32> &vertices)
+{
+    if (vertices.size() < 6 || vertices.size() % 2)
+        return -1;
+
+    Fence fence;
+    fence.id = id;
+    fence.name = name;
+    fence.first = quint32(m_vertices.size() / 2);
+    fence.count = quint32(vertices.size() / 2);
+    fence.min_lat = fence.max_lat = vertices[0];
+    fence.min_lon = fence.max_lon = vertices[1];
+    for (size_t i = 0; i < vertices.size(); i += 2) {
+        fence.min_lat = qMin(fence.min_lat, vertices[i]);
+        fence.max_lat = qMax(fence.max_lat, vertices[i]);
+        fence.min_lon = qMin(fence.min_lon, vertices[i + 1]);
+        fence.max_lon = qMax(fence.max_lon, vertices[i + 1]);
+    }
+    m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+
+    const quint32 index = quint32(m_fences.size());
+    for (qint32 latCell = cellOf(fence.min_lat); latCell <= cellOf(fence.max_lat); ++latCell)
+        for (qint32 lonCell = cellOf(fence.min_lon); lonCell <= cellOf(fence.max_lon); ++lonCell)
+            m_fenceCells.push_back(CellEntry{cellKey(latCell, lonCell), index});
+
+    m_fences.push_back(fence);
+    return int(index);
+}
+
+void GeofenceIndex::addPoi(int id, qint32 latitude, qint32 longitude, const QString &name)
+{
+    m_poiCells.push_back(CellEntry{cellKey(cellOf(latitude), cellOf(longitude)), quint32(m_pois.size())});
+    m_pois.push_back(Poi{id, latitude, longitude, name});
+}
+
+void GeofenceIndex::build()
+{
+    std::sort(m_fenceCells.begin(), m_fenceCells.end());
+    std::sort(m_poiCells.begin(), m_poiCells.end());
+
+    for (size_t i = 0; i < m_pois.size(); ++i) {
+        qint32 latCell = cellOf(m_pois[i].latitude);
+        qint32 lonCell = cellOf(m_pois[i].longitude);
+        m_poiMinLatCell = i ? qMin(m_poiMinLatCell, latCell) : latCell;
+        m_poiMaxLatCell = i ? qMax(m_poiMaxLatCell, latCell) : latCell;
+        m_poiMinLonCell = i ? qMin(m_poiMinLonCell, lonCell) : lonCell;
+        m_poiMaxLonCell = i ? qMax(m_poiMaxLonCell, lonCell) : lonCell;
+    }
+}
+
+bool GeofenceIndex::load(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QTextStream in(&file);
+    bool inFence = false;
+    int fenceId = 0;
+    QString fenceName;
+    std::vector<qint32> vertices;
+
+    for (int lineNumber = 1; !in.atEnd(); ++lineNumber) {
+        const QString line = in.readLine().section('#', 0, 0).trimmed();
+        if (line.isEmpty())
+            continue;
+
+        const QStringList fields = line.split(QRegularExpression("\\s+"));
+        bool ok = true;
+
+        if (inFence) {
+            if (fields[0] == "end") {
+                if (addFence(fenceId, fenceName, vertices) < 0)
+                    ok = false;
+                inFence = false;
+            } else if (fields.size() == 2) {
+                bool latOk, lonOk;
+                vertices.push_back(toMicrodegrees(fields[0], &latOk));
+                vertices.push_back(toMicrodegrees(fields[1], &lonOk));
+                ok = latOk && lonOk;
+            } else {
+                ok = false;
+            }
+        } else if (fields[0] == "fence" && fields.size() >= 2) {
+            fenceId = fields[1].toInt(&ok);
+            fenceName = QStringList(fields.mid(2)).join(' ');
+            vertices.clear();
+            inFence = true;
+        } else if (fields[0] == "poi" && fields.size() >= 4) {
+            bool idOk, latOk, lonOk;
+            int id = fields[1].toInt(&idOk);
+            qint32 latitude = toMicrodegrees(fields[2], &latOk);
+            qint32 longitude = toMicrodegrees(fields[3], &lonOk);
+            ok = idOk && latOk && lonOk;
+            if (ok)
+                addPoi(id, latitude, longitude, QStringList(fields.mid(4)).join(' '));
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            if (error) *error = QObject::tr("%1:%2: invalid line \"%3\"").arg(fileName).arg(lineNumber).arg(line);
+            return false;
+        }
+    }
+
+    if (inFence) {
+        if (error) *error = QObject::tr("%1: fence %2 has no \"end\"").arg(fileName).arg(fenceId);
+        return false;
+    }
+
+    build();
+    return true;
+}
+
+void GeofenceIndex::containing(qint32 latitude, qint32 longitude, std::vector<int> *fences) const
+{
+    fences->clear();
+
+    const quint64 key = cellKey(cellOf(latitude), cellOf(longitude));
+    auto it = std::lower_bound(m_fenceCells.begin(), m_fenceCells.end(), CellEntry{key, 0});
+    for (; it != m_fenceCells.end() && it->cell == key; ++it) {
+        if (contains(int(it->item), latitude, longitude))
+            fences->push_back(int(it->item));
+    }
+}
+
+// Even-odd crossing test in exact 64-bit integer arithmetic
+bool GeofenceIndex::contains(int fence, qint32 latitude, qint32 longitude) const
+{
+    const Fence &f = m_fences[size_t(fence)];
+    if (latitude < f.min_lat || latitude > f.max_lat || longitude < f.min_lon || longitude > f.max_lon)
+        return false;
+
+    const qint32 *v = &m_vertices[f.first * 2];
+    bool inside = false;
+    for (quint32 i = 0, j = f.count - 1; i < f.count; j = i++) {
+        qint64 yi = v[2 * i], xi = v[2 * i + 1];
+        qint64 yj = v[2 * j], xj = v[2 * j + 1];
+        if ((yi > latitude) != (yj > latitude)) {
+            // is the point left of the edge at this latitude?
+            qint64 lhs = (longitude - xi) * (yj - yi);
+            qint64 rhs = (xj - xi) * (latitude - yi);
+            if (yj > yi ? lhs < rhs : lhs > rhs)
+                inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// Visits rings of cells around the point until no unvisited cell can hold
+// anything closer than the k-th candidate
+void GeofenceIndex::nearest(qint32 latitude, qint32 longitude, int k, std::vector<Neighbor> *neighbors) const
+{
+    neighbors->clear();
+    if (k <= 0 || m_poiCells.empty())
+        return;
+
+    const qint32 latCell = cellOf(latitude);
+    const qint32 lonCell = cellOf(longitude);
+    // a POI r rings away is more than r - 1 cells away along one axis, and
+    // at most r + 1 cells further from the equator than the point, which
+    // bounds the cosine approxDistance() shrinks longitudes by
+    auto ringMeters = [&](qint32 ring) {
+        const double meanLatitude = std::fabs(latitude / 1000000.0) + (ring + 1) * (m_cellSize / 2000000.0);
+        return (ring - 1) * m_cellSize * MetersPerMicrodegree
+                * std::cos(qMin(90.0, meanLatitude) * 3.14159265358979324 / 180.0);
+    };
+
+    auto byDistance = [](const Neighbor &a, const Neighbor &b) { return a.distance < b.distance; };
+
+    auto visit = [&](qint32 la, qint32 lo) {
+        if (la < m_poiMinLatCell || la > m_poiMaxLatCell || lo < m_poiMinLonCell || lo > m_poiMaxLonCell)
+            return;
+        const quint64 key = cellKey(la, lo);
+        auto it = std::lower_bound(m_poiCells.begin(), m_poiCells.end(), CellEntry{key, 0});
+        for (; it != m_poiCells.end() && it->cell == key; ++it) {
+            const Poi &poi = m_pois[it->item];
+            Neighbor candidate{int(it->item), approxDistance(latitude, longitude, poi.latitude, poi.longitude)};
+            if (int(neighbors->size()) < k) {
+                neighbors->push_back(candidate);
+                std::push_heap(neighbors->begin(), neighbors->end(), byDistance);
+            } else if (candidate.distance < neighbors->front().distance) {
+                std::pop_heap(neighbors->begin(), neighbors->end(), byDistance);
+                neighbors->back() = candidate;
+                std::push_heap(neighbors->begin(), neighbors->end(), byDistance);
+            }
+        }
+    };
+
+    // rings beyond this one hold no POIs
+    const qint32 lastRing = qMax(qMax(qAbs(latCell - m_poiMinLatCell), qAbs(m_poiMaxLatCell - latCell)),
+                                 qMax(qAbs(lonCell - m_poiMinLonCell), qAbs(m_poiMaxLonCell - lonCell)));
+    const double cellMeters = m_cellSize * MetersPerMicrodegree;
+
+    for (qint32 ring = 0; ring <= lastRing; ++ring) {
+        // near the poles the longitude bound stays small for many rings;
+        // rows further along the meridian than the k-th candidate are skipped
+        qint32 rows = ring;
+        if (int(neighbors->size()) == k) {
+            const double distance = neighbors->front().distance;
+            if (distance <= ringMeters(ring))
+                break;
+            rows = qint32(qMin(double(ring), distance / cellMeters + 1.0));
+        }
+
+        if (ring == 0) {
+            visit(latCell, lonCell);
+            continue;
+        }
+        if (rows == ring) {
+            for (qint32 d = -ring; d <= ring; ++d) {
+                visit(latCell - ring, lonCell + d);
+                visit(latCell + ring, lonCell + d);
+            }
+        }
+        const qint32 side = qMin(rows, ring - 1);
+        for (qint32 d = -side; d <= side; ++d) {
+            visit(latCell + d, lonCell - ring);
+            visit(latCell + d, lonCell + ring);
+        }
+    }
+
+    std::sort_heap(neighbors->begin(), neighbors->end(), byDistance);
+}
+
+qint32 GeofenceIndex::cellOf(qint32 value) const
+{
+    return value >= 0 ? value / m_cellSize : -((-qint64(value) + m_cellSize - 1) / m_cellSize);
+}
+
+quint64 GeofenceIndex::cellKey(qint32 latCell, qint32 lonCell)
+{
+    return (quint64(quint32(latCell)) << 32) | quint32(lonCell);
+}
+
+// Equirectangular approximation; within 0.1% below a few hundred kilometers
+double GeofenceIndex::approxDistance(qint32 lat1, qint32 lon1, qint32 lat2, qint32 lon2)
+{
+    double meanLat = (double(lat1) + lat2) / 2.0 / 1000000.0 * 3.14159265358979324 / 180.0;
+    double dx = (double(lon2) - lon1) * std::cos(meanLat);
+    double dy = double(lat2) - lat1;
+    return std::sqrt(dx * dx + dy * dy) * MetersPerMicrodegree;
+}
+
+GeofenceMonitor::GeofenceMonitor(const GeofenceIndex *index, QObject *parent)
+    : QObject(parent)
+    , m_index(index)
+{
+}
+
+void GeofenceMonitor::update(const GpsFix &fix)
+{
+    if (!fix.has(GpsFix::VALID_POSITION))
+        return;
+
+    m_index->containing(fix.latitude, fix.longitude, &m_current);
+
+    // both lists are sorted: walk them together
+    auto previous = m_inside.begin();
+    auto current = m_current.begin();
+    while (previous != m_inside.end() || current != m_current.end()) {
+        if (current == m_current.end() || (previous != m_inside.end() && *previous < *current)) {
+            emit exited(*previous++, fix);
+        } else if (previous == m_inside.end() || *current < *previous) {
+            emit entered(*current++, fix);
+        } else {
+            ++previous;
+            ++current;
+        }
+    }
+
+    m_inside.swap(m_current);
+}
@@ -0,0 +1,115 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <QObject>
+#include <QString>
+
+#include <vector>
+
+#include "gpsfix.h"
+
+// Geofence polygons and points of interest in a flat grid index.
+//
+// Coordinates are microdegrees, as returned by TinyGPS::get_position(). The
+// plane is cut into square cells; every polygon is listed under each cell its
+// bounding box touches and every POI under its own cell. Both lists are sorted
+// (cell, item) arrays, so a query is a binary search plus a short scan over
+// contiguous memory. Polygons must not cross the antimeridian.
+class GeofenceIndex
+{
+public:
+    struct Poi {
+        int id;
+        qint32 latitude;
+        qint32 longitude;
+        QString name;
+    };
+
+    struct Neighbor {
+        int poi;            // index into pois()
+        double distance;    // meters
+    };
+
+    // cellSize in microdegrees; 10000 (0.01 degree, ~1.1 km) suits city-scale fences
+    explicit GeofenceIndex(qint32 cellSize = 10000);
+
+    // vertices as latitude, longitude pairs; the ring is closed implicitly
+    int addFence(int id, const QString &name, const std::vector<qint32> &vertices);
+    void addPoi(int id, qint32 latitude, qint32 longitude, const QString &name);
+
+    // sorts the cell lists; call after adding and before querying
+    void build();
+
+    // Text format, one record per line, '#' starts a comment:
+    //   fence <id> <name>      followed by "<lat> <lon>" lines in decimal degrees
+    //   end
+    //   poi <id> <lat> <lon> <name>
+    bool load(const QString &fileName, QString *error = nullptr);
+
+    int fenceCount() const { return int(m_fences.size()); }
+    int fenceId(int fence) const { return m_fences[size_t(fence)].id; }
+    const QString &fenceName(int fence) const { return m_fences[size_t(fence)].name; }
+    const std::vector<Poi> &pois() const { return m_pois; }
+
+    // indexes of the fences containing the point, ascending
+    void containing(qint32 latitude, qint32 longitude, std::vector<int> *fences) const;
+    bool contains(int fence, qint32 latitude, qint32 longitude) const;
+
+    // the k POIs closest to the point, nearest first
+    void nearest(qint32 latitude, qint32 longitude, int k, std::vector<Neighbor> *neighbors) const;
+
+private:
+    struct Fence {
+        int id;
+        QString name;
+        quint32 first;      // into m_vertices, in points
+        quint32 count;
+        qint32 min_lat, min_lon, max_lat, max_lon;
+    };
+
+    struct CellEntry {
+        quint64 cell;
+        quint32 item;
+        bool operator<(const CellEntry &other) const
+        {
+            return cell < other.cell || (cell == other.cell && item < other.item);
+        }
+    };
+
+    qint32 cellOf(qint32 value) const;
+    static quint64 cellKey(qint32 latCell, qint32 lonCell);
+    static double approxDistance(qint32 lat1, qint32 lon1, qint32 lat2, qint32 lon2);
+
+    const qint32 m_cellSize;
+    std::vector<Fence> m_fences;
+    std::vector<qint32> m_vertices;     // lat, lon, lat, lon...
+    std::vector<CellEntry> m_fenceCells;
+    std::vector<Poi> m_pois;
+    std::vector<CellEntry> m_poiCells;
+    qint32 m_poiMinLatCell = 0, m_poiMaxLatCell = -1;
+    qint32 m_poiMinLonCell = 0, m_poiMaxLonCell = -1;
+};
+
+// Tracks which fences a receiver is inside and reports the changes
+class GeofenceMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GeofenceMonitor(const GeofenceIndex *index, QObject *parent = nullptr);
+
+    // feed every new fix; fixes without a position are ignored
+    void update(const GpsFix &fix);
+
+    const std::vector<int> &inside() const { return m_inside; }
+
+signals:
+    void entered(int fence, const GpsFix &fix);
+    void exited(int fence, const GpsFix &fix);
+
+private:
+    const GeofenceIndex *m_index;
+    std::vector<int> m_inside;
+    std::vector<int> m_current;
+};
+
+#endif // GEOFENCE_H
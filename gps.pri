@@ -0,0 +1,24 @@
+# Parser and geodesy core, shared by GPS.pro, tests/, bench/ and sim/
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/tinygps.cpp \
+    $$PWD/geodesy.cpp \
+    $$PWD/latency.cpp \
+    $$PWD/trackfilter.cpp
+
+HEADERS += \
+    $$PWD/tinygps.h \
+    $$PWD/basictinygps.h \
+    $$PWD/gpsglobal.h \
+    $$PWD/nmeascan.h \
+    $$PWD/nmeanum.h \
+    $$PWD/gpsfix.h \
+    $$PWD/seqlock.h \
+    $$PWD/geodesy.h \
+    $$PWD/latency.h \
+    $$PWD/gpsstats.h \
+    $$PWD/gpstime.h \
+    $$PWD/trackfilter.h
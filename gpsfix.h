@@ -0,0 +1,45 @@
+#ifndef GPSFIX_H
+#define GPSFIX_H
+
+#include "gpsglobal.h"
+
+// Plain snapshot of the fields TinyGPS keeps for the last validated sentences.
+// Units follow the TinyGPS accessors; check `valid` before using a field.
+struct GpsFix
+{
+    enum {
+        VALID_POSITION   = 0x01,
+        VALID_TIME       = 0x02,
+        VALID_DATE       = 0x04,
+        VALID_SPEED      = 0x08,
+        VALID_COURSE     = 0x10,
+        VALID_ALTITUDE   = 0x20,
+        VALID_HDOP       = 0x40,
+        VALID_SATELLITES = 0x80
+    };
+
+    qint32 latitude;        // millionths of a degree
+    qint32 longitude;       // millionths of a degree
+    quint32 time;           // hhmmsscc
+    quint32 date;           // ddmmyy
+    quint32 speed;          // 100ths of a knot
+    quint32 course;         // 100ths of a degree
+    qint32 altitude;        // centimeters
+    quint32 hdop;           // 100ths
+    quint8 satellites;
+    quint8 talker;          // TinyGPS::GPS_TALKER_* of the last sentence
+    quint8 sentence_type;   // TinyGPS::GPS_SENTENCE_* of the last sentence
+    quint8 valid;           // VALID_* bits
+    quint64 published_ns;   // gps_clock_ns() when published to a channel, 0 if never
+    qint64 epoch_ms;        // UTC milliseconds since 1970 of date and time, 0 if either is unknown
+
+    bool has(quint8 bits) const { return (valid & bits) == bits; }
+};
+
+#ifndef GPS_NO_QT
+#include <QMetaType>
+// for queued fixUpdated() connections
+Q_DECLARE_METATYPE(GpsFix)
+#endif
+
+#endif // GPSFIX_H
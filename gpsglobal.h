@@ -0,0 +1,22 @@
+#ifndef GPSGLOBAL_H
+#define GPSGLOBAL_H
+
+// Integer types used by the parser core (basictinygps.h and the headers it
+// includes). Define GPS_NO_QT to build the core from the standard library
+// alone, e.g. on a target without QtCore.
+#ifdef GPS_NO_QT
+#include <cstdint>
+
+typedef int8_t qint8;
+typedef uint8_t quint8;
+typedef int16_t qint16;
+typedef uint16_t quint16;
+typedef int32_t qint32;
+typedef uint32_t quint32;
+typedef long long qint64;
+typedef unsigned long long quint64;
+#else
+#include <QtGlobal>
+#endif
+
+#endif // GPSGLOBAL_H
@@ -0,0 +1,318 @@
+#include "gpshub.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QtDebug>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+speed_t baudConstant(qint32 baudRate)
+{
+    switch (baudRate) {
+    case 4800: return B4800;
+    case 9600: return B9600;
+    case 19200: return B19200;
+    case 38400: return B38400;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B0;
+    }
+}
+
+} // namespace
+
+bool ReceiverConfig::fromSpec(const QString &spec, ReceiverConfig *config)
+{
+    const QStringList parts = spec.split(QRegularExpression("[\\s:]+"), Qt::SkipEmptyParts);
+    if (parts.isEmpty() || parts.size() > 3)
+        return false;
+
+    ReceiverConfig result;
+    result.name = parts[0];
+
+    if (parts.size() > 1) {
+        bool ok;
+        result.baudRate = parts[1].toInt(&ok);
+        if (!ok || baudConstant(result.baudRate) == B0)
+            return false;
+    }
+
+    if (parts.size() > 2) {
+        const QString framing = parts[2].toUpper();
+        if (framing.size() != 3 || framing[0] < '5' || framing[0] > '8'
+                || !QString("NEO").contains(framing[1]) || (framing[2] != '1' && framing[2] != '2'))
+            return false;
+        result.dataBits = quint8(framing[0].digitValue());
+        result.parity = framing[1].toLatin1();
+        result.stopBits = quint8(framing[2].digitValue());
+    }
+
+    *config = result;
+    return true;
+}
+
+QVector<ReceiverConfig> ReceiverConfig::fromFile(const QString &fileName, QString *error)
+{
+    QVector<ReceiverConfig> receivers;
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return receivers;
+    }
+
+    QTextStream in(&file);
+    for (int lineNumber = 1; !in.atEnd(); ++lineNumber) {
+        const QString line = in.readLine().section('#', 0, 0).trimmed();
+        if (line.isEmpty())
+            continue;
+
+        ReceiverConfig config;
+        if (!fromSpec(line, &config)) {
+            if (error) *error = QObject::tr("%1:%2: invalid receiver \"%3\"").arg(fileName).arg(lineNumber).arg(line);
+            return QVector<ReceiverConfig>();
+        }
+        receivers.append(config);
+    }
+
+    return receivers;
+}
+
+GpsHub::GpsHub(const QVector<ReceiverConfig> &receivers, int workers, QObject *parent)
+    : QObject(parent)
+    , m_receivers(size_t(receivers.size()))
+    , m_workerCount(workers > 0 ? workers : qBound(1, QThread::idealThreadCount(), 4))
+{
+    qRegisterMetaType<GpsFix>();
+
+    for (int i = 0; i < receivers.size(); ++i) {
+        Receiver &receiver = m_receivers[size_t(i)];
+        receiver.hub = this;
+        receiver.index = i;
+        receiver.config = receivers[i];
+        receiver.gps.set_fix_channel(&receiver.fix);
+        receiver.gps.set_rollover_floor(gpstime::LastRolloverMs);
+        receiver.gps.set_fix_callback(&GpsHub::handleFix, &receiver);
+    }
+}
+
+GpsHub::~GpsHub()
+{
+    stop();
+}
+
+bool GpsHub::start()
+{
+    if (!m_workers.empty())
+        return true;
+
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        emit errorOccurred(tr("eventfd: %1").arg(qt_error_string(errno)));
+        return false;
+    }
+
+    const int workerCount = qMin(m_workerCount, qMax(1, receiverCount()));
+    for (int i = 0; i < workerCount; ++i) {
+        int epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            emit errorOccurred(tr("epoll_create1: %1").arg(qt_error_string(errno)));
+            stop();
+            return false;
+        }
+        m_epollFds.push_back(epollFd);
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr; // the wake-up eventfd
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, m_wakeFd, &event);
+    }
+
+    // round-robin the ports over the workers
+    int opened = 0;
+    for (size_t i = 0; i < m_receivers.size(); ++i) {
+        Receiver *receiver = &m_receivers[i];
+        if (!openReceiver(receiver))
+            continue;
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = receiver;
+        if (epoll_ctl(m_epollFds[i % m_epollFds.size()], EPOLL_CTL_ADD, receiver->fd, &event) < 0) {
+            emit errorOccurred(tr("%1: epoll_ctl: %2").arg(receiver->config.name).arg(qt_error_string(errno)));
+            ::close(receiver->fd);
+            receiver->fd = -1;
+            continue;
+        }
+        ++opened;
+    }
+
+    for (int epollFd : m_epollFds) {
+        std::unique_ptr<Worker> worker(new Worker(this, epollFd));
+        worker->setObjectName("gps-hub");
+        worker->start(QThread::HighPriority);
+        m_workers.push_back(std::move(worker));
+    }
+
+    qDebug() << "Portas abertas" << opened << "de" << receiverCount();
+    return opened > 0;
+}
+
+void GpsHub::stop()
+{
+    if (m_wakeFd >= 0) {
+        quint64 one = 1;
+        if (::write(m_wakeFd, &one, sizeof(one)) < 0)
+            qDebug() << "eventfd write failed";
+    }
+    for (auto &worker : m_workers)
+        worker->wait();
+    m_workers.clear();
+
+    for (int epollFd : m_epollFds)
+        ::close(epollFd);
+    m_epollFds.clear();
+
+    for (Receiver &receiver : m_receivers) {
+        if (receiver.fd >= 0) {
+            ::close(receiver.fd);
+            receiver.fd = -1;
+        }
+    }
+
+    if (m_wakeFd >= 0) {
+        ::close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+GpsHub::ReceiverStats GpsHub::stats(int receiver) const
+{
+    const Receiver &r = m_receivers[receiver];
+    ReceiverStats stats;
+    stats.bytes = r.bytes.load(std::memory_order_relaxed);
+    stats.sentences = r.sentences.load(std::memory_order_relaxed);
+    stats.open = r.fd >= 0;
+    return stats;
+}
+
+bool GpsHub::estimate(int receiver, quint64 atNs, TrackFilter::Estimate *estimate) const
+{
+    return m_trackFilter.predict(m_receivers[receiver].track.load(), atNs, estimate);
+}
+
+void GpsHub::estimates(quint64 atNs, TrackFilter::Estimate *estimates) const
+{
+    for (size_t i = 0; i < m_receivers.size(); ++i)
+        m_trackFilter.predict(m_receivers[i].track.load(), atNs, &estimates[i]);
+}
+
+GpsStats GpsHub::parserStats(int receiver) const
+{
+    GpsStats stats = {};
+#ifndef GPS_NO_STATS
+    m_receivers[receiver].gps.stats(&stats);
+#endif
+    return stats;
+}
+
+bool GpsHub::openReceiver(Receiver *receiver)
+{
+    const ReceiverConfig &config = receiver->config;
+    int fd = ::open(config.name.toLocal8Bit().constData(), O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        emit errorOccurred(tr("%1: %2").arg(config.name).arg(qt_error_string(errno)));
+        return false;
+    }
+
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, baudConstant(config.baudRate));
+        cfsetospeed(&tio, baudConstant(config.baudRate));
+
+        tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CSTOPB);
+        switch (config.dataBits) {
+        case 5: tio.c_cflag |= CS5; break;
+        case 6: tio.c_cflag |= CS6; break;
+        case 7: tio.c_cflag |= CS7; break;
+        default: tio.c_cflag |= CS8; break;
+        }
+        if (config.parity == 'E')
+            tio.c_cflag |= PARENB;
+        else if (config.parity == 'O')
+            tio.c_cflag |= PARENB | PARODD;
+        if (config.stopBits == 2)
+            tio.c_cflag |= CSTOPB;
+        tio.c_cflag |= CREAD | CLOCAL;
+
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    // not a tty (pipe, fifo): read it as is
+
+    receiver->fd = fd;
+    return true;
+}
+
+// Worker thread: waits on its epoll set and feeds each ready port to its parser
+void GpsHub::poll(int epollFd)
+{
+    epoll_event events[64];
+    char buffer[4096];
+
+    for (;;) {
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            Receiver *receiver = static_cast<Receiver *>(events[i].data.ptr);
+            if (!receiver)
+                return; // stop() woke us up
+
+            for (;;) {
+                ssize_t n = ::read(receiver->fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    int sentences = receiver->gps.encode(buffer, size_t(n));
+                    receiver->bytes.store(receiver->bytes.load(std::memory_order_relaxed) + quint64(n),
+                                          std::memory_order_relaxed);
+                    if (sentences)
+                        receiver->sentences.store(receiver->sentences.load(std::memory_order_relaxed) + quint64(sentences),
+                                                  std::memory_order_relaxed);
+                    if (size_t(n) < sizeof(buffer))
+                        break;
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    // EAGAIN: drained; 0 or error: port gone, stop watching it
+                    if (n == 0 || errno != EAGAIN)
+                        epoll_ctl(epollFd, EPOLL_CTL_DEL, receiver->fd, nullptr);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Parser callback, on the worker that owns the receiver
+void GpsHub::handleFix(const GpsFix &fix, void *context)
+{
+    Receiver *receiver = static_cast<Receiver *>(context);
+    receiver->hub->m_trackFilter.update(&receiver->trackState, fix, fix.published_ns);
+    receiver->track.store(receiver->trackState);
+    emit receiver->hub->fixUpdated(receiver->index, fix);
+}
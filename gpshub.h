@@ -0,0 +1,107 @@
+#ifndef GPSHUB_H
+#define GPSHUB_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "tinygps.h"
+#include "trackfilter.h"
+
+// One serial receiver: device name, baud rate and framing such as "8N1"
+struct ReceiverConfig
+{
+    QString name;
+    qint32 baudRate = 9600;
+    quint8 dataBits = 8;
+    char parity = 'N';  // N, E or O
+    quint8 stopBits = 1;
+
+    // "/dev/ttyUSB0:115200:8N1"; baud and framing are optional
+    static bool fromSpec(const QString &spec, ReceiverConfig *config);
+    // one spec per line, whitespace or ':' separated, '#' starts a comment
+    static QVector<ReceiverConfig> fromFile(const QString &fileName, QString *error = nullptr);
+};
+
+// Reads many serial receivers from one process. Ports are spread over a small
+// pool of worker threads, each waiting on its own epoll set, and every port
+// has its own parser state and fix channel.
+class GpsHub : public QObject
+{
+    Q_OBJECT
+public:
+    struct ReceiverStats {
+        quint64 bytes;
+        quint64 sentences;
+        bool open;
+    };
+
+    explicit GpsHub(const QVector<ReceiverConfig> &receivers, int workers = 0, QObject *parent = nullptr);
+    ~GpsHub();
+
+    bool start();
+    void stop();
+
+    int receiverCount() const { return int(m_receivers.size()); }
+    const ReceiverConfig &config(int receiver) const { return m_receivers[receiver].config; }
+
+    // safe to call from any thread
+    GpsFix fix(int receiver) const { return m_receivers[receiver].fix.load(); }
+    // smoothed position at atNs, dead-reckoned from the receiver's fixes
+    bool estimate(int receiver, quint64 atNs, TrackFilter::Estimate *estimate) const;
+    // all receivers at once, estimates[receiverCount()]
+    void estimates(quint64 atNs, TrackFilter::Estimate *estimates) const;
+    ReceiverStats stats(int receiver) const;
+    GpsStats parserStats(int receiver) const;
+
+signals:
+    void errorOccurred(const QString &message);
+    // a sentence from receiver was validated; emitted from its worker thread
+    void fixUpdated(int receiver, const GpsFix &fix);
+
+private:
+    // per-receiver state, written only by the worker that owns the port;
+    // kept in one contiguous array, cache-line aligned so neighbouring
+    // receivers never share a line
+    struct alignas(64) Receiver {
+        GpsHub *hub = nullptr;
+        int index = 0;
+        ReceiverConfig config;
+        int fd = -1;
+        TinyGPS gps;
+        SeqLock<GpsFix> fix;
+        TrackFilter::State trackState = TrackFilter::initial_state();
+        SeqLock<TrackFilter::State> track;
+        std::atomic<quint64> bytes{0};
+        std::atomic<quint64> sentences{0};
+    };
+
+    class Worker : public QThread
+    {
+    public:
+        Worker(GpsHub *hub, int epollFd) : m_hub(hub), m_epollFd(epollFd) {}
+    protected:
+        void run() override { m_hub->poll(m_epollFd); }
+    private:
+        GpsHub *m_hub;
+        int m_epollFd;
+    };
+
+    static void handleFix(const GpsFix &fix, void *context);
+    bool openReceiver(Receiver *receiver);
+    void poll(int epollFd);
+
+    TrackFilter m_trackFilter;
+    std::vector<Receiver> m_receivers; // never resized after construction
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<int> m_epollFds;
+    int m_wakeFd = -1;
+    int m_workerCount;
+};
+
+#endif // GPSHUB_H
@@ -0,0 +1,57 @@
+#ifndef GPSSTATS_H
+#define GPSSTATS_H
+
+#include "gpsglobal.h"
+
+#define GPS_STATS_SENTENCE_TYPES 10 // TinyGPS::GPS_SENTENCE_OTHER + 1
+#define GPS_STATS_TALKERS        7  // TinyGPS::GPS_TALKER_OTHER + 1
+
+// 64-bit counter written by the parsing thread only and read from any thread.
+// Loads and stores are relaxed atomics; the struct stays trivially copyable.
+struct GpsCounter
+{
+    quint64 value;
+
+    quint64 load() const
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __atomic_load_n(&value, __ATOMIC_RELAXED);
+#else
+        return *static_cast<const volatile quint64 *>(&value);
+#endif
+    }
+
+    void store(quint64 v)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __atomic_store_n(&value, v, __ATOMIC_RELAXED);
+#else
+        *static_cast<volatile quint64 *>(&value) = v;
+#endif
+    }
+
+    // single writer, so a load/store pair is enough
+    void add(quint64 n = 1) { store(value + n); }
+};
+
+// Parser counters at one point in time, see TinyGPS::stats()
+struct GpsStats
+{
+    quint64 chars;              // characters encoded
+    quint64 passed_checksum;    // sentences and UBX frames whose checksum matched, any type,
+                                // and sentences accepted without one
+    quint64 good_sentences;     // ... that were also of a known type and valid
+    quint64 failed_checksum;
+    quint64 term_overflows;     // sentences dropped for a term longer than the term buffer
+    quint64 framing_errors;     // sentences cut short by '$'
+    quint64 missing_checksum;   // sentences ended without '*hh', accepted or not
+    quint64 malformed_checksum; // '*' not followed by exactly two hex digits
+    quint64 oversized_sentences; // longer than the maximum sentence length
+    quint64 illegal_characters; // sentences dropped for a control or non-ASCII byte
+    quint64 dropped_bytes;      // characters skipped outside sentences, rest of dropped ones included
+    quint64 sentences[GPS_STATS_SENTENCE_TYPES];    // passed checksum, by GPS_SENTENCE_*
+    quint64 talkers[GPS_STATS_TALKERS];             // passed checksum, by GPS_TALKER_*
+    double sentences_per_second;                    // good sentences, last full second
+};
+
+#endif // GPSSTATS_H
@@ -0,0 +1,104 @@
+#ifndef GPSTIME_H
+#define GPSTIME_H
+
+#include "gpsglobal.h"
+
+// UTC calendar arithmetic for the parser: NMEA ddmmyy dates and hhmmsscc
+// times to Unix epoch milliseconds, with no library calls and no divisions
+// other than by constants.
+//
+// Century: RMC carries two-digit years, taken as 1980-2079 since GPS time
+// starts in 1980. ZDA carries all four digits and wins whenever its last two
+// match the date's.
+//
+// GPS week rollover: the navigation message counts weeks modulo 1024, about
+// 19.6 years, and receivers with old firmware map dates past a rollover back
+// by 1024 weeks (2019-04-07 comes out as 1999-08-22). Given a rollover floor,
+// dates before it are moved forward by 1024 weeks until they are not. Live
+// receivers can use the last rollover, LastRolloverMs; replays of old logs
+// should not set a floor.
+namespace gpstime {
+
+const int YearPivot = 80;                   // 80-99 are 1980-1999, 00-79 are 2000-2079
+const qint64 MsPerDay = 86400000;
+const qint64 DaysPerRollover = 1024 * 7;
+const qint64 LastRolloverMs = 17993 * MsPerDay; // 2019-04-07
+
+// days before the first of each month of a year starting in March, so that
+// the leap day is the last day of the year
+const quint16 DaysBeforeMonth[12] = {0, 31, 61, 92, 122, 153, 184, 214, 245, 275, 306, 337};
+
+inline int full_year(int two_digits)
+{
+    return two_digits + (two_digits < YearPivot ? 2000 : 1900);
+}
+
+inline unsigned days_in_month(int year, unsigned month)
+{
+    static const quint8 Days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return Days[month - 1] + (month == 2 && leap);
+}
+
+// days since 1970-01-01 of a proleptic Gregorian date, any year
+inline qint64 days_from_civil(int year, unsigned month, unsigned day)
+{
+    year -= month <= 2; // January and February end the previous March-based year
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = unsigned(year - era * 400);
+    const unsigned day_of_year = DaysBeforeMonth[(month + 9) % 12] + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return qint64(era) * 146097 + day_of_era - 719468;
+}
+
+// the inverse of days_from_civil()
+inline void civil_from_days(qint64 days, int *year, unsigned *month, unsigned *day)
+{
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned day_of_era = unsigned(days - era * 146097);
+    const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned mp = (5 * day_of_year + 2) / 153; // March-based month
+    *day = day_of_year - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = int(year_of_era + era * 400) + (*month <= 2);
+}
+
+// days since 1970 of a ddmmyy date under the century and rollover policy
+// above; zda_year is the four-digit year or 0, floor_days 0 for no floor.
+// False for an impossible date.
+inline bool date_days(quint32 ddmmyy, int zda_year, qint64 floor_days, qint64 *days)
+{
+    const unsigned day = ddmmyy / 10000;
+    const unsigned month = ddmmyy / 100 % 100;
+    const int two_digits = int(ddmmyy % 100);
+    if (month - 1 >= 12 || day - 1 >= 31)
+        return false;
+
+    const bool use_zda = zda_year > 0 && zda_year <= 9999 && zda_year % 100 == two_digits;
+    const int year = use_zda ? zda_year : full_year(two_digits);
+    if (day > days_in_month(year, month))
+        return false;
+    qint64 result = days_from_civil(year, month, day);
+    if (result < floor_days)
+        result += (floor_days - result + DaysPerRollover - 1) / DaysPerRollover * DaysPerRollover;
+    *days = result;
+    return true;
+}
+
+// milliseconds since midnight of an hhmmsscc time, -1 if impossible; second
+// 60 is a leap second
+inline qint64 ms_of_day(quint32 hhmmsscc)
+{
+    const unsigned hours = hhmmsscc / 1000000;
+    const unsigned minutes = hhmmsscc / 10000 % 100;
+    const unsigned seconds = hhmmsscc / 100 % 100;
+    if (hours >= 24 || minutes >= 60 || seconds > 60)
+        return -1;
+    return qint64((hours * 60 + minutes) * 60 + seconds) * 1000 + hhmmsscc % 100 * 10;
+}
+
+} // namespace gpstime
+
+#endif // GPSTIME_H
@@ -0,0 +1,103 @@
+#include "latency.h"
+
+#ifndef GPS_NO_QT
+#include <QtAlgorithms>
+#endif
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(quint64 ns)
+{
+    m_buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+
+    quint64 max = m_max.load(std::memory_order_relaxed);
+    while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const
+{
+    quint64 count = this->count();
+    return count ? double(m_sum.load(std::memory_order_relaxed)) / count : 0.0;
+}
+
+quint64 LatencyHistogram::percentile(double quantile) const
+{
+    quint64 count = this->count();
+    if (!count)
+        return 0;
+
+    quint64 rank = quint64(quantile * count + 0.5);
+    if (rank < 1) rank = 1;
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += m_buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return bucketLimit(bucket) < max() ? bucketLimit(bucket) : max();
+    }
+    return max();
+}
+
+#ifndef GPS_NO_QT
+QString LatencyHistogram::summary() const
+{
+    return QString("count=%1 mean=%2 p50=%3 p90=%4 p99=%5 p99.9=%6 max=%7 (us)")
+            .arg(count())
+            .arg(mean() / 1000.0, 0, 'f', 1)
+            .arg(percentile(0.5) / 1000.0, 0, 'f', 1)
+            .arg(percentile(0.9) / 1000.0, 0, 'f', 1)
+            .arg(percentile(0.99) / 1000.0, 0, 'f', 1)
+            .arg(percentile(0.999) / 1000.0, 0, 'f', 1)
+            .arg(max() / 1000.0, 0, 'f', 1);
+}
+#endif
+
+// values below 16 map to themselves; above, the top 5 significant bits pick
+// the bucket within each power of two
+int LatencyHistogram::bucketOf(quint64 ns)
+{
+    if (ns < SubBuckets)
+        return int(ns);
+
+#ifdef GPS_NO_QT
+    int msb = 63 - __builtin_clzll(ns);
+#else
+    int msb = 63 - int(qCountLeadingZeroBits(ns));
+#endif
+    int bucket = (msb - 3) * SubBuckets + int((ns >> (msb - 4)) & (SubBuckets - 1));
+    return bucket < BucketCount ? bucket : BucketCount - 1;
+}
+
+quint64 LatencyHistogram::bucketLimit(int bucket)
+{
+    if (bucket < SubBuckets)
+        return quint64(bucket);
+
+    int msb = bucket / SubBuckets + 3;
+    quint64 sub = quint64(bucket % SubBuckets);
+    return ((SubBuckets + sub + 1) << (msb - 4)) - 1;
+}
+
+#ifndef GPS_NO_QT
+QString GpsLatency::dump() const
+{
+    return QString("read->parse    %1\nparse->publish %2\nfix age        %3\n")
+            .arg(read_to_parse.summary())
+            .arg(parse_to_publish.summary())
+            .arg(fix_age.summary());
+}
+#endif
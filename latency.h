@@ -0,0 +1,77 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#ifndef GPS_NO_QT
+#include <QString>
+#endif
+
+#include <atomic>
+#include <chrono>
+
+#include "gpsfix.h"
+#include "gpsglobal.h"
+
+// steady clock used for every timestamp in the pipeline, in nanoseconds
+inline quint64 gps_clock_ns()
+{
+    return quint64(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Log-linear latency histogram in the spirit of HdrHistogram: each power of
+// two is split into 16 buckets, so any recorded value is reported within
+// 6.25%. Covers 1 ns to about 18 minutes; larger values land in the last
+// bucket. record() is wait-free and may be called from any thread.
+class LatencyHistogram
+{
+public:
+    enum { SubBuckets = 16, MaxExponent = 40, BucketCount = (MaxExponent - 3) * SubBuckets };
+
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void record(quint64 ns);
+    void reset();
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    quint64 max() const { return m_max.load(std::memory_order_relaxed); }
+    double mean() const;
+    // upper edge of the bucket holding the given quantile (0..1), in ns
+    quint64 percentile(double quantile) const;
+
+#ifndef GPS_NO_QT
+    // "count=... mean=... p50=... p90=... p99=... p99.9=... max=..." in microseconds
+    QString summary() const;
+#endif
+
+private:
+    static int bucketOf(quint64 ns);
+    static quint64 bucketLimit(int bucket);
+
+    std::atomic<quint64> m_buckets[BucketCount];
+    std::atomic<quint64> m_count;
+    std::atomic<quint64> m_sum;
+    std::atomic<quint64> m_max;
+};
+
+// Latencies of one receiver pipeline
+struct GpsLatency
+{
+    LatencyHistogram read_to_parse;     // chunk read from the port -> sentence validated
+    LatencyHistogram parse_to_publish;  // sentence validated -> fix published
+    LatencyHistogram fix_age;           // fix published -> read by a consumer
+
+    // call when a consumer takes a fix
+    void record_fix_age(const GpsFix &fix)
+    {
+        if (fix.published_ns)
+            fix_age.record(gps_clock_ns() - fix.published_ns);
+    }
+
+#ifndef GPS_NO_QT
+    QString dump() const;
+#endif
+};
+
+#endif // LATENCY_H
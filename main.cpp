@@ -1,15 +1,272 @@
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QTimer>
 #include <QtDebug>
 
+#include <memory>
+
+#include "nmeacapture.h"
+#include "nmeareplay.h"
+#include "receiverconfigurator.h"
 #include "serialport.h"
+#include "statsexporter.h"
 #include "tinygps.h"
+#include "trackformat.h"
+#ifdef Q_OS_LINUX
+#include "gpshub.h"
+#endif
+
+static bool startMetrics(const QCommandLineParser &parser, GpsStatsExporter *exporter)
+{
+    QString error;
+    if (parser.isSet("metrics-file") && !exporter->writeFile(parser.value("metrics-file"), 10000, &error)) {
+        qDebug() << error;
+        return false;
+    }
+    if (parser.isSet("metrics-socket") && !exporter->listen(parser.value("metrics-socket"), &error)) {
+        qDebug() << error;
+        return false;
+    }
+    QObject::connect(exporter, &GpsStatsExporter::errorOccurred, [](const QString &message) { qDebug() << message; });
+    return true;
+}
 
+static void printFixes(const std::vector<GpsFix> &fixes)
+{
+    QTextStream out(stdout);
+    out << "date,time,latitude,longitude,altitude,speed,course,hdop,satellites,epoch_ms\n";
+    for (const GpsFix &fix : fixes) {
+        out << fix.date << ',' << fix.time << ','
+            << fix.latitude << ',' << fix.longitude << ','
+            << (fix.has(GpsFix::VALID_ALTITUDE) ? QString::number(fix.altitude) : QString()) << ','
+            << (fix.has(GpsFix::VALID_SPEED) ? QString::number(fix.speed) : QString()) << ','
+            << (fix.has(GpsFix::VALID_COURSE) ? QString::number(fix.course) : QString()) << ','
+            << (fix.has(GpsFix::VALID_HDOP) ? QString::number(fix.hdop) : QString()) << ','
+            << (fix.has(GpsFix::VALID_SATELLITES) ? QString::number(fix.satellites) : QString()) << ','
+            << (fix.epoch_ms ? QString::number(fix.epoch_ms) : QString()) << '\n';
+    }
+    out.flush();
+}
 
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
-    SerialPort port(&a);
-//    TinyGPS gps(&a);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption threadedOption("threaded", "Read and parse on dedicated threads.");
+    QCommandLineOption portOption("port", "Receiver to open, e.g. /dev/ttyUSB0:115200:8N1 (repeatable).", "spec");
+    QCommandLineOption configOption("config", "File with one receiver spec per line.", "file");
+    QCommandLineOption workersOption("workers", "Worker threads for multiple receivers or replay.", "count", "0");
+    QCommandLineOption replayOption("replay", "Parse a raw NMEA log and print the fixes as CSV.", "file");
+    QCommandLineOption trackOption("track", "Write the fixes to a binary track file instead (with --replay), "
+                                            "or record them while reading the serial port.", "file");
+    QCommandLineOption fencesOption("fences", "Report entering and leaving the geofences in this file.", "file");
+    QCommandLineOption latencyOption("latency", "Print latency histograms every N seconds.", "seconds");
+    QCommandLineOption metricsFileOption("metrics-file", "Keep parser metrics in Prometheus text format in this file.", "file");
+    QCommandLineOption metricsSocketOption("metrics-socket", "Serve parser metrics on this local socket.", "name");
+    QCommandLineOption readTrackOption("read-track", "Print the fixes of a binary track file as CSV.", "file");
+    QCommandLineOption fixRateOption("fix-rate", "Report at most N fixes per second (0: every fix).", "N", "0");
+    QCommandLineOption changesOnlyOption("changes-only", "Report only fixes that differ from the previous one.");
+    QCommandLineOption captureOption("capture", "Record the raw bytes read from the serial port to a capture file.", "file");
+    QCommandLineOption playOption("play", "Read a capture file instead of the serial port.", "file");
+    QCommandLineOption speedOption("speed", "Speed for --play: 1 is real time, 0 as fast as possible.", "factor", "1");
+    QCommandLineOption smoothOption("smooth", "Print the smoothed, dead-reckoned position N times per second.", "N");
+    QCommandLineOption deviceOption("device", "Serial port of the receiver.", "name", "COM3");
+    QCommandLineOption baudOption("baud", "Speed the receiver talks at now.", "rate", "9600");
+    QCommandLineOption protocolOption("protocol", "Configure the receiver first, in this dialect: mtk, pubx or ubx.", "dialect");
+    QCommandLineOption setBaudOption("set-baud", "Switch the receiver, and the port, to this speed (with --protocol).", "rate");
+    QCommandLineOption rateOption("rate-ms", "Receiver update interval in milliseconds (with --protocol).", "ms");
+    QCommandLineOption sentencesOption("sentences", "Sentences the receiver outputs, e.g. GGA,RMC,UBX-NAV-PVT (with --protocol).", "list");
+    parser.addOptions({threadedOption, portOption, configOption, workersOption, replayOption,
+                       trackOption, readTrackOption, fencesOption,
+                       latencyOption, metricsFileOption, metricsSocketOption,
+                       fixRateOption, changesOnlyOption, captureOption, playOption, speedOption,
+                       smoothOption, deviceOption, baudOption, protocolOption, setBaudOption,
+                       rateOption, sentencesOption});
+    parser.process(a);
+
+    if (parser.isSet(readTrackOption)) {
+        TrackReader reader(parser.value(readTrackOption));
+        QString error;
+        std::vector<GpsFix> fixes;
+        if (!reader.open(&error) || !reader.readAll(Track::AllColumns, &fixes)) {
+            qDebug() << (error.isEmpty() ? QString("corrupt track file") : error);
+            return 1;
+        }
+        printFixes(fixes);
+        return 0;
+    }
+
+    if (parser.isSet(replayOption)) {
+        NmeaReplay replay(parser.value(replayOption));
+        QString error;
+        if (!replay.open(&error)) {
+            qDebug() << error;
+            return 1;
+        }
+
+        const std::vector<GpsFix> fixes = replay.parse(parser.value(workersOption).toInt());
+        if (parser.isSet(trackOption)) {
+            TrackWriter writer(parser.value(trackOption));
+            if (!writer.open(&error)) {
+                qDebug() << error;
+                return 1;
+            }
+            for (const GpsFix &fix : fixes) {
+                if (TrackWriter::records(fix))
+                    writer.append(fix);
+            }
+            writer.close();
+        } else {
+            printFixes(fixes);
+        }
+
+        NmeaReplay::Stats stats = replay.stats();
+        qDebug() << stats.fixes << "fixes," << stats.bytes << "bytes in" << stats.chunks << "chunks,"
+                 << stats.seconds << "s," << stats.bytes / stats.seconds / 1e6 << "MB/s";
+        return 0;
+    }
+
+#ifdef Q_OS_LINUX
+    if (parser.isSet(portOption) || parser.isSet(configOption)) {
+        QVector<ReceiverConfig> receivers;
+        if (parser.isSet(configOption)) {
+            QString error;
+            receivers = ReceiverConfig::fromFile(parser.value(configOption), &error);
+            if (!error.isEmpty()) {
+                qDebug() << error;
+                return 1;
+            }
+        }
+        for (const QString &spec : parser.values(portOption)) {
+            ReceiverConfig config;
+            if (!ReceiverConfig::fromSpec(spec, &config)) {
+                qDebug() << "invalid receiver" << spec;
+                return 1;
+            }
+            receivers.append(config);
+        }
+
+        GpsHub hub(receivers, parser.value(workersOption).toInt());
+        QObject::connect(&hub, &GpsHub::errorOccurred, [](const QString &message) { qDebug() << message; });
+        QObject::connect(&hub, &GpsHub::fixUpdated, &a, [&hub](int receiver, const GpsFix &fix) {
+            if (fix.has(GpsFix::VALID_POSITION))
+                qDebug() << hub.config(receiver).name
+                         << "Lat: " << fix.latitude / 1000000.0 << " Long: " << fix.longitude / 1000000.0;
+        });
+        if (!hub.start())
+            return 1;
+
+        GpsStatsExporter exporter;
+        for (int i = 0; i < hub.receiverCount(); ++i)
+            exporter.addReceiver(hub.config(i).name, [&hub, i]() { return hub.parserStats(i); });
+        if (!startMetrics(parser, &exporter))
+            return 1;
+        return a.exec();
+    }
+#endif
+
+    std::unique_ptr<CaptureDevice> capture;
+    if (parser.isSet(playOption))
+        capture.reset(new CaptureDevice(parser.value(playOption), parser.value(speedOption).toDouble()));
+
+    std::unique_ptr<SerialPort> serialPort(capture ? new SerialPort(capture.get())
+                                                   : new SerialPort(parser.value(deviceOption), parser.value(baudOption).toInt(),
+                                                                    parser.isSet(threadedOption) ? SerialPort::ThreadedIo
+                                                                                                 : SerialPort::EventLoopIo));
+    SerialPort &port = *serialPort;
+
+    std::unique_ptr<ReceiverConfigurator> configurator;
+    if (parser.isSet(protocolOption) && !capture) {
+        ReceiverConfigurator::Settings settings;
+        if (!ReceiverCommand::parseDialect(parser.value(protocolOption), &settings.dialect)) {
+            qDebug() << "unknown protocol" << parser.value(protocolOption);
+            return 1;
+        }
+        if (parser.isSet(sentencesOption) && !ReceiverCommand::parseSentences(parser.value(sentencesOption), &settings.sentences)) {
+            qDebug() << "unknown sentence in" << parser.value(sentencesOption);
+            return 1;
+        }
+        settings.updateIntervalMs = parser.value(rateOption).toInt();
+        settings.baudRate = parser.value(setBaudOption).toInt();
+        configurator.reset(new ReceiverConfigurator(&port, settings));
+        QObject::connect(configurator.get(), &ReceiverConfigurator::finished, [](bool ok, const QString &error) {
+            qDebug() << (ok ? QString("receiver configured") : error);
+        });
+        // once the port is open and the event loop runs
+        QTimer::singleShot(0, configurator.get(), &ReceiverConfigurator::start);
+    }
+    if (parser.isSet(trackOption) && !port.recordTrack(parser.value(trackOption)))
+        return 1;
+    if (parser.isSet(captureOption) && !port.recordCapture(parser.value(captureOption)))
+        return 1;
+
+    port.setFixRate(parser.value(fixRateOption).toInt(), parser.isSet(changesOnlyOption));
+    QObject::connect(&port, &SerialPort::fixUpdated, &a, [](const GpsFix &fix) {
+        if (fix.has(GpsFix::VALID_POSITION))
+            qDebug() << "Lat: " << fix.latitude / 1000000.0 << " Long: " << fix.longitude / 1000000.0;
+    });
+
+    GpsStatsExporter exporter;
+    exporter.addReceiver(capture ? QString("capture") : port.portName(), [&port]() { return port.parserStats(); });
+    if (!startMetrics(parser, &exporter))
+        return 1;
+
+    QTimer latencyTimer;
+    if (parser.isSet(latencyOption)) {
+        QObject::connect(&latencyTimer, &QTimer::timeout, [&port]() {
+            qDebug().noquote() << port.latency().dump();
+        });
+        latencyTimer.start(qMax(1, parser.value(latencyOption).toInt()) * 1000);
+    }
+
+    QTimer smoothTimer;
+    if (parser.isSet(smoothOption)) {
+        smoothTimer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(&smoothTimer, &QTimer::timeout, [&port]() {
+            TrackFilter::Estimate estimate;
+            if (port.estimate(gps_clock_ns(), &estimate))
+                qDebug() << "Smoothed lat: " << QString::number(estimate.latitude, 'f', 7)
+                         << " Long: " << QString::number(estimate.longitude, 'f', 7)
+                         << " +/-" << estimate.position_error << "m, age" << estimate.age << "s";
+        });
+        smoothTimer.start(qMax(1, 1000 / qMax(1, parser.value(smoothOption).toInt())));
+    }
+
+    GeofenceIndex fences;
+    if (parser.isSet(fencesOption)) {
+        QString error;
+        if (!fences.load(parser.value(fencesOption), &error)) {
+            qDebug() << error;
+            return 1;
+        }
+        GeofenceMonitor *monitor = port.watchGeofences(&fences);
+        QObject::connect(monitor, &GeofenceMonitor::entered, [&fences](int fence, const GpsFix &) {
+            qDebug() << "Entrou" << fences.fenceId(fence) << fences.fenceName(fence);
+        });
+        QObject::connect(monitor, &GeofenceMonitor::exited, [&fences](int fence, const GpsFix &) {
+            qDebug() << "Saiu" << fences.fenceId(fence) << fences.fenceName(fence);
+        });
+    }
+
+    if (capture) {
+        // unthrottled, this is the end-to-end throughput of the pipeline
+        QObject::connect(capture.get(), &QIODevice::readChannelFinished, &a, [&]() {
+            CaptureDevice::Stats stats = capture->stats();
+            qDebug() << stats.chunks << "chunks," << stats.bytes << "bytes,"
+                     << port.parserStats().good_sentences << "sentences in" << stats.seconds << "s,"
+                     << stats.bytes / qMax(stats.seconds, 1e-9) / 1e6 << "MB/s";
+            a.quit();
+        });
+        QString error;
+        if (!capture->start(&error)) {
+            qDebug() << error;
+            return 1;
+        }
+    }
+//    TinyGPS gps;
 
 //    if (port.available()) {
 //        qDebug() << "available " << port.available();
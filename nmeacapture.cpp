@@ -0,0 +1,250 @@
+#include "nmeacapture.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+#include "latency.h"
+
+using namespace Capture;
+
+namespace {
+
+const char HeaderMagic[4] = {'G', 'P', 'S', 'C'};
+const quint16 FormatVersion = 1;
+const int HeaderSize = 8;
+
+// bytes handed to the reader per readyRead() when unthrottled
+const int UnthrottledBatch = 64 * 1024;
+
+int putVarint(char *out, quint64 value)
+{
+    int n = 0;
+    while (value >= 0x80) {
+        out[n++] = char(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = char(value);
+    return n;
+}
+
+// returns nullptr on truncated input
+const char *getVarint(const char *p, const char *end, quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        quint8 byte = quint8(*p++);
+        result |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const QString &fileName)
+    : m_file(fileName)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(QString *error)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    char header[HeaderSize];
+    memcpy(header, HeaderMagic, sizeof(HeaderMagic));
+    qToLittleEndian(FormatVersion, header + 4);
+    qToLittleEndian(quint16(0), header + 6);
+    m_file.write(header, HeaderSize);
+    m_lastNs = 0;
+    m_chunks = 0;
+    return true;
+}
+
+void CaptureWriter::append(quint64 ns, const char *data, int size)
+{
+    if (!m_file.isOpen() || size <= 0)
+        return;
+
+    char prefix[20];
+    int n = putVarint(prefix, m_chunks && ns > m_lastNs ? ns - m_lastNs : 0);
+    n += putVarint(prefix + n, quint64(size));
+    m_file.write(prefix, n);
+    m_file.write(data, size);
+
+    if (!m_chunks || ns > m_lastNs)
+        m_lastNs = ns;
+    ++m_chunks;
+}
+
+bool CaptureWriter::close()
+{
+    if (!m_file.isOpen())
+        return true;
+    bool ok = m_file.flush();
+    m_file.close();
+    return ok;
+}
+
+CaptureReader::CaptureReader(const QString &fileName)
+    : m_file(fileName)
+{
+}
+
+bool CaptureReader::open(QString *error)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    qint64 size = m_file.size();
+    const uchar *map = size >= HeaderSize ? m_file.map(0, size) : nullptr;
+    if (!map || memcmp(map, HeaderMagic, sizeof(HeaderMagic)) != 0
+            || qFromLittleEndian<quint16>(map + 4) != FormatVersion) {
+        if (error) *error = QObject::tr("%1: not a capture file").arg(m_file.fileName());
+        m_file.close();
+        return false;
+    }
+
+    m_data = reinterpret_cast<const char *>(map);
+    m_end = m_data + size;
+    rewind();
+    return true;
+}
+
+void CaptureReader::close()
+{
+    m_file.close(); // unmaps
+    m_data = m_end = m_position = nullptr;
+}
+
+bool CaptureReader::next(Chunk *chunk)
+{
+    if (!m_position || m_position == m_end)
+        return false;
+
+    quint64 delta, size;
+    const char *p = getVarint(m_position, m_end, &delta);
+    if (p)
+        p = getVarint(p, m_end, &size);
+    if (!p || size > quint64(m_end - p) || size > 0x7fffffff) {
+        m_truncated = true;
+        m_position = m_end;
+        return false;
+    }
+
+    m_time += delta;
+    chunk->time_ns = m_time;
+    chunk->data = p;
+    chunk->size = int(size);
+    m_position = p + size;
+    return true;
+}
+
+void CaptureReader::rewind()
+{
+    m_position = m_data ? m_data + HeaderSize : nullptr;
+    m_time = 0;
+    m_truncated = false;
+}
+
+CaptureDevice::CaptureDevice(const QString &fileName, double speed, QObject *parent)
+    : QIODevice(parent)
+    , m_reader(fileName)
+    , m_speed(speed > 0 ? speed : 0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &CaptureDevice::play);
+}
+
+bool CaptureDevice::start(QString *error)
+{
+    if (!m_reader.open(error))
+        return false;
+    QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    m_pending.reserve(UnthrottledBatch + 4096);
+    m_hasNext = m_reader.next(&m_next);
+    m_stats = Stats();
+    m_startNs = gps_clock_ns();
+    m_timer.start(0);
+    return true;
+}
+
+qint64 CaptureDevice::bytesAvailable() const
+{
+    return m_pending.size() - m_pendingOffset + QIODevice::bytesAvailable();
+}
+
+bool CaptureDevice::atEnd() const
+{
+    return !m_hasNext && m_pendingOffset == m_pending.size();
+}
+
+qint64 CaptureDevice::readData(char *data, qint64 maxSize)
+{
+    int n = int(qMin(maxSize, qint64(m_pending.size() - m_pendingOffset)));
+    memcpy(data, m_pending.constData() + m_pendingOffset, size_t(n));
+    m_pendingOffset += n;
+    if (m_pendingOffset == m_pending.size()) {
+        m_pending.resize(0); // keeps the capacity
+        m_pendingOffset = 0;
+    }
+    return n;
+}
+
+qint64 CaptureDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+// Hands out the chunks that are due and sleeps until the next one is
+void CaptureDevice::play()
+{
+    quint64 elapsed = gps_clock_ns() - m_startNs;
+    bool ready = false;
+
+    while (m_hasNext) {
+        if (m_speed > 0 && quint64(m_next.time_ns / m_speed) > elapsed)
+            break;
+        m_pending.append(m_next.data, m_next.size);
+        m_stats.bytes += quint64(m_next.size);
+        ++m_stats.chunks;
+        ready = true;
+        m_hasNext = m_reader.next(&m_next);
+        // one readyRead() per recorded chunk; unthrottled, in batches
+        if (m_speed > 0 || m_pending.size() >= UnthrottledBatch)
+            break;
+    }
+
+    if (ready)
+        emit readyRead();
+
+    if (!m_hasNext) {
+        m_stats.seconds = (gps_clock_ns() - m_startNs) / 1e9;
+        emit readChannelFinished();
+        return;
+    }
+
+    qint64 wait = 0;
+    if (m_speed > 0) {
+        quint64 due = quint64(m_next.time_ns / m_speed);
+        elapsed = gps_clock_ns() - m_startNs;
+        wait = due > elapsed ? qint64((due - elapsed + 999999) / 1000000) : 0;
+    }
+    // long pauses in the capture are slept in steps
+    m_timer.start(int(qMin(wait, qint64(1000))));
+}
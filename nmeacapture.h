@@ -0,0 +1,118 @@
+#ifndef NMEACAPTURE_H
+#define NMEACAPTURE_H
+
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QTimer>
+
+// Raw receiver captures: every chunk as it came out of the port, with the
+// time it was read, so a session can be fed through the parser again exactly
+// as it happened.
+//
+//   header   "GPSC" u16 version u16 reserved
+//   chunk    varint ns since the previous chunk, varint size, the bytes
+//
+// Varints are unsigned LEB128; a chunk cut short by a crash ends the capture.
+namespace Capture {
+
+struct Chunk {
+    quint64 time_ns;    // since the first chunk
+    const char *data;
+    int size;
+};
+
+} // namespace Capture
+
+class CaptureWriter
+{
+public:
+    explicit CaptureWriter(const QString &fileName);
+    ~CaptureWriter();
+
+    bool open(QString *error = nullptr);
+    // ns is the gps_clock_ns() at which the chunk was read
+    void append(quint64 ns, const char *data, int size);
+    bool close();
+
+    quint64 chunks() const { return m_chunks; }
+
+private:
+    QFile m_file;
+    quint64 m_lastNs = 0;
+    quint64 m_chunks = 0;
+};
+
+class CaptureReader
+{
+public:
+    explicit CaptureReader(const QString &fileName);
+
+    // maps the whole file
+    bool open(QString *error = nullptr);
+    void close();
+
+    // the next chunk; its data stays valid until close()
+    bool next(Capture::Chunk *chunk);
+    void rewind();
+
+    // the capture ends in an incomplete chunk
+    bool truncated() const { return m_truncated; }
+
+private:
+    QFile m_file;
+    const char *m_data = nullptr;
+    const char *m_end = nullptr;
+    const char *m_position = nullptr;
+    quint64 m_time = 0;
+    bool m_truncated = false;
+};
+
+// Sequential read-only device that plays a capture back: readyRead() comes
+// once per recorded chunk, at the recorded pace scaled by speed (2 is twice
+// as fast), or as fast as the reader keeps up with speed 0. Hand it to
+// SerialPort in place of a serial port.
+class CaptureDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        quint64 bytes;
+        quint64 chunks;
+        double seconds;     // from start() to the last chunk
+    };
+
+    explicit CaptureDevice(const QString &fileName, double speed = 1.0, QObject *parent = nullptr);
+
+    // opens the capture and starts playing it in this thread's event loop;
+    // readChannelFinished() follows the last chunk
+    bool start(QString *error = nullptr);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+    Stats stats() const { return m_stats; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private slots:
+    void play();
+
+private:
+    CaptureReader m_reader;
+    const double m_speed;
+    QTimer m_timer;
+
+    Capture::Chunk m_next = {};
+    bool m_hasNext = false;
+    quint64 m_startNs = 0;
+
+    QByteArray m_pending;   // handed out, not read yet
+    int m_pendingOffset = 0;
+    Stats m_stats = {};
+};
+
+#endif // NMEACAPTURE_H
@@ -0,0 +1,176 @@
+#ifndef NMEANUM_H
+#define NMEANUM_H
+
+#include "gpsglobal.h"
+
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Fixed-point parsing of NMEA numeric terms such as "-12.5", "4807.0381234"
+// or "123519.00". A term is read in one pass, eight digits at a time with SWAR
+// arithmetic on a 64-bit word, and kept as an integer mantissa with an
+// explicit decimal scale, so no digit the receiver sent is lost.
+//
+// Terms must be NUL terminated and followed by at least 8 readable bytes
+// (TinyGPS pads its term buffer for this); bytes past the NUL are never used.
+namespace nmeanum {
+
+// value = mantissa / 10^scale
+struct Fixed
+{
+    qint64 mantissa;
+    int scale;
+};
+
+const qint64 Max = 0x7FFFFFFFFFFFFFFFLL;
+
+const qint64 Pow10[19] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+    1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+    100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+    1000000000000000000LL
+};
+
+// Max / 10^n: the largest magnitude that can still be scaled up by 10^n
+const qint64 ScaleLimit[19] = {
+    Max, Max / Pow10[1], Max / Pow10[2], Max / Pow10[3], Max / Pow10[4], Max / Pow10[5],
+    Max / Pow10[6], Max / Pow10[7], Max / Pow10[8], Max / Pow10[9], Max / Pow10[10],
+    Max / Pow10[11], Max / Pow10[12], Max / Pow10[13], Max / Pow10[14], Max / Pow10[15],
+    Max / Pow10[16], Max / Pow10[17], Max / Pow10[18]
+};
+
+inline quint64 load8(const char *p)
+{
+    quint64 word;
+    memcpy(&word, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word; // first character in the low byte
+}
+
+// Number of leading ASCII digits in a word from load8(), 0..8
+inline int leading_digits(quint64 word)
+{
+    // digits become 0..9 in their byte; a byte is a digit when neither it nor
+    // it plus 6 reaches 0x10. Carries only start at non-digit bytes, so they
+    // cannot hide the first one.
+    quint64 x = word ^ 0x3030303030303030ULL;
+    quint64 nondigit = (x | (x + 0x0606060606060606ULL)) & 0xF0F0F0F0F0F0F0F0ULL;
+    if (!nondigit)
+        return 8;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, nondigit);
+    return int(index) / 8;
+#else
+    return __builtin_ctzll(nondigit) / 8;
+#endif
+}
+
+// Value of the first count (0..8) digits of a word from load8()
+inline quint32 digits_value(quint64 word, int count)
+{
+    quint64 x = word ^ 0x3030303030303030ULL;
+    // keep the digits and move them to the top, so missing ones act as leading zeros
+    x <<= 4 * (8 - count);  // in two steps, a 64 bit shift is undefined
+    x <<= 4 * (8 - count);
+    x = x * 10 + (x >> 8);  // pairs of digits
+    x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+         (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return quint32(x);
+}
+
+// Parses [+-]digits[.digits] at p. A 64-bit mantissa holds any 18 digits;
+// fraction digits past that are dropped. Returns false, with the mantissa
+// saturated to +-Max, if the integer part has more than 18 digits or there
+// are no digits at all.
+inline bool parse(const char *p, Fixed *value)
+{
+    bool negative = *p == '-';
+    if (negative || *p == '+')
+        ++p;
+
+    // common case: under 8 integer and under 8 fraction digits, one word each
+    quint64 word = load8(p);
+    int count = leading_digits(word);
+    qint64 mantissa = digits_value(word, count);
+    int digits = count;
+    int scale = 0;
+    p += count;
+
+    // longer integer parts
+    while (count == 8)
+    {
+        word = load8(p);
+        count = leading_digits(word);
+        digits += count;
+        if (digits <= 18)
+            mantissa = mantissa * Pow10[count] + digits_value(word, count);
+        p += count;
+    }
+    bool fits = digits <= 18;
+
+    if (*p == '.')
+    {
+        ++p;
+        do
+        {
+            word = load8(p);
+            count = leading_digits(word);
+            int used = digits + count <= 18 ? count : 18 - digits;
+            if (used > 0)
+            {
+                mantissa = mantissa * Pow10[used] + digits_value(word, used);
+                scale += used;
+                digits += used;
+            }
+            p += count;
+        } while (count == 8);
+    }
+
+    if (!fits)
+        mantissa = Max;
+    value->mantissa = negative ? -mantissa : mantissa;
+    value->scale = scale;
+    return fits && digits > 0;
+}
+
+// value at the given scale (0..18), truncated toward zero; false if it does not fit
+inline bool rescale(const Fixed &value, int scale, qint64 *result)
+{
+    if (value.scale > scale)
+    {
+        // more decimals than wanted, the only path that divides
+        *result = value.mantissa / Pow10[value.scale - scale];
+        return true;
+    }
+    int shift = scale - value.scale;
+    qint64 magnitude = value.mantissa < 0 ? -value.mantissa : value.mantissa;
+    if (shift > 18 || magnitude > ScaleLimit[shift])
+        return false;
+    *result = value.mantissa * Pow10[shift];
+    return true;
+}
+
+// NMEA ddmm.mmmm or dddmm.mmmm as degrees in units of 10^-7 (about 1 cm),
+// rounded to nearest; false if not a coordinate
+inline bool degrees_e7(const Fixed &value, qint64 *result)
+{
+    qint64 ddmm_e7; // ddmm.mmmmmmm * 10^7, at most 1.8e11
+    if (value.mantissa < 0 || !rescale(value, 7, &ddmm_e7))
+        return false;
+    qint64 degrees = ddmm_e7 / 1000000000;
+    if (degrees > 180)
+        return false;
+    qint64 minutes_e7 = ddmm_e7 - degrees * 1000000000;
+    *result = degrees * 10000000 + (minutes_e7 + 30) / 60;
+    return true;
+}
+
+} // namespace nmeanum
+
+#endif // NMEANUM_H
@@ -0,0 +1,172 @@
+#include "nmeareplay.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstring>
+
+#include "gpstime.h"
+#include "tinygps.h"
+
+namespace {
+
+// everything a GpsFix carries; GSA, GSV and ZDA details are not replayed
+typedef BasicTinyGPS<GPS_FIELDS_ALL & ~(GPS_FIELD_GSA | GPS_FIELD_GSV | GPS_FIELD_ZDA)> ReplayGPS;
+
+const qint64 MinChunkSize = 256 * 1024;
+
+// first "$" at the start of a line at or after p
+const char *nextSentence(const char *p, const char *begin, const char *end)
+{
+    while (p < end) {
+        p = static_cast<const char *>(memchr(p, '$', size_t(end - p)));
+        if (!p)
+            return end;
+        if (p == begin || p[-1] == '\n' || p[-1] == '\r')
+            return p;
+        ++p;
+    }
+    return end;
+}
+
+// ddmmyy of a day since 1970
+quint32 ddmmyy(qint64 days)
+{
+    int year;
+    unsigned month, day;
+    gpstime::civil_from_days(days, &year, &month, &day);
+    return day * 10000 + month * 100 + unsigned(year % 100);
+}
+
+} // namespace
+
+NmeaReplay::NmeaReplay(const QString &fileName)
+    : m_file(fileName)
+{
+}
+
+bool NmeaReplay::open(QString *error)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size == 0)
+        return true;
+
+    m_data = reinterpret_cast<const char *>(m_file.map(0, m_size));
+    if (!m_data) {
+        if (error) *error = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+void NmeaReplay::close()
+{
+    if (m_data)
+        m_file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(m_data)));
+    m_data = nullptr;
+    m_size = 0;
+    m_file.close();
+}
+
+std::vector<GpsFix> NmeaReplay::parse(int threads)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<GpsFix> fixes;
+    m_stats = Stats();
+    if (!m_data)
+        return fixes;
+
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    qint64 chunkCount = qBound<qint64>(1, m_size / MinChunkSize, threads);
+
+    // split at sentence starts
+    const char *end = m_data + m_size;
+    QVector<Chunk> chunks;
+    const char *begin = m_data;
+    for (qint64 i = 1; i <= chunkCount && begin < end; ++i) {
+        const char *split = i == chunkCount ? end : nextSentence(m_data + i * m_size / chunkCount, m_data, end);
+        if (split > begin)
+            chunks.append(Chunk{begin, split, std::vector<GpsFix>()});
+        begin = split;
+    }
+
+    QtConcurrent::blockingMap(chunks, &NmeaReplay::parseChunk);
+
+    // merge: the fixes of a chunk before its first dated sentence continue
+    // from the last epoch of the chunks before it, past midnight as the
+    // parser would have; then order by time
+    size_t total = 0;
+    for (const Chunk &chunk : chunks)
+        total += chunk.fixes.size();
+    fixes.reserve(total);
+
+    qint64 lastEpochMs = 0;
+    for (Chunk &chunk : chunks) {
+        for (GpsFix &fix : chunk.fixes) {
+            const qint64 ms = gpstime::ms_of_day(fix.time);
+            if (!fix.epoch_ms && lastEpochMs && ms >= 0) {
+                fix.epoch_ms = lastEpochMs - lastEpochMs % gpstime::MsPerDay + ms;
+                if (fix.epoch_ms + gpstime::MsPerDay / 2 < lastEpochMs)
+                    fix.epoch_ms += gpstime::MsPerDay;
+            }
+            if (fix.epoch_ms) {
+                // the day the fix belongs to, also for a GGA just past midnight
+                fix.date = ddmmyy(fix.epoch_ms / gpstime::MsPerDay);
+                fix.valid |= GpsFix::VALID_DATE;
+                lastEpochMs = fix.epoch_ms;
+            }
+            fixes.push_back(fix);
+        }
+        std::vector<GpsFix>().swap(chunk.fixes);
+    }
+
+    std::stable_sort(fixes.begin(), fixes.end(), [](const GpsFix &a, const GpsFix &b) {
+        return a.epoch_ms < b.epoch_ms;
+    });
+
+    m_stats.bytes = quint64(m_size);
+    m_stats.fixes = fixes.size();
+    m_stats.chunks = chunks.size();
+    m_stats.seconds = timer.nsecsElapsed() / 1e9;
+    return fixes;
+}
+
+// Feeds one chunk line by line and keeps a snapshot after each position sentence
+void NmeaReplay::parseChunk(Chunk &chunk)
+{
+    ReplayGPS gps;
+    const char *p = chunk.begin;
+
+    chunk.fixes.reserve(size_t(chunk.end - chunk.begin) / 70);
+    while (p < chunk.end) {
+        const char *eol = static_cast<const char *>(memchr(p, '\n', size_t(chunk.end - p)));
+        const char *next = eol ? eol + 1 : chunk.end;
+
+        if (gps.encode(p, size_t(next - p))) {
+            switch (gps.sentence_type()) {
+            case TinyGPS::GPS_SENTENCE_RMC:
+            case TinyGPS::GPS_SENTENCE_GGA:
+            case TinyGPS::GPS_SENTENCE_GLL:
+            case TinyGPS::GPS_SENTENCE_UBX_PVT: {
+                GpsFix fix;
+                gps.get_fix(&fix);
+                if (fix.has(GpsFix::VALID_POSITION | GpsFix::VALID_TIME))
+                    chunk.fixes.push_back(fix);
+                break;
+            }
+            }
+        }
+        p = next;
+    }
+}
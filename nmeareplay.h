@@ -0,0 +1,55 @@
+#ifndef NMEAREPLAY_H
+#define NMEAREPLAY_H
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+#include "gpsfix.h"
+
+// Offline parser for raw receiver logs. The file is memory mapped, split at
+// sentence boundaries into one chunk per thread, each chunk is parsed by its
+// own TinyGPS and the fixes are merged back in epoch_ms order.
+//
+// Chunks start with a fresh parser, so the first fixes of a chunk lack what
+// earlier sentences would have supplied (a GGA fix has no date until an RMC
+// is seen); their epoch is continued from the previous chunk when merging,
+// and every fix gets the date of its epoch. Fixes before the first date of
+// the log keep epoch_ms 0 and stay first, in file order.
+class NmeaReplay
+{
+public:
+    struct Stats {
+        quint64 bytes;
+        quint64 fixes;
+        int chunks;
+        double seconds;
+    };
+
+    explicit NmeaReplay(const QString &fileName);
+
+    bool open(QString *error = nullptr);
+    void close();
+
+    // threads <= 0 uses QThread::idealThreadCount()
+    std::vector<GpsFix> parse(int threads = 0);
+
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        std::vector<GpsFix> fixes;
+    };
+
+    static void parseChunk(Chunk &chunk);
+
+    QFile m_file;
+    const char *m_data = nullptr;
+    qint64 m_size = 0;
+    Stats m_stats = {};
+};
+
+#endif // NMEAREPLAY_H
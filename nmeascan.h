@@ -0,0 +1,168 @@
+#ifndef NMEASCAN_H
+#define NMEASCAN_H
+
+#include "gpsglobal.h"
+
+#include <cstddef>
+
+// Block scanning helpers for the bulk TinyGPS::encode() path: finding the next
+// NMEA delimiter or illegal byte, the next frame start and the parity of a
+// run of characters, 16 or 32 bytes at a time where SSE2 or AVX2 is available.
+
+#if defined(__AVX2__)
+#define GPS_SCAN_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GPS_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(GPS_SCAN_AVX2) || defined(GPS_SCAN_SSE2))
+#include <intrin.h>
+#endif
+
+namespace nmeascan {
+
+#if defined(GPS_SCAN_AVX2) || defined(GPS_SCAN_SSE2)
+inline unsigned first_bit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+// Delimiters and the bytes no sentence may contain: control characters,
+// which include CR and LF, DEL and anything above 0x7E
+inline bool is_special(char c)
+{
+    return c == '$' || c == ',' || c == '*' || quint8(c) < 0x20 || quint8(c) > 0x7E;
+}
+
+// Returns a pointer to the first special byte (see is_special()) in [p, end),
+// or end. Bytes are compared as signed, so 0x80-0xFF fall below 0x20 with the
+// control characters.
+inline const char *find_special(const char *p, const char *end)
+{
+#if defined(GPS_SCAN_AVX2)
+    const __m256i dollar = _mm256_set1_epi8('$');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i del = _mm256_set1_epi8(0x7F);
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i hit = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, dollar), _mm256_cmpeq_epi8(v, comma)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, star),
+                                    _mm256_or_si256(_mm256_cmpgt_epi8(space, v), _mm256_cmpeq_epi8(v, del))));
+        unsigned mask = unsigned(_mm256_movemask_epi8(hit));
+        if (mask)
+            return p + first_bit(mask);
+    }
+#elif defined(GPS_SCAN_SSE2)
+    const __m128i dollar = _mm_set1_epi8('$');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i del = _mm_set1_epi8(0x7F);
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hit = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(v, dollar), _mm_cmpeq_epi8(v, comma)),
+                    _mm_or_si128(_mm_cmpeq_epi8(v, star),
+                                 _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del))));
+        unsigned mask = unsigned(_mm_movemask_epi8(hit));
+        if (mask)
+            return p + first_bit(mask);
+    }
+#endif
+    while (p < end && !is_special(*p))
+        ++p;
+    return p;
+}
+
+// Returns a pointer to the first '$' or UBX sync byte (0xB5) in [p, end), or
+// end: where the next NMEA sentence or UBX frame may start
+inline const char *find_frame_start(const char *p, const char *end)
+{
+#if defined(GPS_SCAN_AVX2)
+    const __m256i dollar = _mm256_set1_epi8('$');
+    const __m256i sync = _mm256_set1_epi8(char(0xB5));
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned mask = unsigned(_mm256_movemask_epi8(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(v, dollar), _mm256_cmpeq_epi8(v, sync))));
+        if (mask)
+            return p + first_bit(mask);
+    }
+#elif defined(GPS_SCAN_SSE2)
+    const __m128i dollar = _mm_set1_epi8('$');
+    const __m128i sync = _mm_set1_epi8(char(0xB5));
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, dollar), _mm_cmpeq_epi8(v, sync))));
+        if (mask)
+            return p + first_bit(mask);
+    }
+#endif
+    while (p < end && *p != '$' && quint8(*p) != 0xB5)
+        ++p;
+    return p;
+}
+
+// Number of CR and LF bytes in [p, end)
+inline size_t count_line_ends(const char *p, const char *end)
+{
+    size_t count = 0;
+    for (; p < end; ++p)
+        count += *p == '\r' || *p == '\n';
+    return count;
+}
+
+// XOR of all bytes in [p, p + len), i.e. the NMEA parity of a run of characters
+inline quint8 xor_bytes(const char *p, size_t len)
+{
+    quint8 parity = 0;
+#if defined(GPS_SCAN_AVX2) || defined(GPS_SCAN_SSE2)
+    if (len >= 16)
+    {
+        __m128i acc = _mm_setzero_si128();
+        for (; len >= 16; p += 16, len -= 16)
+            acc = _mm_xor_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+        acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+        parity = quint8(_mm_cvtsi128_si32(acc));
+    }
+#endif
+    while (len--)
+        parity ^= quint8(*p++);
+    return parity;
+}
+
+// Adds [p, p + len) to the UBX checksum (8-bit Fletcher) in *a and *b
+inline void fletcher8(const char *p, size_t len, quint8 *a, quint8 *b)
+{
+    unsigned ck_a = *a, ck_b = *b;
+    while (len--)
+    {
+        ck_a += quint8(*p++);
+        ck_b += ck_a;
+    }
+    *a = quint8(ck_a);
+    *b = quint8(ck_b);
+}
+
+} // namespace nmeascan
+
+#endif // NMEASCAN_H
@@ -0,0 +1,212 @@
+#include "receivercommand.h"
+
+#include <QByteArrayList>
+#include <QStringList>
+
+namespace {
+
+const quint8 NoMtkField = 0xFF;
+const int MtkFieldCount = 19;   // PMTK314: GLL, RMC, VTG, GGA, GSA, GSV, ..., ZDA, MCHN
+
+// every sentence the parser understands and how each dialect addresses it
+struct SentenceId
+{
+    quint8 type;            // TinyGPS::GPS_SENTENCE_*
+    const char *name;       // as GpsStatsExporter labels it
+    quint8 mtkField;        // PMTK314 field, NoMtkField if MTK has none
+    quint8 ubxClass;        // CFG-MSG class and id; NMEA standard messages are class 0xF0
+    quint8 ubxId;
+};
+
+const SentenceId Sentences[] = {
+    {TinyGPS::GPS_SENTENCE_GGA,     "GGA",          3,          0xF0, 0x00},
+    {TinyGPS::GPS_SENTENCE_RMC,     "RMC",          1,          0xF0, 0x04},
+    {TinyGPS::GPS_SENTENCE_GSA,     "GSA",          4,          0xF0, 0x02},
+    {TinyGPS::GPS_SENTENCE_GSV,     "GSV",          5,          0xF0, 0x03},
+    {TinyGPS::GPS_SENTENCE_VTG,     "VTG",          2,          0xF0, 0x05},
+    {TinyGPS::GPS_SENTENCE_GLL,     "GLL",          0,          0xF0, 0x01},
+    {TinyGPS::GPS_SENTENCE_ZDA,     "ZDA",          17,         0xF0, 0x08},
+    {TinyGPS::GPS_SENTENCE_UBX_PVT, "UBX-NAV-PVT",  NoMtkField, 0x01, 0x07},
+    {TinyGPS::GPS_SENTENCE_UBX_SAT, "UBX-NAV-SAT",  NoMtkField, 0x01, 0x35},
+};
+
+const quint8 UbxClassCfg = 0x06;
+const quint8 UbxCfgPrt = 0x00;
+const quint8 UbxCfgMsg = 0x01;
+const quint8 UbxCfgRate = 0x08;
+
+void appendU16(QByteArray *payload, quint16 value)
+{
+    payload->append(char(value & 0xFF));
+    payload->append(char(value >> 8));
+}
+
+void appendU32(QByteArray *payload, quint32 value)
+{
+    appendU16(payload, quint16(value & 0xFFFF));
+    appendU16(payload, quint16(value >> 16));
+}
+
+ReceiverCommand acknowledgedBy(const QByteArray &bytes, quint8 protocol, quint16 command)
+{
+    ReceiverCommand result;
+    result.bytes = bytes;
+    result.acknowledged = true;
+    result.ack.protocol = protocol;
+    result.ack.command = command;
+    return result;
+}
+
+ReceiverCommand ubxCommand(quint8 id, const QByteArray &payload)
+{
+    return acknowledgedBy(ReceiverCommand::ubxFrame(UbxClassCfg, id, payload),
+                          GpsAck::UBX, quint16(GPS_UBX_MESSAGE(UbxClassCfg, id)));
+}
+
+ReceiverCommand mtkCommand(quint16 command, const QByteArray &arguments)
+{
+    return acknowledgedBy(ReceiverCommand::nmeaSentence("PMTK" + QByteArray::number(command) + ',' + arguments),
+                          GpsAck::PMTK, command);
+}
+
+} // namespace
+
+QByteArray ReceiverCommand::nmeaSentence(const QByteArray &body)
+{
+    quint8 checksum = 0;
+    for (char c : body)
+        checksum ^= quint8(c);
+    return '$' + body + '*' + QByteArray::number(checksum, 16).toUpper().rightJustified(2, '0') + "\r\n";
+}
+
+QByteArray ReceiverCommand::ubxFrame(quint8 messageClass, quint8 id, const QByteArray &payload)
+{
+    QByteArray frame("\xB5\x62");
+    frame += char(messageClass);
+    frame += char(id);
+    appendU16(&frame, quint16(payload.size()));
+    frame += payload;
+    quint8 a = 0, b = 0;
+    for (int i = 2; i < frame.size(); ++i) {
+        a += quint8(frame[i]);
+        b += a;
+    }
+    return frame + char(a) + char(b);
+}
+
+QVector<ReceiverCommand> ReceiverCommand::setSentences(Dialect dialect, quint32 sentences)
+{
+    QVector<ReceiverCommand> commands;
+
+    if (dialect == Mtk) {
+        // one sentence sets every output rate at once
+        QByteArrayList fields;
+        for (int i = 0; i < MtkFieldCount; ++i)
+            fields.append("0");
+        for (const SentenceId &sentence : Sentences) {
+            if (sentence.mtkField != NoMtkField && sentences & (1u << sentence.type))
+                fields[sentence.mtkField] = "1";
+        }
+        commands.append(mtkCommand(314, fields.join(',')));
+        return commands;
+    }
+
+    // one message at a time; rate 1 is once per fix
+    for (const SentenceId &sentence : Sentences) {
+        const quint8 rate = sentences & (1u << sentence.type) ? 1 : 0;
+        if (dialect == Pubx && sentence.ubxClass == 0xF0) {
+            // PUBX,40,msg,rddc,rus1,rus2,rusb,rspi,reserved: the same rate on every port
+            const QByteArray r = QByteArray::number(rate);
+            ReceiverCommand command;
+            command.bytes = nmeaSentence(QByteArray("PUBX,40,") + sentence.name + ','
+                                         + r + ',' + r + ',' + r + ',' + r + ',' + r + ",0");
+            commands.append(command);
+        } else {
+            // the short CFG-MSG sets the rate on the port it arrives on
+            QByteArray payload;
+            payload += char(sentence.ubxClass);
+            payload += char(sentence.ubxId);
+            payload += char(rate);
+            commands.append(ubxCommand(UbxCfgMsg, payload));
+        }
+    }
+    return commands;
+}
+
+ReceiverCommand ReceiverCommand::setUpdateInterval(Dialect dialect, int intervalMs)
+{
+    if (dialect == Mtk)
+        return mtkCommand(220, QByteArray::number(intervalMs));
+
+    // CFG-RATE: measurement interval, one solution per measurement, aligned to GPS time
+    QByteArray payload;
+    appendU16(&payload, quint16(qBound(1, intervalMs, 0xFFFF)));
+    appendU16(&payload, 1);
+    appendU16(&payload, 1);
+    return ubxCommand(UbxCfgRate, payload);
+}
+
+ReceiverCommand ReceiverCommand::setBaudRate(Dialect dialect, qint32 baudRate)
+{
+    ReceiverCommand command;
+    command.baudRate = baudRate;
+
+    switch (dialect) {
+    case Mtk:
+        command.bytes = nmeaSentence("PMTK251," + QByteArray::number(baudRate));
+        break;
+    case Pubx:
+        // PUBX,41,port,inProto,outProto,baudrate,autobauding: UART 1 takes
+        // UBX, NMEA and RTCM and outputs UBX and NMEA
+        command.bytes = nmeaSentence("PUBX,41,1,0007,0003," + QByteArray::number(baudRate) + ",0");
+        break;
+    case Ubx: {
+        // CFG-PRT for UART 1, 8N1
+        QByteArray payload;
+        payload += char(1);         // portID
+        payload += char(0);         // reserved
+        appendU16(&payload, 0);     // txReady
+        appendU32(&payload, 0x08D0);  // mode: 8 bits, no parity, 1 stop bit
+        appendU32(&payload, quint32(baudRate));
+        appendU16(&payload, 0x0007);
+        appendU16(&payload, 0x0003);
+        appendU16(&payload, 0);     // flags
+        appendU16(&payload, 0);     // reserved
+        command.bytes = ubxFrame(UbxClassCfg, UbxCfgPrt, payload);
+        break;
+    }
+    }
+    return command;
+}
+
+bool ReceiverCommand::parseDialect(const QString &name, Dialect *dialect)
+{
+    const QString lower = name.toLower();
+    if (lower == "mtk")
+        *dialect = Mtk;
+    else if (lower == "pubx")
+        *dialect = Pubx;
+    else if (lower == "ubx")
+        *dialect = Ubx;
+    else
+        return false;
+    return true;
+}
+
+bool ReceiverCommand::parseSentences(const QString &names, quint32 *sentences)
+{
+    quint32 mask = 0;
+    for (const QString &name : names.split(',', Qt::SkipEmptyParts)) {
+        const QString trimmed = name.trimmed().toUpper();
+        const SentenceId *found = nullptr;
+        for (const SentenceId &sentence : Sentences) {
+            if (trimmed == QLatin1String(sentence.name))
+                found = &sentence;
+        }
+        if (!found)
+            return false;
+        mask |= 1u << found->type;
+    }
+    *sentences = mask;
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef RECEIVERCOMMAND_H
+#define RECEIVERCOMMAND_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "tinygps.h"
+
+// One configuration command for a receiver: the bytes to write to the port
+// and how the receiver confirms it.
+//
+// Three dialects are spoken:
+//   Mtk    $PMTK314 (sentence set), $PMTK220 (update interval) and $PMTK251
+//          (baud rate) for MediaTek chipsets
+//   Pubx   u-blox NMEA commands: $PUBX,40 per sentence and $PUBX,41 for the
+//          port; there is none for the update interval, which goes as UBX
+//   Ubx    u-blox binary CFG-MSG, CFG-RATE and CFG-PRT
+//
+// PMTK314, PMTK220, CFG-MSG and CFG-RATE are acknowledged ($PMTK001, ACK-ACK
+// or ACK-NAK, see TinyGPS::set_ack_callback()). The PUBX commands are not,
+// and neither is a baud rate change in a way that can be relied on: the
+// receiver switches speed before or while it answers, so the change is
+// confirmed by valid sentences arriving at the new speed.
+struct ReceiverCommand
+{
+    enum Dialect { Mtk, Pubx, Ubx };
+
+    QByteArray bytes;
+    bool acknowledged = false;  // the receiver answers with ack
+    GpsAck ack = {};            // protocol and command of the expected answer
+    qint32 baudRate = 0;        // speed the receiver switches to, 0 if unchanged
+
+    // reply answers this command
+    bool matches(const GpsAck &reply) const
+    {
+        return acknowledged && reply.protocol == ack.protocol && reply.command == ack.command;
+    }
+
+    // "$body*hh\r\n"
+    static QByteArray nmeaSentence(const QByteArray &body);
+    // sync, header, payload and Fletcher checksum
+    static QByteArray ubxFrame(quint8 messageClass, quint8 id, const QByteArray &payload);
+
+    // output exactly the sentences in the mask, bits 1 << TinyGPS::GPS_SENTENCE_*,
+    // once per fix; UBX NAV-PVT and NAV-SAT only with the u-blox dialects
+    static QVector<ReceiverCommand> setSentences(Dialect dialect, quint32 sentences);
+    // one fix every intervalMs milliseconds
+    static ReceiverCommand setUpdateInterval(Dialect dialect, int intervalMs);
+    // the receiver's port speed, 8N1
+    static ReceiverCommand setBaudRate(Dialect dialect, qint32 baudRate);
+
+    // "mtk", "pubx" or "ubx"
+    static bool parseDialect(const QString &name, Dialect *dialect);
+    // comma-separated sentence names as GpsStatsExporter labels them, e.g.
+    // "GGA,RMC,UBX-NAV-PVT", into a setSentences() mask
+    static bool parseSentences(const QString &names, quint32 *sentences);
+};
+
+#endif // RECEIVERCOMMAND_H
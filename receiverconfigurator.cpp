@@ -0,0 +1,166 @@
+#include "receiverconfigurator.h"
+
+#include "serialport.h"
+
+namespace {
+
+// how often the parser counters are checked after a baud rate change
+const int TrafficPollMs = 50;
+
+QString describe(const ReceiverCommand &command)
+{
+    return QString::fromLatin1(command.bytes.startsWith('$') ? command.bytes.trimmed()
+                                                              : command.bytes.left(6).toHex(' '));
+}
+
+} // namespace
+
+ReceiverConfigurator::ReceiverConfigurator(SerialPort *port, const Settings &settings, QObject *parent)
+    : QObject(parent)
+    , m_port(port)
+    , m_settings(settings)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &ReceiverConfigurator::handleTimeout);
+    // never inside the parser callback, whatever thread it runs on
+    connect(m_port, &SerialPort::acknowledged, this, &ReceiverConfigurator::handleAck, Qt::QueuedConnection);
+    connect(m_port, &SerialPort::baudRateChanged, this, &ReceiverConfigurator::handleBaudRateChanged,
+            Qt::QueuedConnection);
+}
+
+void ReceiverConfigurator::start()
+{
+    if (isRunning())
+        return;
+
+    m_commands.clear();
+    if (m_settings.sentences)
+        m_commands += ReceiverCommand::setSentences(m_settings.dialect, m_settings.sentences);
+    if (m_settings.updateIntervalMs > 0)
+        m_commands.append(ReceiverCommand::setUpdateInterval(m_settings.dialect, m_settings.updateIntervalMs));
+    // last, everything before it is sent at the speed the receiver has now
+    if (m_settings.baudRate > 0 && m_settings.baudRate != m_port->baudRate())
+        m_commands.append(ReceiverCommand::setBaudRate(m_settings.dialect, m_settings.baudRate));
+
+    m_current = 0;
+    m_attempts = 0;
+    send();
+}
+
+// Writes the current command and waits for whatever confirms it
+void ReceiverConfigurator::send()
+{
+    if (m_current >= m_commands.size()) {
+        finish(true);
+        return;
+    }
+
+    const ReceiverCommand &command = m_commands[m_current];
+    if (!m_port->writeCommand(command.bytes)) {
+        finish(false, tr("cannot write to %1").arg(m_port->portName()));
+        return;
+    }
+    ++m_attempts;
+
+    if (command.baudRate) {
+        // 10 bits a character at the old speed, and time for the receiver
+        // to act on it
+        m_phase = Draining;
+        m_timer.start(int(command.bytes.size() * 10000LL / qMax(1, m_port->baudRate())) + m_settings.settleMs);
+    } else if (command.acknowledged) {
+        m_phase = AwaitingAck;
+        m_timer.start(m_settings.ackTimeoutMs);
+    } else {
+        m_phase = Settling;
+        m_timer.start(m_settings.settleMs);
+    }
+}
+
+void ReceiverConfigurator::next()
+{
+    ++m_current;
+    m_attempts = 0;
+    send();
+}
+
+void ReceiverConfigurator::handleAck(const GpsAck &ack)
+{
+    if (m_phase != AwaitingAck || !m_commands[m_current].matches(ack))
+        return;
+
+    m_timer.stop();
+    if (!ack.accepted()) {
+        finish(false, tr("%1 rejected %2").arg(m_port->portName(), describe(m_commands[m_current])));
+        return;
+    }
+    next();
+}
+
+void ReceiverConfigurator::handleTimeout()
+{
+    switch (m_phase) {
+    case Idle:
+        break;
+
+    case AwaitingAck:
+        if (m_attempts > m_settings.retries) {
+            finish(false, tr("%1 did not acknowledge %2").arg(m_port->portName(), describe(m_commands[m_current])));
+            return;
+        }
+        send();
+        break;
+
+    case Settling:
+        next();
+        break;
+
+    case Draining:
+        switchBaudRate();
+        break;
+
+    case Switching:
+    case Verifying:
+        if (m_phase == Verifying && m_port->parserStats().passed_checksum > m_passedAtSwitch) {
+            next();
+            return;
+        }
+        if (m_sinceSwitch.elapsed() < m_settings.trafficTimeoutMs) {
+            m_timer.start(TrafficPollMs);
+            return;
+        }
+        {
+            const qint32 newBaudRate = m_port->baudRate();
+            m_port->setBaudRate(m_oldBaudRate);
+            finish(false, tr("no valid sentences from %1 at %2 baud, back at %3")
+                   .arg(m_port->portName()).arg(newBaudRate).arg(m_oldBaudRate));
+        }
+        break;
+    }
+}
+
+// The receiver has had the command; follow it to the new speed
+void ReceiverConfigurator::switchBaudRate()
+{
+    m_oldBaudRate = m_port->baudRate();
+    m_sinceSwitch.start();
+    m_phase = Switching;
+    m_timer.start(TrafficPollMs);
+    m_port->setBaudRate(m_commands[m_current].baudRate);
+}
+
+// The port runs at the new speed and has parsed what came before; only
+// sentences from here on confirm the change
+void ReceiverConfigurator::handleBaudRateChanged(qint32 baudRate)
+{
+    if (m_phase != Switching || baudRate != m_commands[m_current].baudRate)
+        return;
+    m_passedAtSwitch = m_port->parserStats().passed_checksum;
+    m_phase = Verifying;
+}
+
+void ReceiverConfigurator::finish(bool ok, const QString &error)
+{
+    m_timer.stop();
+    m_phase = Idle;
+    emit finished(ok, error);
+}
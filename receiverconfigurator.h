@@ -0,0 +1,80 @@
+#ifndef RECEIVERCONFIGURATOR_H
+#define RECEIVERCONFIGURATOR_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include "receivercommand.h"
+
+class SerialPort;
+
+// Brings a receiver to the sentence set, update interval and baud rate in
+// Settings by sending ReceiverCommands through a SerialPort, one at a time.
+//
+// An acknowledged command waits for its answer and is resent on timeout; a
+// rejection or too many retries fail the configuration. Commands without an
+// answer are given a moment to take effect. The baud rate goes last: once
+// the command has left at the old speed the port is switched to the new one,
+// and the change stands when a sentence passes its checksum there after the
+// port has confirmed the switch. If none does in time the port goes back to
+// the old speed and the configuration fails.
+class ReceiverConfigurator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings {
+        ReceiverCommand::Dialect dialect = ReceiverCommand::Mtk;
+        quint32 sentences = 0;      // 1 << TinyGPS::GPS_SENTENCE_*, 0 leaves the set as is
+        int updateIntervalMs = 0;   // 0 leaves the interval as is
+        qint32 baudRate = 0;        // 0 leaves the speed as is
+        int ackTimeoutMs = 1000;
+        int retries = 2;
+        int settleMs = 250;         // after a command without an answer
+        int trafficTimeoutMs = 3000; // for the first sentence at a new baud rate
+    };
+
+    ReceiverConfigurator(SerialPort *port, const Settings &settings, QObject *parent = nullptr);
+
+    // sends the commands; finished() follows
+    void start();
+    bool isRunning() const { return m_phase != Idle; }
+
+signals:
+    void finished(bool ok, const QString &error);
+
+private slots:
+    void handleAck(const GpsAck &ack);
+    void handleTimeout();
+    void handleBaudRateChanged(qint32 baudRate);
+
+private:
+    enum Phase {
+        Idle,
+        AwaitingAck,    // an acknowledged command was sent
+        Settling,       // a command without an answer was sent
+        Draining,       // the baud rate command is on its way at the old speed
+        Switching,      // waiting for the port to run at the new speed
+        Verifying       // the port runs at the new speed, waiting for a valid sentence
+    };
+
+    void send();
+    void next();
+    void switchBaudRate();
+    void finish(bool ok, const QString &error = QString());
+
+    SerialPort *m_port;
+    Settings m_settings;
+    QVector<ReceiverCommand> m_commands;
+    int m_current = 0;
+    int m_attempts = 0;
+    Phase m_phase = Idle;
+    QTimer m_timer;
+
+    qint32 m_oldBaudRate = 0;
+    quint64 m_passedAtSwitch = 0;
+    QElapsedTimer m_sinceSwitch;
+};
+
+#endif // RECEIVERCONFIGURATOR_H
@@ -0,0 +1,78 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include "gpsglobal.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+// Single-writer, multi-reader sequence lock for small trivially copyable values.
+// The writer never blocks; readers retry while a store is in progress, so they
+// always see one complete value. The payload is kept in relaxed atomic words,
+// which keeps concurrent access well defined.
+template <typename T>
+class alignas(64) SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() : m_sequence(0)
+    {
+        for (auto &word : m_words)
+            word.store(0, std::memory_order_relaxed);
+    }
+
+    SeqLock(const SeqLock &) = delete;
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    // writer side, one thread only
+    void store(const T &value)
+    {
+        quint64 buffer[WordCount] = {};
+        memcpy(buffer, &value, sizeof(T));
+
+        quint32 sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < WordCount; ++i)
+            m_words[i].store(buffer[i], std::memory_order_relaxed);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // reader side, any number of threads
+    bool try_load(T *value) const
+    {
+        quint64 buffer[WordCount];
+        quint32 before = m_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+            return false;
+        for (int i = 0; i < WordCount; ++i)
+            buffer[i] = m_words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) != before)
+            return false;
+        memcpy(value, buffer, sizeof(T));
+        return true;
+    }
+
+    T load() const
+    {
+        T value;
+        while (!try_load(&value))
+            std::this_thread::yield();
+        return value;
+    }
+
+    // number of completed stores
+    quint32 version() const { return m_sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    enum { WordCount = (sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64) };
+
+    std::atomic<quint32> m_sequence; // odd while a store is in progress
+    std::atomic<quint64> m_words[WordCount];
+};
+
+#endif // SEQLOCK_H
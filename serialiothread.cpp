@@ -0,0 +1,231 @@
+#include "serialiothread.h"
+
+#include <QtDebug>
+
+SerialIoThread::SerialIoThread(const QString &portName, qint32 baudRate, TinyGPS *gps,
+                               size_t ringCapacity, OverflowPolicy policy, QObject *parent)
+    : QObject(parent)
+    , m_portName(portName)
+    , m_baudRate(baudRate)
+    , m_policy(policy)
+    , m_gps(gps)
+    , m_ring(ringCapacity)
+    , m_stopping(false)
+    , m_readerStalled(false)
+    , m_bytesRead(0)
+    , m_bytesDropped(0)
+    , m_overflows(0)
+    , m_highWater(0)
+    , m_bytesParsed(0)
+    , m_lastReadNs(0)
+    , m_switchMark(0)
+    , m_switchedBaudRate(0)
+    , m_parserThread(this)
+{
+    m_ioThread.setObjectName("serial-io");
+    m_parserThread.setObjectName("serial-parser");
+}
+
+SerialIoThread::~SerialIoThread()
+{
+    stop();
+}
+
+void SerialIoThread::start()
+{
+    if (m_reader)
+        return;
+
+    m_stopping = false;
+    m_reader = new SerialReader(this);
+    m_reader->moveToThread(&m_ioThread);
+    connect(&m_ioThread, &QThread::finished, m_reader, &QObject::deleteLater);
+
+    m_parserThread.start(QThread::HighPriority);
+    m_ioThread.start(QThread::HighPriority);
+    QMetaObject::invokeMethod(m_reader, "open", Qt::QueuedConnection);
+}
+
+void SerialIoThread::stop()
+{
+    if (!m_reader)
+        return;
+
+    // the parser goes first, it may still queue calls to the reader
+    m_stopping = true;
+    m_dataReady.release();
+    m_parserThread.wait();
+
+    QMetaObject::invokeMethod(m_reader, "close", Qt::BlockingQueuedConnection);
+    m_ioThread.quit();
+    m_ioThread.wait();
+    m_reader = nullptr;
+}
+
+void SerialIoThread::write(const QByteArray &bytes)
+{
+    if (m_reader)
+        QMetaObject::invokeMethod(m_reader, "write", Qt::QueuedConnection, Q_ARG(QByteArray, bytes));
+}
+
+void SerialIoThread::setBaudRate(qint32 baudRate)
+{
+    m_baudRate.store(baudRate, std::memory_order_relaxed);
+    if (m_reader)
+        QMetaObject::invokeMethod(m_reader, "setBaudRate", Qt::QueuedConnection, Q_ARG(qint32, baudRate));
+}
+
+SerialIoThread::Stats SerialIoThread::stats() const
+{
+    Stats stats;
+    stats.bytes_read = m_bytesRead.load(std::memory_order_relaxed);
+    stats.bytes_dropped = m_bytesDropped.load(std::memory_order_relaxed);
+    stats.overflows = m_overflows.load(std::memory_order_relaxed);
+    stats.high_water = m_highWater.load(std::memory_order_relaxed);
+    stats.bytes_parsed = m_bytesParsed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Parser thread: sleeps until the reader signals data, then drains the ring
+void SerialIoThread::parse()
+{
+    while (!m_stopping)
+    {
+        m_dataReady.tryAcquire(1, 100);
+        m_dataReady.tryAcquire(m_dataReady.available());
+
+        const char *data;
+        size_t len;
+        while ((len = m_ring.read_span(&data)) > 0)
+        {
+            // the newest read is a lower bound on how long these bytes waited
+            m_gps->mark_received(m_lastReadNs.load(std::memory_order_acquire));
+            m_gps->encode(data, len);
+            m_ring.commit_read(len);
+            m_bytesParsed.fetch_add(len, std::memory_order_relaxed);
+            resumeReader();
+        }
+
+        // only the bytes that came in at the new speed count after this
+        qint32 switched = m_switchedBaudRate.load(std::memory_order_acquire);
+        if (switched
+                && m_bytesParsed.load(std::memory_order_relaxed) >= m_switchMark.load(std::memory_order_relaxed)
+                && m_switchedBaudRate.compare_exchange_strong(switched, 0))
+            emit baudRateChanged(switched);
+    }
+}
+
+// Called by the parser after freeing ring space
+void SerialIoThread::resumeReader()
+{
+    if (m_readerStalled.exchange(false))
+        QMetaObject::invokeMethod(m_reader, "readPending", Qt::QueuedConnection);
+}
+
+SerialReader::SerialReader(SerialIoThread *owner)
+    : m_owner(owner)
+{
+}
+
+void SerialReader::open()
+{
+    m_serialPort = new QSerialPort(this);
+    m_serialPort->setPortName(m_owner->m_portName);
+    m_serialPort->setBaudRate(m_owner->m_baudRate);
+    m_serialPort->setDataBits(QSerialPort::Data8);
+    m_serialPort->setParity(QSerialPort::NoParity);
+    m_serialPort->setStopBits(QSerialPort::OneStop);
+    if (m_owner->m_policy == SerialIoThread::Block)
+        m_serialPort->setReadBufferSize(qint64(m_owner->m_ring.capacity()));
+
+    connect(m_serialPort, &QSerialPort::readyRead, this, &SerialReader::readPending);
+    connect(m_serialPort, &QSerialPort::errorOccurred, this, &SerialReader::handleError);
+
+    if (m_serialPort->open(QIODevice::ReadWrite)) {
+        qDebug() << "Porta aberta";
+    } else {
+        qDebug() << "Porta nao aberta";
+    }
+}
+
+void SerialReader::close()
+{
+    if (m_serialPort)
+        m_serialPort->close();
+}
+
+// Moves everything the port has into the ring, honouring the overflow policy
+void SerialReader::readPending()
+{
+    ByteRing &ring = m_owner->m_ring;
+
+    while (m_serialPort && m_serialPort->bytesAvailable() > 0)
+    {
+        char *data;
+        size_t room = ring.write_span(&data);
+
+        if (room == 0)
+        {
+            m_owner->m_overflows.fetch_add(1, std::memory_order_relaxed);
+            if (m_owner->m_policy == SerialIoThread::Block)
+            {
+                // the parser resumes us once it frees space; re-check in case
+                // it did so before seeing the flag
+                m_owner->m_readerStalled = true;
+                if (ring.write_span(&data) == 0 || !m_owner->m_readerStalled.exchange(false))
+                    return;
+                continue;
+            }
+
+            qint64 dropped = m_serialPort->read(m_discard, sizeof(m_discard));
+            if (dropped <= 0)
+                break;
+            m_owner->m_bytesDropped.fetch_add(quint64(dropped), std::memory_order_relaxed);
+            continue;
+        }
+
+        qint64 n = m_serialPort->read(data, qint64(room));
+        if (n <= 0)
+            break;
+        m_owner->m_lastReadNs.store(gps_clock_ns(), std::memory_order_release);
+        ring.commit_write(size_t(n));
+        m_owner->m_bytesRead.fetch_add(quint64(n), std::memory_order_relaxed);
+
+        quint64 fill = ring.size();
+        if (fill > m_owner->m_highWater.load(std::memory_order_relaxed))
+            m_owner->m_highWater.store(fill, std::memory_order_relaxed);
+
+        m_owner->m_dataReady.release();
+    }
+}
+
+void SerialReader::write(const QByteArray &bytes)
+{
+    if (m_serialPort && m_serialPort->isOpen())
+        m_serialPort->write(bytes);
+}
+
+// Waits for the pending writes, so that a command changing the receiver's
+// speed leaves at the old one. What the driver holds was received around
+// the switch and is dropped; the parser reports the change once it has
+// parsed the ring up to here.
+void SerialReader::setBaudRate(qint32 baudRate)
+{
+    if (!m_serialPort || !m_serialPort->isOpen())
+        return;
+    while (m_serialPort->bytesToWrite() > 0 && m_serialPort->waitForBytesWritten(100)) {
+    }
+    m_serialPort->setBaudRate(baudRate);
+    m_serialPort->clear(QSerialPort::Input);
+
+    m_owner->m_switchMark.store(m_owner->m_bytesRead.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_owner->m_switchedBaudRate.store(baudRate, std::memory_order_release);
+    m_owner->m_dataReady.release();
+}
+
+void SerialReader::handleError(QSerialPort::SerialPortError serialPortError)
+{
+    if (serialPortError == QSerialPort::ReadError) {
+        emit m_owner->errorOccurred(serialPortError, m_serialPort->errorString());
+    }
+}
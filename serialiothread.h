@@ -0,0 +1,128 @@
+#ifndef SERIALIOTHREAD_H
+#define SERIALIOTHREAD_H
+
+#include <QObject>
+#include <QSemaphore>
+#include <QSerialPort>
+#include <QThread>
+
+#include <atomic>
+
+#include "bytering.h"
+#include "tinygps.h"
+
+class SerialReader;
+
+// Reads a serial port on a dedicated thread into a preallocated ByteRing and
+// drains the ring into a TinyGPS on a second thread, so fixes keep flowing no
+// matter how busy the thread that owns this object is. Read the results through
+// the parser's fix channel (TinyGPS::set_fix_channel).
+class SerialIoThread : public QObject
+{
+    Q_OBJECT
+public:
+    // what the reader does when the parser falls behind and the ring is full
+    enum OverflowPolicy {
+        DropNewest, // keep reading the port, discard what does not fit
+        Block       // stop reading; the driver buffers and flow control pushes back
+    };
+
+    struct Stats {
+        quint64 bytes_read;     // bytes stored in the ring
+        quint64 bytes_dropped;  // bytes discarded with DropNewest
+        quint64 overflows;      // times the ring was found full
+        quint64 high_water;     // largest ring fill level seen, in bytes
+        quint64 bytes_parsed;
+    };
+
+    SerialIoThread(const QString &portName, qint32 baudRate, TinyGPS *gps,
+                   size_t ringCapacity = 64 * 1024, OverflowPolicy policy = DropNewest,
+                   QObject *parent = nullptr);
+    ~SerialIoThread();
+
+    void start();
+    void stop();
+
+    Stats stats() const;
+
+    // queue bytes for the port, e.g. a ReceiverCommand
+    void write(const QByteArray &bytes);
+    // change the port's speed once what was queued has been sent; also the
+    // speed it reopens at. baudRateChanged() follows.
+    void setBaudRate(qint32 baudRate);
+    qint32 baudRate() const { return m_baudRate.load(std::memory_order_relaxed); }
+
+signals:
+    void errorOccurred(QSerialPort::SerialPortError error, const QString &message);
+    // the port runs at baudRate, its input buffer was cleared at the switch
+    // and the bytes read before it have been parsed; emitted from the
+    // parser thread
+    void baudRateChanged(qint32 baudRate);
+
+private:
+    friend class SerialReader;
+
+    class ParserThread : public QThread
+    {
+    public:
+        explicit ParserThread(SerialIoThread *owner) : m_owner(owner) {}
+    protected:
+        void run() override { m_owner->parse(); }
+    private:
+        SerialIoThread *m_owner;
+    };
+
+    void parse();
+    void resumeReader();
+
+    const QString m_portName;
+    std::atomic<qint32> m_baudRate;
+    const OverflowPolicy m_policy;
+    TinyGPS *m_gps;
+
+    ByteRing m_ring;
+    QSemaphore m_dataReady;
+    std::atomic<bool> m_stopping;
+    std::atomic<bool> m_readerStalled;
+
+    std::atomic<quint64> m_bytesRead;
+    std::atomic<quint64> m_bytesDropped;
+    std::atomic<quint64> m_overflows;
+    std::atomic<quint64> m_highWater;
+    std::atomic<quint64> m_bytesParsed;
+    std::atomic<quint64> m_lastReadNs;
+
+    // set by the reader at a speed change, reported by the parser once it
+    // has parsed bytes_read up to the mark
+    std::atomic<quint64> m_switchMark;
+    std::atomic<qint32> m_switchedBaudRate;
+
+    QThread m_ioThread;
+    ParserThread m_parserThread;
+    SerialReader *m_reader = nullptr;
+};
+
+// Owns the QSerialPort inside the I/O thread
+class SerialReader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SerialReader(SerialIoThread *owner);
+
+public slots:
+    void open();
+    void close();
+    void readPending();
+    void write(const QByteArray &bytes);
+    void setBaudRate(qint32 baudRate);
+
+private slots:
+    void handleError(QSerialPort::SerialPortError serialPortError);
+
+private:
+    SerialIoThread *m_owner;
+    QSerialPort *m_serialPort = nullptr;
+    char m_discard[4096];
+};
+
+#endif // SERIALIOTHREAD_H
@@ -3,19 +3,48 @@
 #include <QtDebug>
 #include <QCoreApplication>
 
-SerialPort::SerialPort(QObject *parent)
+SerialPort::SerialPort(QObject *parent, IoMode mode)
+    : SerialPort("COM3", QSerialPort::Baud9600, mode, parent)
+{
+}
+
+SerialPort::SerialPort(const QString &portName, qint32 baudRate, IoMode mode, QObject *parent)
     : QObject(parent)
-    , m_serialPort(new QSerialPort(this))
+    , m_mode(mode)
+    , m_portName(portName)
+    , m_baudRate(baudRate)
 {
-    m_serialPort->setPortName("COM3");
-    m_serialPort->setBaudRate(QSerialPort::Baud9600);
+    init();
+
+    // a live receiver cannot be reporting a date before the last GPS week
+    // rollover; captures played back keep their recorded dates
+    m_gps.set_rollover_floor(gpstime::LastRolloverMs);
+
+    if (m_mode == ThreadedIo) {
+        m_ioThread = new SerialIoThread(m_portName, m_baudRate, &m_gps,
+                                        64 * 1024, SerialIoThread::DropNewest, this);
+        connect(m_ioThread, &SerialIoThread::baudRateChanged, this, &SerialPort::baudRateChanged);
+        connect(m_ioThread, &SerialIoThread::errorOccurred, this,
+                [this](QSerialPort::SerialPortError, const QString &message) {
+            qDebug() << QObject::tr("An I/O error occurred while reading "
+                                    "the data from port %1, error: %2")
+                        .arg(m_portName)
+                        .arg(message);
+        });
+        m_ioThread->start();
+        return;
+    }
+
+    m_serialPort = new QSerialPort(this);
+    m_serialPort->setPortName(m_portName);
+    m_serialPort->setBaudRate(m_baudRate);
     m_serialPort->setDataBits(QSerialPort::Data8);
     m_serialPort->setParity(QSerialPort::NoParity);
     m_serialPort->setStopBits(QSerialPort::OneStop);
+    m_device = m_serialPort;
 
     connect(m_serialPort, &QSerialPort::readyRead, this, &SerialPort::handleReadyRead);
     connect(m_serialPort, &QSerialPort::errorOccurred, this, &SerialPort::handleError);
-    connect(&m_timer, &QTimer::timeout, this, &SerialPort::handleTimeout);
 
     if (m_serialPort->open(QIODevice::ReadWrite)) {
         qDebug() << "Porta aberta";
@@ -24,34 +53,119 @@ SerialPort::SerialPort(QObject *parent)
     }
 }
 
+SerialPort::SerialPort(QIODevice *device, QObject *parent)
+    : QObject(parent)
+    , m_mode(EventLoopIo)
+    , m_device(device)
+{
+    init();
+    connect(m_device, &QIODevice::readyRead, this, &SerialPort::handleReadyRead);
+}
+
+void SerialPort::init()
+{
+    qRegisterMetaType<GpsFix>();
+    qRegisterMetaType<ByteSlice>();
+    qRegisterMetaType<GpsAck>();
+
+    m_gps.set_fix_channel(&m_fix);
+    m_gps.set_fix_callback(&SerialPort::handleFix, this);
+    m_gps.set_ack_callback(&SerialPort::handleAck, this);
+    m_gps.set_latency(&m_latency);
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_flushTimer, &QTimer::timeout, this, &SerialPort::flushPendingFix);
+}
+
+SerialPort::~SerialPort()
+{
+    // the I/O threads use m_gps, stop them before members go away
+    if (m_ioThread)
+        m_ioThread->stop();
+}
+
+// Reads straight into the pooled buffers and hands the same bytes to the
+// parser and to the subscribers
 void SerialPort::handleReadyRead()
 {
-    QByteArray arr = m_serialPort->readAll();
+    while (m_device->bytesAvailable() > 0) {
+        int room;
+        char *buffer = m_readBuffers.writeSpan(&room);
+        qint64 n = m_device->read(buffer, room);
+        if (n <= 0)
+            break;
+        quint64 now = gps_clock_ns();
+        m_gps.mark_received(now);
 
-    if (arr.size()) {
-        m_content.clear();
-        m_content.append(arr);
-        //        qDebug() << "Recebido " << arr << " copiado " << m_content;
+        m_content = m_readBuffers.commit(int(n));
+        if (m_capture)
+            m_capture->append(now, m_content.data(), m_content.size());
+        //        qDebug() << "Recebido " << m_content.toByteArray();
 
-        for (char i : arr) {
-            m_gps << i;
-        }
+        m_gps.encode(m_content.data(), size_t(m_content.size())); // fixes come out through handleFix()
 
-        if (!m_timer.isActive()) {
-            m_timer.start(1500);
-        }
+        emit received(m_content);
+    }
+}
+
+// Parser callback, once per validated sentence, on the thread that encodes
+void SerialPort::handleFix(const GpsFix &fix, void *context)
+{
+    SerialPort *port = static_cast<SerialPort *>(context);
+
+    if (port->m_mode == EventLoopIo) {
+        // every position report, not only the delivered ones
+        if (port->m_track && TrackWriter::records(fix))
+            port->m_track->append(fix);
+        if (port->m_geofence)
+            port->m_geofence->update(fix);
+    }
 
-        emit received(arr);
+    // the filter sees every fix, not only the delivered ones
+    port->m_trackFilter.update(&port->m_trackState, fix, fix.published_ns);
+    port->m_smoothed.store(port->m_trackState);
+
+    int flushIn = -1;
+    {
+        QMutexLocker locker(&port->m_coalescerLock);
+        if (!port->m_coalescer.offer(fix, fix.published_ns)) {
+            if (!port->m_coalescer.has_pending() || port->m_flushScheduled)
+                return;
+            port->m_flushScheduled = true;
+            quint64 now = gps_clock_ns();
+            quint64 due = port->m_coalescer.due_ns();
+            flushIn = due > now ? int((due - now + 999999) / 1000000) : 0;
+        } else if (port->m_fixCallback) {
+            port->m_fixCallback(fix);
+        }
     }
+
+    if (flushIn >= 0)
+        QMetaObject::invokeMethod(&port->m_flushTimer, "start", Qt::QueuedConnection, Q_ARG(int, flushIn));
+    else
+        emit port->fixUpdated(fix);
 }
 
-void SerialPort::handleTimeout()
+// Parser callback for acknowledgements, on the thread that encodes
+void SerialPort::handleAck(const GpsAck &ack, void *context)
 {
-    float latitude, longitude;
+    emit static_cast<SerialPort *>(context)->acknowledged(ack);
+}
 
-    m_gps.f_get_position(&latitude, &longitude);
-    qDebug() << "Lat: " << latitude << " Long: " << longitude;
-    m_timer.stop();
+// A fix held back by the rate limit is due
+void SerialPort::flushPendingFix()
+{
+    GpsFix fix;
+    {
+        QMutexLocker locker(&m_coalescerLock);
+        m_flushScheduled = false;
+        if (!m_coalescer.take_pending(gps_clock_ns(), &fix))
+            return; // superseded by a fix delivered meanwhile
+        if (m_fixCallback)
+            m_fixCallback(fix);
+    }
+    emit fixUpdated(fix);
 }
 
 void SerialPort::handleError(QSerialPort::SerialPortError serialPortError)
@@ -65,12 +179,115 @@ void SerialPort::handleError(QSerialPort::SerialPortError serialPortError)
     }
 }
 
+GpsFix SerialPort::fix() const
+{
+    GpsFix fix = m_fix.load();
+    m_latency.record_fix_age(fix);
+    return fix;
+}
+
+bool SerialPort::estimate(quint64 atNs, TrackFilter::Estimate *estimate) const
+{
+    return m_trackFilter.predict(m_smoothed.load(), atNs, estimate);
+}
+
 int SerialPort::available()
 {
     return m_content.size();
 }
 
-QByteArray SerialPort::content()
+ByteSlice SerialPort::content()
 {
     return m_content;
 }
+
+bool SerialPort::recordTrack(const QString &fileName)
+{
+    std::unique_ptr<TrackWriter> track(new TrackWriter(fileName));
+    QString error;
+    if (!track->open(&error)) {
+        qDebug() << error;
+        return false;
+    }
+    m_track = std::move(track);
+    return true;
+}
+
+bool SerialPort::recordCapture(const QString &fileName)
+{
+    std::unique_ptr<CaptureWriter> capture(new CaptureWriter(fileName));
+    QString error;
+    if (!capture->open(&error)) {
+        qDebug() << error;
+        return false;
+    }
+    m_capture = std::move(capture);
+    return true;
+}
+
+GeofenceMonitor *SerialPort::watchGeofences(const GeofenceIndex *index)
+{
+    delete m_geofence;
+    m_geofence = new GeofenceMonitor(index, this);
+    return m_geofence;
+}
+
+void SerialPort::setFixRate(int maxPerSecond, bool changesOnly)
+{
+    QMutexLocker locker(&m_coalescerLock);
+    m_coalescer.set_max_rate(unsigned(qMax(0, maxPerSecond)));
+    m_coalescer.set_changes_only(changesOnly);
+}
+
+void SerialPort::setFixCallback(const std::function<void(const GpsFix &)> &callback)
+{
+    QMutexLocker locker(&m_coalescerLock);
+    m_fixCallback = callback;
+}
+
+bool SerialPort::writeCommand(const QByteArray &bytes)
+{
+    if (m_ioThread) {
+        m_ioThread->write(bytes);
+        return true;
+    }
+    if (!m_device || !m_device->isWritable())
+        return false;
+    return m_device->write(bytes) == bytes.size();
+}
+
+void SerialPort::setBaudRate(qint32 baudRate)
+{
+    m_baudRate = baudRate;
+    if (m_ioThread) {
+        m_ioThread->setBaudRate(baudRate);
+        return;
+    }
+    if (m_serialPort) {
+        // the command that changed the receiver's speed leaves at the old
+        // one; what arrived meanwhile is garbage at either speed
+        while (m_serialPort->bytesToWrite() > 0 && m_serialPort->waitForBytesWritten(100)) {
+        }
+        m_serialPort->setBaudRate(baudRate);
+        m_serialPort->clear(QSerialPort::Input);
+    }
+    // reads are parsed as they come in this mode, nothing is left behind
+    emit baudRateChanged(baudRate);
+}
+
+GpsStats SerialPort::parserStats() const
+{
+    GpsStats stats = {};
+#ifndef GPS_NO_STATS
+    m_gps.stats(&stats);
+#endif
+    return stats;
+}
+
+SerialIoThread::Stats SerialPort::ioStats() const
+{
+    SerialIoThread::Stats stats = {};
+    if (m_ioThread)
+        stats = m_ioThread->stats();
+    return stats;
+}
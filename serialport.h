@@ -1,35 +1,142 @@
 #ifndef SERIALPORT_H
 #define SERIALPORT_H
 
+#include <QMutex>
 #include <QObject>
 #include <QSerialPort>
 #include <QTimer>
 
+#include <functional>
+#include <memory>
+
+#include "bufferpool.h"
+#include "fixcoalescer.h"
+#include "geofence.h"
+#include "nmeacapture.h"
+#include "receivercommand.h"
+#include "serialiothread.h"
 #include "tinygps.h"
+#include "trackfilter.h"
+#include "trackformat.h"
 
 class SerialPort : public QObject
 {
     Q_OBJECT
 public:
-    explicit SerialPort(QObject *parent = nullptr);
+    enum IoMode {
+        EventLoopIo,    // read and parse in this object's thread
+        ThreadedIo      // read and parse on dedicated threads, see SerialIoThread
+    };
+
+    // COM3 at 9600 baud
+    explicit SerialPort(QObject *parent = nullptr, IoMode mode = EventLoopIo);
+    SerialPort(const QString &portName, qint32 baudRate, IoMode mode = EventLoopIo, QObject *parent = nullptr);
+    // reads device instead of the serial port (EventLoopIo), e.g. a CaptureDevice
+    explicit SerialPort(QIODevice *device, QObject *parent = nullptr);
+    ~SerialPort();
 
+    // the last chunk read, shared with the received() subscribers
     int available();
-    QByteArray content();
+    ByteSlice content();
+
+    // last published fix; safe to call from any thread
+    GpsFix fix() const;
+
+    // smoothed position at atNs, a gps_clock_ns() time, dead-reckoned from
+    // the fixes so far (see TrackFilter); safe to call from any thread, at
+    // any rate
+    bool estimate(quint64 atNs, TrackFilter::Estimate *estimate) const;
+
+    // port-to-fix latency histograms, see GpsLatency
+    const GpsLatency &latency() const { return m_latency; }
+
+    // append every new position fix to a binary track file (EventLoopIo mode)
+    bool recordTrack(const QString &fileName);
+
+    // write every chunk read, with its time, to a capture file for
+    // CaptureDevice (EventLoopIo mode)
+    bool recordCapture(const QString &fileName);
+
+    // check every new fix against the fences (EventLoopIo mode); connect to
+    // the returned monitor's entered()/exited() signals
+    GeofenceMonitor *watchGeofences(const GeofenceIndex *index);
+
+    // ring counters; all zero in EventLoopIo mode
+    SerialIoThread::Stats ioStats() const;
+
+    // parser counters; safe to call from any thread
+    GpsStats parserStats() const;
+
+    // deliver at most maxPerSecond fixes (0: all of them) and, with
+    // changesOnly, only those that differ from the previous one; a fix held
+    // back by the rate is delivered at the end of its interval
+    void setFixRate(int maxPerSecond, bool changesOnly = false);
+
+    // called on the parsing thread for every delivered fix, before
+    // fixUpdated(); for consumers that cannot wait for an event loop. It must
+    // not call back into this port.
+    void setFixCallback(const std::function<void(const GpsFix &)> &callback);
+
+    QString portName() const { return m_portName; }
+
+    // send a configuration command to the receiver, see ReceiverConfigurator;
+    // false if the port is not open for writing
+    bool writeCommand(const QByteArray &bytes);
+    // change the host side of the port to match the receiver, once the
+    // commands written so far have been sent; baudRateChanged() follows
+    void setBaudRate(qint32 baudRate);
+    qint32 baudRate() const { return m_baudRate; }
 
 signals:
-    void received(QByteArray);
+    // every chunk read from the port (EventLoopIo mode); the slice shares
+    // the read buffer, copy it with toByteArray() to keep it for long
+    void received(const ByteSlice &data);
+    // a sentence was validated; emitted from the parsing thread, so
+    // connections to objects in other threads are queued
+    void fixUpdated(const GpsFix &fix);
+    // the receiver answered a configuration command; emitted from the
+    // parsing thread
+    void acknowledged(const GpsAck &ack);
+    // the port runs at baudRate: input received around the switch was
+    // discarded and everything read before it has been parsed, so the parser
+    // counters from here on only see the new speed. Emitted from the parsing
+    // thread; at once for a device without a speed.
+    void baudRateChanged(qint32 baudRate);
 
 private slots:
     void handleReadyRead();
-    void handleTimeout();
     void handleError(QSerialPort::SerialPortError serialPortError);
+    void flushPendingFix();
 
 private:
+    void init();
+    static void handleFix(const GpsFix &fix, void *context);
+    static void handleAck(const GpsAck &ack, void *context);
+
+    const IoMode m_mode;
+    const QString m_portName;
+    qint32 m_baudRate = 0;
     QSerialPort *m_serialPort = nullptr;
+    QIODevice *m_device = nullptr;  // what handleReadyRead() reads, m_serialPort or not
+    SerialIoThread *m_ioThread = nullptr;
 
-    QTimer m_timer;
-    QByteArray m_content;
+    BufferPool m_readBuffers;
+    ByteSlice m_content;
     TinyGPS m_gps;
+    SeqLock<GpsFix> m_fix;
+    TrackFilter m_trackFilter;
+    TrackFilter::State m_trackState = TrackFilter::initial_state(); // parsing thread only
+    SeqLock<TrackFilter::State> m_smoothed;
+    mutable GpsLatency m_latency; // fix() records the fix age
+    std::unique_ptr<TrackWriter> m_track;
+    std::unique_ptr<CaptureWriter> m_capture;
+    GeofenceMonitor *m_geofence = nullptr;
+
+    std::function<void(const GpsFix &)> m_fixCallback;
+    QMutex m_coalescerLock; // the parser thread offers, the timer flushes
+    FixCoalescer m_coalescer;
+    bool m_flushScheduled = false;
+    QTimer m_flushTimer;
 };
 
 #endif // SERIALPORT_H
@@ -0,0 +1,402 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "nmeasimulator.h"
+
+// Simulated receivers for load and scaling tests of the parser, SerialPort
+// and GpsHub, e.g. a thousand 10 Hz receivers on pseudo-terminals read by
+// four workers:
+//
+//   nmea_sim --receivers 1000 --rate-ms 100 --output pty --list receivers.txt
+//   GPS --config receivers.txt --workers 4 --metrics-file gps.prom
+//
+// or a fast, repeatable log with faults for the benchmark:
+//
+//   nmea_sim --receivers 50 --duration 600 --fast --corrupt 0.01 --output file:load.nmea
+//
+// Outputs: "pty" opens one pseudo-terminal per receiver, which also answers
+// the configuration commands of ReceiverConfigurator; "fifo:PATTERN" and
+// "file:PATTERN" write named pipes or files, and "stdout" standard output. A
+// %1 in PATTERN is the receiver number; without one all receivers share the
+// stream. Pseudo-terminals and pipes that are not read fill up like a UART
+// nobody drains: what does not fit is dropped and counted as overrun.
+
+namespace {
+
+struct Sink
+{
+    QString name;
+    int fd = -1;
+    int slaveFd = -1;       // pty: held open, so the master never reads EIO
+    bool blocking = true;   // files and stdout wait, ptys and pipes overrun
+    bool commands = false;  // reads configuration commands
+    quint64 overrunBytes = 0;
+};
+
+bool openPty(Sink *sink, QString *error)
+{
+    sink->fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (sink->fd < 0 || grantpt(sink->fd) != 0 || unlockpt(sink->fd) != 0) {
+        *error = QString("pseudo-terminal: %1").arg(strerror(errno));
+        return false;
+    }
+    sink->name = QString::fromLocal8Bit(ptsname(sink->fd));
+
+    // raw, so that nothing written is echoed back as a command before the
+    // reader sets its own mode
+    sink->slaveFd = ::open(ptsname(sink->fd), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    termios tio;
+    if (sink->slaveFd < 0 || tcgetattr(sink->slaveFd, &tio) != 0) {
+        *error = QString("%1: %2").arg(sink->name, strerror(errno));
+        return false;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(sink->slaveFd, TCSANOW, &tio);
+    sink->blocking = false;
+    sink->commands = true;
+    return true;
+}
+
+bool openFifo(Sink *sink, QString *error)
+{
+    const QByteArray path = QFile::encodeName(sink->name);
+    if (mkfifo(path.constData(), 0644) != 0 && errno != EEXIST) {
+        *error = QString("%1: %2").arg(sink->name, strerror(errno));
+        return false;
+    }
+    // read-write: opens without a reader and never raises SIGPIPE
+    sink->fd = ::open(path.constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (sink->fd < 0) {
+        *error = QString("%1: %2").arg(sink->name, strerror(errno));
+        return false;
+    }
+    sink->blocking = false;
+    return true;
+}
+
+bool openFile(Sink *sink, QString *error)
+{
+    sink->fd = ::open(QFile::encodeName(sink->name).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (sink->fd < 0) {
+        *error = QString("%1: %2").arg(sink->name, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void writeAll(Sink *sink, const QByteArray &data)
+{
+    const char *p = data.constData();
+    qint64 left = data.size();
+    while (left > 0) {
+        const ssize_t n = ::write(sink->fd, p, size_t(left));
+        if (n > 0) {
+            p += n;
+            left -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && errno == EAGAIN && sink->blocking) {
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(sink->fd, &fds);
+            select(sink->fd + 1, nullptr, &fds, nullptr, nullptr);
+        } else {
+            sink->overrunBytes += quint64(left);
+            return;
+        }
+    }
+}
+
+// Receivers and where each one writes
+class Simulation
+{
+public:
+    Simulation(const NmeaSimulator::Config &config) : m_simulator(config) {}
+
+    bool open(const QString &output, QString *error);
+    bool writeList(const QString &fileName, QString *error) const;
+
+    // every epoch due at nowMs, for every receiver
+    void poll(qint64 nowMs);
+    // answers whatever commands the pseudo-terminals have received
+    void readCommands();
+
+    const NmeaSimulator &simulator() const { return m_simulator; }
+    int sinkCount() const { return int(m_sinks.size()); }
+    const Sink &sink(int index) const { return *m_sinks[index]; }
+    quint64 overrunBytes() const;
+
+private:
+    NmeaSimulator m_simulator;
+    std::vector<std::unique_ptr<Sink>> m_sinks;
+    std::vector<int> m_sinkOf;  // by receiver
+    std::vector<pollfd> m_commandFds;
+    std::vector<int> m_commandReceivers;
+    QByteArray m_buffer;
+};
+
+bool Simulation::open(const QString &output, QString *error)
+{
+    const int receivers = m_simulator.receiverCount();
+    const QString kind = output.section(':', 0, 0);
+    const QString pattern = output.section(':', 1);
+    const bool shared = kind == "stdout" || ((kind == "fifo" || kind == "file") && !pattern.contains("%1"));
+
+    if (kind != "pty" && kind != "stdout" && ((kind != "fifo" && kind != "file") || pattern.isEmpty())) {
+        *error = QString("unknown output \"%1\"").arg(output);
+        return false;
+    }
+
+    for (int receiver = 0; receiver < receivers; ++receiver) {
+        if (shared && receiver > 0) {
+            m_sinkOf.push_back(0);
+            continue;
+        }
+
+        std::unique_ptr<Sink> sink(new Sink);
+        bool ok;
+        if (kind == "pty") {
+            ok = openPty(sink.get(), error);
+        } else if (kind == "stdout") {
+            sink->name = "stdout";
+            sink->fd = STDOUT_FILENO;
+            ok = true;
+        } else {
+            sink->name = shared ? pattern : pattern.arg(receiver);
+            ok = kind == "fifo" ? openFifo(sink.get(), error) : openFile(sink.get(), error);
+        }
+        if (!ok)
+            return false;
+        if (sink->commands) {
+            m_commandFds.push_back({sink->fd, POLLIN, 0});
+            m_commandReceivers.push_back(receiver);
+        }
+        m_sinkOf.push_back(int(m_sinks.size()));
+        m_sinks.push_back(std::move(sink));
+    }
+    return true;
+}
+
+// one receiver spec per line, as GpsHub's --config reads them
+bool Simulation::writeList(const QString &fileName, QString *error) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        *error = file.errorString();
+        return false;
+    }
+    QTextStream out(&file);
+    for (const std::unique_ptr<Sink> &sink : m_sinks)
+        out << sink->name << ":9600\n";
+    return true;
+}
+
+void Simulation::poll(qint64 nowMs)
+{
+    for (int receiver = 0; receiver < m_simulator.receiverCount(); ++receiver) {
+        if (m_simulator.nextEpochMs(receiver) > nowMs)
+            continue;
+        m_buffer.clear();
+        if (m_simulator.poll(receiver, nowMs, &m_buffer))
+            writeAll(m_sinks[m_sinkOf[receiver]].get(), m_buffer);
+    }
+}
+
+void Simulation::readCommands()
+{
+    if (m_commandFds.empty() || ::poll(m_commandFds.data(), m_commandFds.size(), 0) <= 0)
+        return;
+
+    char buffer[512];
+    for (size_t i = 0; i < m_commandFds.size(); ++i) {
+        if (!(m_commandFds[i].revents & POLLIN))
+            continue;
+        const int receiver = m_commandReceivers[i];
+        Sink *sink = m_sinks[m_sinkOf[receiver]].get();
+        ssize_t n;
+        while ((n = ::read(sink->fd, buffer, sizeof(buffer))) > 0) {
+            QByteArray reply;
+            m_simulator.receive(receiver, QByteArray(buffer, int(n)), &reply);
+            if (!reply.isEmpty())
+                writeAll(sink, reply);
+        }
+    }
+}
+
+quint64 Simulation::overrunBytes() const
+{
+    quint64 bytes = 0;
+    for (const std::unique_ptr<Sink> &sink : m_sinks)
+        bytes += sink->overrunBytes;
+    return bytes;
+}
+
+void printStats(const Simulation &simulation, double seconds)
+{
+    const NmeaSimulator::Stats stats = simulation.simulator().stats();
+    QTextStream(stderr) << stats.epochs << " epochs, " << stats.sentences << " sentences, "
+                        << stats.bytes << " bytes in " << seconds << " s ("
+                        << stats.bytes / qMax(seconds, 1e-9) / 1e6 << " MB/s); faults: "
+                        << stats.corrupted << " corrupted, " << stats.truncated << " truncated, "
+                        << stats.noiseBytes << " noise bytes, " << stats.droppedEpochs << " epochs dropped, "
+                        << stats.bursts << " bursts; " << stats.commands << " commands; "
+                        << simulation.overrunBytes() << " bytes overrun\n";
+}
+
+bool parseTrajectory(const QString &name, NmeaSimulator::Trajectory::Kind *kind)
+{
+    if (name == "static")
+        *kind = NmeaSimulator::Trajectory::Static;
+    else if (name == "line")
+        *kind = NmeaSimulator::Trajectory::Line;
+    else if (name == "circle")
+        *kind = NmeaSimulator::Trajectory::Circle;
+    else if (name == "walk")
+        *kind = NmeaSimulator::Trajectory::RandomWalk;
+    else
+        return false;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    signal(SIGPIPE, SIG_IGN);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Simulated NMEA receivers for load tests.");
+    parser.addHelpOption();
+    QCommandLineOption receiversOption("receivers", "Number of receivers.", "N", "1");
+    QCommandLineOption rateOption("rate-ms", "Update interval of every receiver.", "ms", "1000");
+    QCommandLineOption sentencesOption("sentences", "Sentences per epoch, e.g. GGA,RMC,GSA,GSV,UBX-NAV-PVT.", "list", "GGA,RMC");
+    QCommandLineOption outputOption("output", "pty, fifo:PATTERN, file:PATTERN or stdout.", "output", "stdout");
+    QCommandLineOption listOption("list", "Write the receivers' device names to this file, for GPS --config.", "file");
+    QCommandLineOption durationOption("duration", "Seconds of output; 0 runs until killed, or a minute with --fast.", "s", "0");
+    QCommandLineOption fastOption("fast", "Generate the whole duration as fast as possible (fifo, file or stdout).");
+    QCommandLineOption statsOption("stats", "Print the counters every N seconds.", "N");
+    QCommandLineOption seedOption("seed", "Seed of positions and faults.", "N", "1");
+    QCommandLineOption trajectoryOption("trajectory", "static, line, circle or walk.", "kind", "circle");
+    QCommandLineOption originOption("origin", "Where the receivers start, latitude,longitude.", "lat,long", "48.1173,11.5167");
+    QCommandLineOption speedOption("speed", "Speed in m/s.", "m/s", "15");
+    QCommandLineOption courseOption("course", "Course in degrees, for line and walk.", "degrees", "90");
+    QCommandLineOption radiusOption("radius", "Circle radius in m.", "m", "200");
+    QCommandLineOption spreadOption("spread", "Receivers start within this many m of each other.", "m", "5000");
+    QCommandLineOption jitterOption("jitter", "Position noise in m, 1 sigma.", "m", "0");
+    QCommandLineOption corruptOption("corrupt", "Fraction of sentences with a changed byte.", "fraction", "0");
+    QCommandLineOption truncateOption("truncate", "Fraction of sentences cut short.", "fraction", "0");
+    QCommandLineOption noiseOption("noise", "Chance per epoch of random bytes before it.", "p", "0");
+    QCommandLineOption dropoutOption("dropouts", "Chance per epoch of going silent.", "p", "0");
+    QCommandLineOption dropoutEpochsOption("dropout-epochs", "Length of a dropout.", "epochs", "5");
+    QCommandLineOption burstOption("bursts", "Chance per epoch of holding output back.", "p", "0");
+    QCommandLineOption burstEpochsOption("burst-epochs", "Epochs held back and sent at once.", "epochs", "10");
+    parser.addOptions({receiversOption, rateOption, sentencesOption, outputOption, listOption,
+                       durationOption, fastOption, statsOption, seedOption,
+                       trajectoryOption, originOption, speedOption, courseOption, radiusOption,
+                       spreadOption, jitterOption,
+                       corruptOption, truncateOption, noiseOption, dropoutOption, dropoutEpochsOption,
+                       burstOption, burstEpochsOption});
+    parser.process(a);
+
+    NmeaSimulator::Config config;
+    config.receivers = qMax(1, parser.value(receiversOption).toInt());
+    config.intervalMs = qMax(1, parser.value(rateOption).toInt());
+    config.seed = parser.value(seedOption).toUInt();
+    config.startMs = QDateTime::currentMSecsSinceEpoch();
+    if (!ReceiverCommand::parseSentences(parser.value(sentencesOption), &config.sentences)) {
+        qWarning("unknown sentence in %s", qPrintable(parser.value(sentencesOption)));
+        return 1;
+    }
+
+    NmeaSimulator::Trajectory &trajectory = config.trajectory;
+    if (!parseTrajectory(parser.value(trajectoryOption), &trajectory.kind)) {
+        qWarning("unknown trajectory %s", qPrintable(parser.value(trajectoryOption)));
+        return 1;
+    }
+    const QStringList origin = parser.value(originOption).split(',');
+    if (origin.size() != 2) {
+        qWarning("invalid origin %s", qPrintable(parser.value(originOption)));
+        return 1;
+    }
+    trajectory.latitude = origin[0].toDouble();
+    trajectory.longitude = origin[1].toDouble();
+    trajectory.speed = parser.value(speedOption).toDouble();
+    trajectory.course = parser.value(courseOption).toDouble();
+    trajectory.radius = parser.value(radiusOption).toDouble();
+    trajectory.spread = parser.value(spreadOption).toDouble();
+    trajectory.positionNoise = parser.value(jitterOption).toDouble();
+
+    NmeaSimulator::Faults &faults = config.faults;
+    faults.corruptSentences = parser.value(corruptOption).toDouble();
+    faults.truncateSentences = parser.value(truncateOption).toDouble();
+    faults.noiseBursts = parser.value(noiseOption).toDouble();
+    faults.dropouts = parser.value(dropoutOption).toDouble();
+    faults.dropoutEpochs = parser.value(dropoutEpochsOption).toInt();
+    faults.bursts = parser.value(burstOption).toDouble();
+    faults.burstEpochs = parser.value(burstEpochsOption).toInt();
+
+    Simulation simulation(config);
+    QString error;
+    if (!simulation.open(parser.value(outputOption), &error)
+            || (parser.isSet(listOption) && !simulation.writeList(parser.value(listOption), &error))) {
+        qWarning("%s", qPrintable(error));
+        return 1;
+    }
+    if (parser.value(outputOption) == "pty" && !parser.isSet(listOption)) {
+        for (int i = 0; i < simulation.sinkCount(); ++i)
+            QTextStream(stderr) << simulation.sink(i).name << '\n';
+    }
+
+    const qint64 durationMs = qint64(parser.value(durationOption).toDouble() * 1000);
+    QElapsedTimer clock;
+    clock.start();
+
+    if (parser.isSet(fastOption)) {
+        // simulated time only, one interval at a time so that shared
+        // outputs interleave the receivers as they would live
+        const qint64 endMs = config.startMs + (durationMs > 0 ? durationMs : 60000);
+        for (qint64 nowMs = config.startMs; nowMs <= endMs; nowMs += config.intervalMs)
+            simulation.poll(nowMs);
+        printStats(simulation, clock.nsecsElapsed() / 1e9);
+        return 0;
+    }
+
+    QTimer tick;
+    tick.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&tick, &QTimer::timeout, [&]() {
+        const qint64 elapsedMs = clock.elapsed();
+        simulation.readCommands();
+        simulation.poll(config.startMs + elapsedMs);
+        if (durationMs > 0 && elapsedMs >= durationMs)
+            a.quit();
+    });
+    tick.start(qBound(1, config.intervalMs / 10, 10));
+
+    QTimer statsTimer;
+    if (parser.isSet(statsOption)) {
+        QObject::connect(&statsTimer, &QTimer::timeout, [&]() { printStats(simulation, clock.nsecsElapsed() / 1e9); });
+        statsTimer.start(qMax(1, parser.value(statsOption).toInt()) * 1000);
+    }
+
+    const int result = a.exec();
+    printStats(simulation, clock.nsecsElapsed() / 1e9);
+    return result;
+}
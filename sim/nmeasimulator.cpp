@@ -0,0 +1,520 @@
+#include "nmeasimulator.h"
+
+#include <QList>
+#include <QString>
+
+#include <cmath>
+#include <cstdarg>
+#include <iterator>
+
+#include "gpstime.h"
+
+namespace {
+
+const double TwoPi = 6.283185307179586;
+const double MetersPerDegree = 111320.0;    // of latitude, and of longitude at the equator
+const double DegreesPerRadian = 57.29577951308232;
+const double KnotsPerMps = 1.9438444924406;
+
+// the constellation every receiver sees, from its own position in the sky
+const quint8 Prns[] = {2, 5, 7, 9, 13, 15, 18, 21, 26, 29};
+const int SatellitesUsed = 8;
+
+// PMTK314 field of each NMEA sentence, the inverse of ReceiverCommand::setSentences()
+struct MtkField
+{
+    quint8 field;
+    quint8 type;
+};
+
+const MtkField MtkFields[] = {
+    {0, TinyGPS::GPS_SENTENCE_GLL},
+    {1, TinyGPS::GPS_SENTENCE_RMC},
+    {2, TinyGPS::GPS_SENTENCE_VTG},
+    {3, TinyGPS::GPS_SENTENCE_GGA},
+    {4, TinyGPS::GPS_SENTENCE_GSA},
+    {5, TinyGPS::GPS_SENTENCE_GSV},
+    {17, TinyGPS::GPS_SENTENCE_ZDA},
+};
+
+// CFG-MSG class and id of each message
+struct UbxMessage
+{
+    quint8 messageClass;
+    quint8 id;
+    quint8 type;
+};
+
+const UbxMessage UbxMessages[] = {
+    {0xF0, 0x00, TinyGPS::GPS_SENTENCE_GGA},
+    {0xF0, 0x01, TinyGPS::GPS_SENTENCE_GLL},
+    {0xF0, 0x02, TinyGPS::GPS_SENTENCE_GSA},
+    {0xF0, 0x03, TinyGPS::GPS_SENTENCE_GSV},
+    {0xF0, 0x04, TinyGPS::GPS_SENTENCE_RMC},
+    {0xF0, 0x05, TinyGPS::GPS_SENTENCE_VTG},
+    {0xF0, 0x08, TinyGPS::GPS_SENTENCE_ZDA},
+    {0x01, 0x07, TinyGPS::GPS_SENTENCE_UBX_PVT},
+    {0x01, 0x35, TinyGPS::GPS_SENTENCE_UBX_SAT},
+};
+
+const quint32 NmeaSentences = (1u << TinyGPS::GPS_SENTENCE_UBX_PVT) - 1;
+const int MaxCommandLength = 512;
+
+template<typename T>
+void put(QByteArray *payload, int offset, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i)
+        (*payload)[offset + int(i)] = char(quint64(value) >> (8 * i) & 0xFF);
+}
+
+QByteArray format(const char *format, ...) Q_ATTRIBUTE_FORMAT_PRINTF(1, 2);
+
+QByteArray format(const char *format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    const QString result = QString::vasprintf(format, ap);
+    va_end(ap);
+    return result.toLatin1();
+}
+
+// ddmm.mmmmm or dddmm.mmmmm and the hemisphere
+QByteArray angle(double degrees, int degreeDigits, char positive, char negative)
+{
+    const qint64 units = std::llround(std::fabs(degrees) * 60 * 100000); // 10^-5 minutes
+    return format("%0*lld%02lld.%05lld,%c", degreeDigits, units / 6000000, units / 100000 % 60, units % 100000,
+                  degrees < 0 ? negative : positive);
+}
+
+bool hasChecksum(const QByteArray &sentence, QByteArray *body)
+{
+    // $body*hh
+    const int star = sentence.lastIndexOf('*');
+    if (star < 1 || sentence.size() - star != 3)
+        return false;
+    *body = sentence.mid(1, star - 1);
+    bool ok;
+    const int expected = sentence.mid(star + 1).toInt(&ok, 16);
+    quint8 checksum = 0;
+    for (char c : *body)
+        checksum ^= quint8(c);
+    return ok && checksum == expected;
+}
+
+} // namespace
+
+NmeaSimulator::NmeaSimulator(const Config &config)
+    : m_config(config)
+    , m_receivers(qMax(1, config.receivers))
+    , m_random(config.seed)
+{
+    m_config.intervalMs = qMax(1, m_config.intervalMs);
+    const qint64 firstEpochMs = (m_config.startMs + m_config.intervalMs - 1) / m_config.intervalMs * m_config.intervalMs;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    for (Receiver &receiver : m_receivers) {
+        // uniform over a disk
+        const double distance = m_config.trajectory.spread / 2 * std::sqrt(unit(m_random));
+        const double bearing = TwoPi * unit(m_random);
+        receiver.east = distance * std::sin(bearing);
+        receiver.north = distance * std::cos(bearing);
+        receiver.course = m_config.trajectory.kind == Trajectory::Circle ? 360 * unit(m_random) : m_config.trajectory.course;
+        receiver.phase = TwoPi * unit(m_random);
+        receiver.sentences = m_config.sentences;
+        receiver.intervalMs = m_config.intervalMs;
+        receiver.nextEpochMs = receiver.lastEpochMs = firstEpochMs;
+    }
+}
+
+bool NmeaSimulator::chance(double probability)
+{
+    return probability > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < probability;
+}
+
+bool NmeaSimulator::poll(int index, qint64 nowMs, QByteArray *out)
+{
+    Receiver &receiver = m_receivers[index];
+    const Faults &faults = m_config.faults;
+    bool written = false;
+
+    while (receiver.nextEpochMs <= nowMs) {
+        const qint64 epochMs = receiver.nextEpochMs;
+        advance(&receiver, (epochMs - receiver.lastEpochMs) / 1000.0);
+        receiver.lastEpochMs = epochMs;
+        receiver.nextEpochMs += receiver.intervalMs;
+        ++m_stats.epochs;
+
+        if (receiver.silentEpochs == 0 && chance(faults.dropouts))
+            receiver.silentEpochs = qMax(1, faults.dropoutEpochs);
+        if (receiver.silentEpochs > 0) {
+            --receiver.silentEpochs;
+            ++m_stats.droppedEpochs;
+            continue;
+        }
+
+        if (receiver.heldEpochs == 0 && chance(faults.bursts)) {
+            receiver.heldEpochs = qMax(1, faults.burstEpochs);
+            ++m_stats.bursts;
+        }
+        QByteArray *target = receiver.heldEpochs > 0 ? &receiver.held : out;
+
+        if (chance(faults.noiseBursts)) {
+            const int count = 1 + int(m_random() % quint32(qMax(1, faults.noiseBytes)));
+            for (int i = 0; i < count; ++i)
+                target->append(char(m_random() & 0xFF));
+            m_stats.noiseBytes += quint64(count);
+            m_stats.bytes += quint64(count);
+        }
+        epoch(&receiver, epochMs, target);
+
+        if (receiver.heldEpochs > 0) {
+            if (--receiver.heldEpochs > 0)
+                continue;
+            out->append(receiver.held);
+            receiver.held.clear();
+        }
+        written = true;
+    }
+    return written;
+}
+
+// Moves the receiver dt seconds along its trajectory
+void NmeaSimulator::advance(Receiver *receiver, double dt)
+{
+    const Trajectory &trajectory = m_config.trajectory;
+    receiver->phase += dt / 60;
+    if (trajectory.kind == Trajectory::Static || dt <= 0)
+        return;
+
+    const double course = receiver->course / DegreesPerRadian;
+    const double distance = trajectory.speed * dt;
+
+    if (trajectory.kind == Trajectory::Circle && trajectory.radius > 0) {
+        // exact arc, clockwise
+        const double turn = distance / trajectory.radius;
+        receiver->east += trajectory.radius * (std::cos(course) - std::cos(course + turn));
+        receiver->north += trajectory.radius * (std::sin(course + turn) - std::sin(course));
+        receiver->course = std::fmod(receiver->course + turn * DegreesPerRadian, 360.0);
+        return;
+    }
+
+    receiver->east += distance * std::sin(course);
+    receiver->north += distance * std::cos(course);
+    if (trajectory.kind == Trajectory::RandomWalk) {
+        std::normal_distribution<double> turn(0.0, trajectory.turnRate * std::sqrt(dt));
+        receiver->course = std::fmod(receiver->course + turn(m_random) + 360.0, 360.0);
+    }
+}
+
+NmeaSimulator::Position NmeaSimulator::position(const Receiver &receiver)
+{
+    const Trajectory &trajectory = m_config.trajectory;
+    double east = receiver.east, north = receiver.north;
+    if (trajectory.positionNoise > 0) {
+        std::normal_distribution<double> noise(0.0, trajectory.positionNoise);
+        east += noise(m_random);
+        north += noise(m_random);
+    }
+
+    Position position;
+    position.latitude = trajectory.latitude + north / MetersPerDegree;
+    position.longitude = trajectory.longitude + east / (MetersPerDegree * std::cos(trajectory.latitude / DegreesPerRadian));
+    position.altitude = trajectory.altitude + 5 * std::sin(receiver.phase);
+    position.speed = trajectory.kind == Trajectory::Static ? 0.0 : trajectory.speed;
+    position.course = receiver.course;
+    return position;
+}
+
+// One epoch of output: the enabled sentences in the order MTK receivers use,
+// then the UBX frames
+void NmeaSimulator::epoch(Receiver *receiver, qint64 epochMs, QByteArray *out)
+{
+    const Position p = position(*receiver);
+    const quint32 sentences = receiver->sentences;
+
+    int year;
+    unsigned month, day;
+    gpstime::civil_from_days(epochMs / gpstime::MsPerDay, &year, &month, &day);
+    const qint64 ms = epochMs % gpstime::MsPerDay;
+    const QByteArray time = format("%02lld%02lld%02lld.%02lld", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000 / 10);
+    const QByteArray date = format("%02u%02u%02d", day, month, year % 100);
+    const QByteArray latitude = angle(p.latitude, 2, 'N', 'S');
+    const QByteArray longitude = angle(p.longitude, 3, 'E', 'W');
+    const double knots = p.speed * KnotsPerMps;
+
+    // satellites drift across the sky with the receiver's phase
+    quint8 elevations[std::size(Prns)];
+    quint16 azimuths[std::size(Prns)];
+    quint8 snrs[std::size(Prns)];
+    for (size_t i = 0; i < std::size(Prns); ++i) {
+        const double sky = receiver->phase + i * 0.7;
+        elevations[i] = quint8(10 + 35 * (1 + std::sin(sky)));
+        azimuths[i] = quint16(int(i * 36 + receiver->phase * DegreesPerRadian) % 360);
+        snrs[i] = quint8(25 + elevations[i] / 4);
+    }
+
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_GGA)
+        emitSentence("GPGGA," + time + ',' + latitude + ',' + longitude + ",1,"
+                     + format("%02d,0.9,%.1f,M,46.9,M,,", SatellitesUsed, p.altitude), out);
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_GLL)
+        emitSentence("GPGLL," + latitude + ',' + longitude + ',' + time + ",A,A", out);
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_GSA) {
+        QByteArray body("GPGSA,A,3,");
+        for (int i = 0; i < 12; ++i)
+            body += (i < SatellitesUsed ? format("%02u", Prns[i]) : QByteArray()) + ',';
+        emitSentence(body + "1.6,0.9,1.3", out);
+    }
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_GSV) {
+        const int count = int(std::size(Prns));
+        const int messages = (count + 3) / 4;
+        for (int message = 0; message < messages; ++message) {
+            QByteArray body = format("GPGSV,%d,%d,%02d", messages, message + 1, count);
+            for (int i = message * 4; i < qMin(count, message * 4 + 4); ++i)
+                body += format(",%02u,%02u,%03u,%02u", Prns[i], elevations[i], azimuths[i], snrs[i]);
+            emitSentence(body, out);
+        }
+    }
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_RMC)
+        emitSentence("GPRMC," + time + ",A," + latitude + ',' + longitude + ','
+                     + format("%.2f,%.2f,", knots, p.course) + date + ",,,A", out);
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_VTG)
+        emitSentence(format("GPVTG,%.2f,T,,M,%.2f,N,%.2f,K,A", p.course, knots, p.speed * 3.6), out);
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_ZDA)
+        emitSentence("GPZDA," + time + format(",%02u,%02u,%04d,00,00", day, month, year), out);
+
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_UBX_PVT) {
+        QByteArray pvt(92, '\0');
+        put(&pvt, 0, quint32((epochMs / gpstime::MsPerDay + 4) % 7 * gpstime::MsPerDay + ms)); // iTOW, weeks start on Sunday
+        put(&pvt, 4, quint16(year));
+        put(&pvt, 6, quint8(month));
+        put(&pvt, 7, quint8(day));
+        put(&pvt, 8, quint8(ms / 3600000));
+        put(&pvt, 9, quint8(ms / 60000 % 60));
+        put(&pvt, 10, quint8(ms / 1000 % 60));
+        put(&pvt, 11, quint8(0x07));                    // date, time, fully resolved
+        put(&pvt, 16, qint32(ms % 1000 * 1000000));     // ns
+        put(&pvt, 20, quint8(3));                       // 3D
+        put(&pvt, 21, quint8(0x01));                    // fix OK
+        put(&pvt, 23, quint8(SatellitesUsed));
+        put(&pvt, 24, qint32(std::llround(p.longitude * 1e7)));
+        put(&pvt, 28, qint32(std::llround(p.latitude * 1e7)));
+        put(&pvt, 32, qint32(std::llround((p.altitude + 46.9) * 1000)));
+        put(&pvt, 36, qint32(std::llround(p.altitude * 1000)));
+        const double course = p.course / DegreesPerRadian;
+        put(&pvt, 48, qint32(std::llround(p.speed * std::cos(course) * 1000)));
+        put(&pvt, 52, qint32(std::llround(p.speed * std::sin(course) * 1000)));
+        put(&pvt, 60, qint32(std::llround(p.speed * 1000)));
+        put(&pvt, 64, qint32(std::llround(p.course * 100000)));
+        put(&pvt, 76, quint16(160));
+        emitUbx(0x07, pvt, out);
+    }
+    if (sentences & 1u << TinyGPS::GPS_SENTENCE_UBX_SAT) {
+        const int count = int(std::size(Prns));
+        QByteArray sat(8 + 12 * count, '\0');
+        put(&sat, 0, quint32(ms));
+        put(&sat, 4, quint8(1));
+        put(&sat, 5, quint8(count));
+        for (int i = 0; i < count; ++i) {
+            put(&sat, 8 + 12 * i + 1, Prns[i]);
+            put(&sat, 8 + 12 * i + 2, snrs[i]);
+            put(&sat, 8 + 12 * i + 3, qint8(elevations[i]));
+            put(&sat, 8 + 12 * i + 4, qint16(azimuths[i]));
+            put(&sat, 8 + 12 * i + 8, quint32(i < SatellitesUsed ? 0x0F : 0x07));
+        }
+        emitUbx(0x35, sat, out);
+    }
+}
+
+void NmeaSimulator::emitSentence(const QByteArray &body, QByteArray *out)
+{
+    emitFaulty(ReceiverCommand::nmeaSentence(body), out);
+}
+
+void NmeaSimulator::emitUbx(quint8 id, const QByteArray &payload, QByteArray *out)
+{
+    emitFaulty(ReceiverCommand::ubxFrame(0x01, id, payload), out);
+}
+
+// Appends one sentence or frame, cut short or with a byte changed if the
+// faults say so
+void NmeaSimulator::emitFaulty(QByteArray frame, QByteArray *out)
+{
+    const Faults &faults = m_config.faults;
+    const bool nmea = frame.startsWith('$');
+
+    if (chance(faults.truncateSentences)) {
+        frame.truncate(1 + int(m_random() % quint32(frame.size() - 1)));
+        ++m_stats.truncated;
+    } else if (chance(faults.corruptSentences)) {
+        // NMEA: a character of the body other than a comma, which stays
+        // printable and is never '$' since the body has no '%'; UBX: a
+        // payload byte, so that the frame keeps its length. Either way
+        // exactly one checksum fails.
+        const int first = nmea ? 1 : 6;
+        const int last = frame.size() - (nmea ? 5 : 2);
+        int offset = last > first ? first + int(m_random() % quint32(last - first)) : last;
+        while (nmea && offset < last && frame[offset] == ',')
+            ++offset;
+        if (offset < last) {
+            frame[offset] = char(frame[offset] ^ 0x01);
+            ++m_stats.corrupted;
+        }
+    }
+
+    out->append(frame);
+    ++m_stats.sentences;
+    m_stats.bytes += quint64(frame.size());
+}
+
+void NmeaSimulator::receive(int index, const QByteArray &bytes, QByteArray *reply)
+{
+    Receiver &receiver = m_receivers[index];
+    QByteArray &input = receiver.input;
+    input += bytes;
+
+    int offset = 0;
+    while (offset < input.size()) {
+        // the next '$' or UBX sync byte
+        int start = offset;
+        while (start < input.size() && input[start] != '$' && quint8(input[start]) != 0xB5)
+            ++start;
+        offset = start;
+        if (start == input.size())
+            break;
+
+        if (input[start] == '$') {
+            const int end = input.indexOf('\n', start);
+            if (end < 0)
+                break;
+            QByteArray body;
+            if (hasChecksum(input.mid(start, end - start).trimmed(), &body) && command(&receiver, body, reply))
+                ++m_stats.commands;
+            offset = end + 1;
+            continue;
+        }
+
+        // sync, class, id, length, payload, checksum
+        if (input.size() - start < 6)
+            break;
+        if (quint8(input[start + 1]) != 0x62) {
+            offset = start + 1;
+            continue;
+        }
+        const int length = quint8(input[start + 4]) | quint8(input[start + 5]) << 8;
+        if (length > MaxCommandLength) {
+            offset = start + 1;
+            continue;
+        }
+        if (input.size() - start < 8 + length)
+            break;
+        const quint8 messageClass = quint8(input[start + 2]), id = quint8(input[start + 3]);
+        const QByteArray payload = input.mid(start + 6, length);
+        if (ReceiverCommand::ubxFrame(messageClass, id, payload) == input.mid(start, 8 + length)) {
+            if (ubxCommand(&receiver, messageClass, id, payload, reply))
+                ++m_stats.commands;
+            offset = start + 8 + length;
+        } else {
+            offset = start + 1;
+        }
+    }
+
+    input.remove(0, offset);
+    if (input.size() > MaxCommandLength)
+        input.clear();
+}
+
+// $PMTK and $PUBX commands; true if understood
+bool NmeaSimulator::command(Receiver *receiver, const QByteArray &body, QByteArray *reply)
+{
+    const QList<QByteArray> fields = body.split(',');
+    const QByteArray &header = fields[0];
+
+    if (header == "PUBX") {
+        if (fields.value(1) == "40" && fields.size() >= 5) {
+            // PUBX,40,msg,rddc,rus1,...: the simulated port is UART 1
+            quint32 sentence;
+            if (!ReceiverCommand::parseSentences(QString::fromLatin1(fields[2]), &sentence) || !sentence)
+                return false;
+            receiver->sentences = fields[4].toInt() ? receiver->sentences | sentence : receiver->sentences & ~sentence;
+            return true;
+        }
+        return fields.value(1) == "41"; // a pseudo-terminal has no speed
+    }
+
+    if (!header.startsWith("PMTK") || header.size() != 7)
+        return false;
+    const int commandNumber = header.mid(4).toInt();
+    int result = GpsAck::PMTK_UNSUPPORTED;
+    switch (commandNumber) {
+    case 314:
+        if (fields.size() < 1 + 19) {
+            result = GpsAck::PMTK_INVALID;
+            break;
+        }
+        receiver->sentences &= ~NmeaSentences;
+        for (const MtkField &field : MtkFields) {
+            if (fields[1 + field.field].toInt())
+                receiver->sentences |= 1u << field.type;
+        }
+        result = GpsAck::PMTK_SUCCEEDED;
+        break;
+    case 220: {
+        const int interval = fields.value(1).toInt();
+        if (interval < 100 || interval > 10000) {
+            result = GpsAck::PMTK_FAILED;
+            break;
+        }
+        receiver->intervalMs = interval;
+        receiver->nextEpochMs = receiver->lastEpochMs + interval;
+        result = GpsAck::PMTK_SUCCEEDED;
+        break;
+    }
+    case 251:
+        return true; // switches speed without an answer
+    }
+
+    *reply += ReceiverCommand::nmeaSentence(format("PMTK001,%d,%d", commandNumber, result));
+    return result == GpsAck::PMTK_SUCCEEDED;
+}
+
+// UBX CFG messages, answered with ACK-ACK or ACK-NAK; true if understood
+bool NmeaSimulator::ubxCommand(Receiver *receiver, quint8 messageClass, quint8 id, const QByteArray &payload, QByteArray *reply)
+{
+    if (messageClass != 0x06)
+        return false;
+
+    bool accepted = false;
+    switch (id) {
+    case 0x00: // CFG-PRT
+        accepted = payload.size() == 20;
+        break;
+    case 0x01: // CFG-MSG, the rate of this port in the short form or of UART 1 in the long one
+        if (payload.size() == 3 || payload.size() == 8) {
+            for (const UbxMessage &message : UbxMessages) {
+                if (message.messageClass == quint8(payload[0]) && message.id == quint8(payload[1])) {
+                    const quint32 bit = 1u << message.type;
+                    receiver->sentences = payload[payload.size() == 3 ? 2 : 3] ? receiver->sentences | bit
+                                                                               : receiver->sentences & ~bit;
+                    accepted = true;
+                }
+            }
+        }
+        break;
+    case 0x08: // CFG-RATE
+        if (payload.size() == 6) {
+            const int interval = quint8(payload[0]) | quint8(payload[1]) << 8;
+            accepted = interval >= 25;
+            if (accepted) {
+                receiver->intervalMs = interval;
+                receiver->nextEpochMs = receiver->lastEpochMs + interval;
+            }
+        }
+        break;
+    }
+
+    QByteArray acknowledged;
+    acknowledged += char(messageClass);
+    acknowledged += char(id);
+    *reply += ReceiverCommand::ubxFrame(0x05, accepted ? 0x01 : 0x00, acknowledged);
+    return accepted;
+}
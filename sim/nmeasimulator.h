@@ -0,0 +1,134 @@
+#ifndef NMEASIMULATOR_H
+#define NMEASIMULATOR_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <random>
+
+#include "receivercommand.h"
+
+// Virtual receivers for load and scaling tests. Each follows a trajectory
+// and reports it once per update interval as checksummed NMEA sentences, and
+// UBX NAV-PVT/NAV-SAT frames if asked to, the way a real receiver would: one
+// burst of output per epoch, sentences in a fixed order.
+//
+// Faults are drawn per receiver from one seeded generator, so a run is
+// repeatable:
+//   corruption  a sentence has one byte changed and fails its checksum
+//   truncation  a sentence loses its tail and line end, as if cut short
+//   noise       random bytes between two epochs, as on a noisy line
+//   dropout     the receiver goes silent for a number of epochs
+//   burst       the receiver holds its output for a number of epochs and
+//               then sends it all at once, as a stalled USB bridge does
+//
+// Receivers also answer the configuration commands of ReceiverCommand in
+// all three dialects, so ReceiverConfigurator can be tried against them.
+class NmeaSimulator
+{
+public:
+    struct Trajectory {
+        enum Kind { Static, Line, Circle, RandomWalk };
+        Kind kind = Circle;
+        double latitude = 48.1173;  // degrees, where the receivers start
+        double longitude = 11.5167;
+        double altitude = 545.4;    // m above mean sea level
+        double speed = 15.0;        // m/s
+        double course = 90.0;       // degrees, Line and the start of RandomWalk
+        double radius = 200.0;      // m, Circle
+        double turnRate = 10.0;     // degrees per second, 1 sigma, RandomWalk
+        double spread = 5000.0;     // m, receivers start within this distance of each other
+        double positionNoise = 0.0; // m, 1 sigma, added to every reported position
+    };
+
+    struct Faults {
+        double corruptSentences = 0.0;  // fraction of sentences
+        double truncateSentences = 0.0;
+        double noiseBursts = 0.0;       // chance per epoch
+        int noiseBytes = 32;            // up to this many
+        double dropouts = 0.0;          // chance per epoch
+        int dropoutEpochs = 5;
+        double bursts = 0.0;            // chance per epoch
+        int burstEpochs = 10;
+    };
+
+    struct Config {
+        int receivers = 1;
+        int intervalMs = 1000;
+        quint32 sentences = 1u << TinyGPS::GPS_SENTENCE_GGA | 1u << TinyGPS::GPS_SENTENCE_RMC;
+        qint64 startMs = 0;         // UTC milliseconds since 1970 of the first epoch
+        quint32 seed = 1;
+        Trajectory trajectory;
+        Faults faults;
+    };
+
+    struct Stats {
+        quint64 epochs;             // generated, dropped ones included
+        quint64 sentences;          // NMEA sentences and UBX frames written
+        quint64 bytes;
+        quint64 corrupted;
+        quint64 truncated;
+        quint64 noiseBytes;
+        quint64 droppedEpochs;
+        quint64 bursts;
+        quint64 commands;           // configuration commands understood
+    };
+
+    explicit NmeaSimulator(const Config &config);
+
+    int receiverCount() const { return m_receivers.size(); }
+    const Config &config() const { return m_config; }
+    Stats stats() const { return m_stats; }
+
+    // appends the output of every epoch of receiver due at or before nowMs
+    // (UTC milliseconds since 1970), faults applied; false if none was due
+    bool poll(int receiver, qint64 nowMs, QByteArray *out);
+
+    // when the next epoch of receiver is due
+    qint64 nextEpochMs(int receiver) const { return m_receivers[receiver].nextEpochMs; }
+
+    // bytes the receiver got from the host; the answers to the complete
+    // commands among them are appended to reply
+    void receive(int receiver, const QByteArray &bytes, QByteArray *reply);
+
+private:
+    struct Receiver {
+        double east = 0.0;          // m from the trajectory start
+        double north = 0.0;
+        double course = 0.0;        // degrees
+        double phase = 0.0;         // radians, for the altitude and the satellites
+        quint32 sentences = 0;
+        int intervalMs = 1000;
+        qint64 nextEpochMs = 0;
+        qint64 lastEpochMs = 0;
+        int silentEpochs = 0;       // left in a dropout
+        int heldEpochs = 0;         // left in a burst
+        QByteArray held;
+        QByteArray input;           // commands not complete yet
+    };
+
+    struct Position {
+        double latitude;
+        double longitude;
+        double altitude;
+        double speed;               // m/s
+        double course;              // degrees
+    };
+
+    void advance(Receiver *receiver, double dt);
+    Position position(const Receiver &receiver);
+    void epoch(Receiver *receiver, qint64 epochMs, QByteArray *out);
+    void emitSentence(const QByteArray &body, QByteArray *out);
+    void emitUbx(quint8 id, const QByteArray &payload, QByteArray *out);
+    void emitFaulty(QByteArray frame, QByteArray *out);
+    bool command(Receiver *receiver, const QByteArray &sentence, QByteArray *reply);
+    bool ubxCommand(Receiver *receiver, quint8 messageClass, quint8 id, const QByteArray &payload, QByteArray *reply);
+    bool chance(double probability);
+
+    Config m_config;
+    QVector<Receiver> m_receivers;
+    std::mt19937 m_random;
+    Stats m_stats = {};
+};
+
+#endif // NMEASIMULATOR_H
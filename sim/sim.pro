@@ -0,0 +1,18 @@
+QT -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = nmea_sim
+
+include(../gps.pri)
+
+# pseudo-terminals and named pipes: unix only
+SOURCES += \
+    main.cpp \
+    nmeasimulator.cpp \
+    ../receivercommand.cpp
+
+HEADERS += \
+    nmeasimulator.h \
+    ../receivercommand.h
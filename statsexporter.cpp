@@ -0,0 +1,164 @@
+#include "statsexporter.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSaveFile>
+
+namespace {
+
+// label values, by TinyGPS::GPS_SENTENCE_* and TinyGPS::GPS_TALKER_*
+const char *const s_sentence_names[GPS_STATS_SENTENCE_TYPES] = {
+    "GGA", "RMC", "GSA", "GSV", "VTG", "GLL", "ZDA", "UBX-NAV-PVT", "UBX-NAV-SAT", "other"
+};
+const char *const s_talker_names[GPS_STATS_TALKERS] = {
+    "GP", "GL", "GA", "GB", "GQ", "GN", "other"
+};
+
+struct Metric {
+    const char *name;
+    const char *type;
+    const char *help;
+    quint64 GpsStats::*field;
+};
+
+const Metric s_metrics[] = {
+    { "gps_chars_total", "counter", "Characters fed to the parser.", &GpsStats::chars },
+    { "gps_checksum_passed_total", "counter", "Sentences with a matching checksum, or accepted without one.", &GpsStats::passed_checksum },
+    { "gps_good_sentences_total", "counter", "Valid sentences of a known type.", &GpsStats::good_sentences },
+    { "gps_checksum_failed_total", "counter", "Sentences with a wrong checksum.", &GpsStats::failed_checksum },
+    { "gps_term_overflows_total", "counter", "Sentences dropped for a term longer than the term buffer.", &GpsStats::term_overflows },
+    { "gps_framing_errors_total", "counter", "Sentences cut short by a new '$'.", &GpsStats::framing_errors },
+    { "gps_missing_checksum_total", "counter", "Sentences ended without a checksum.", &GpsStats::missing_checksum },
+    { "gps_malformed_checksum_total", "counter", "Sentences with a checksum that is not two hex digits.", &GpsStats::malformed_checksum },
+    { "gps_oversized_sentences_total", "counter", "Sentences longer than the maximum length.", &GpsStats::oversized_sentences },
+    { "gps_illegal_characters_total", "counter", "Sentences dropped for a control or non-ASCII byte.", &GpsStats::illegal_characters },
+    { "gps_dropped_bytes_total", "counter", "Characters skipped outside valid framing.", &GpsStats::dropped_bytes },
+};
+
+QByteArray label(const QString &value)
+{
+    QByteArray escaped = value.toUtf8();
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return escaped;
+}
+
+void header(QByteArray *out, const char *name, const char *type, const char *help)
+{
+    *out += "# HELP "; *out += name; *out += ' '; *out += help; *out += '\n';
+    *out += "# TYPE "; *out += name; *out += ' '; *out += type; *out += '\n';
+}
+
+} // namespace
+
+GpsStatsExporter::GpsStatsExporter(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_timer, &QTimer::timeout, this, &GpsStatsExporter::handleTimeout);
+}
+
+GpsStatsExporter::~GpsStatsExporter()
+{
+}
+
+void GpsStatsExporter::addReceiver(const QString &name, Source source)
+{
+    m_receivers.append({name, std::move(source)});
+}
+
+bool GpsStatsExporter::writeFile(const QString &fileName, int interval, QString *error)
+{
+    m_fileName = fileName;
+    if (!save(error))
+        return false;
+    m_timer.start(qMax(100, interval));
+    return true;
+}
+
+bool GpsStatsExporter::listen(const QString &socketName, QString *error)
+{
+    if (!m_server) {
+        m_server = new QLocalServer(this);
+        connect(m_server, &QLocalServer::newConnection, this, &GpsStatsExporter::handleNewConnection);
+    }
+    QLocalServer::removeServer(socketName);
+    if (!m_server->listen(socketName)) {
+        if (error)
+            *error = tr("%1: %2").arg(socketName, m_server->errorString());
+        return false;
+    }
+    return true;
+}
+
+QByteArray GpsStatsExporter::metrics() const
+{
+    QVector<QString> names;
+    QVector<GpsStats> stats;
+    for (const Receiver &receiver : m_receivers) {
+        names.append(receiver.name);
+        stats.append(receiver.source());
+    }
+    return format(names, stats);
+}
+
+QByteArray GpsStatsExporter::format(const QVector<QString> &names, const QVector<GpsStats> &stats)
+{
+    QByteArray out;
+    QVector<QByteArray> labels;
+    for (const QString &name : names)
+        labels.append("receiver=\"" + label(name) + '"');
+
+    for (const Metric &metric : s_metrics) {
+        header(&out, metric.name, metric.type, metric.help);
+        for (int i = 0; i < stats.size(); ++i)
+            out += metric.name + ('{' + labels[i]) + "} " + QByteArray::number(stats[i].*metric.field) + '\n';
+    }
+
+    header(&out, "gps_sentences_total", "counter", "Sentences with a matching checksum, by type.");
+    for (int i = 0; i < stats.size(); ++i) {
+        for (int type = 0; type < GPS_STATS_SENTENCE_TYPES; ++type)
+            out += "gps_sentences_total{" + labels[i] + ",type=\"" + s_sentence_names[type] + "\"} "
+                   + QByteArray::number(stats[i].sentences[type]) + '\n';
+    }
+
+    header(&out, "gps_talker_sentences_total", "counter", "Sentences with a matching checksum, by talker.");
+    for (int i = 0; i < stats.size(); ++i) {
+        for (int talker = 0; talker < GPS_STATS_TALKERS; ++talker)
+            out += "gps_talker_sentences_total{" + labels[i] + ",talker=\"" + s_talker_names[talker] + "\"} "
+                   + QByteArray::number(stats[i].talkers[talker]) + '\n';
+    }
+
+    header(&out, "gps_sentences_per_second", "gauge", "Valid sentences per second over the last full second.");
+    for (int i = 0; i < stats.size(); ++i)
+        out += "gps_sentences_per_second{" + labels[i] + "} "
+               + QByteArray::number(stats[i].sentences_per_second, 'f', 3) + '\n';
+
+    return out;
+}
+
+// replaces the file in one rename, so a scraper never sees half of it
+bool GpsStatsExporter::save(QString *error)
+{
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(metrics()) < 0 || !file.commit()) {
+        if (error)
+            *error = tr("%1: %2").arg(m_fileName, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+void GpsStatsExporter::handleTimeout()
+{
+    QString error;
+    if (!save(&error))
+        emit errorOccurred(error);
+}
+
+void GpsStatsExporter::handleNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        socket->write(metrics());
+        socket->disconnectFromServer();
+    }
+}
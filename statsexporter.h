@@ -0,0 +1,61 @@
+#ifndef STATSEXPORTER_H
+#define STATSEXPORTER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+
+#include "gpsstats.h"
+
+class QLocalServer;
+
+// Publishes the parser counters of one or more receivers in the Prometheus
+// text exposition format, either rewritten atomically into a file (for the
+// node_exporter textfile collector) or served to every client that connects
+// to a local socket.
+class GpsStatsExporter : public QObject
+{
+    Q_OBJECT
+public:
+    // called on the exporter's thread; must be safe against the parser thread
+    using Source = std::function<GpsStats()>;
+
+    explicit GpsStatsExporter(QObject *parent = nullptr);
+    ~GpsStatsExporter();
+
+    void addReceiver(const QString &name, Source source);
+
+    // rewrite fileName every interval milliseconds
+    bool writeFile(const QString &fileName, int interval = 10000, QString *error = nullptr);
+    // answer each connection to socketName with the current metrics
+    bool listen(const QString &socketName, QString *error = nullptr);
+
+    QByteArray metrics() const;
+    static QByteArray format(const QVector<QString> &names, const QVector<GpsStats> &stats);
+
+signals:
+    void errorOccurred(const QString &message);
+
+private slots:
+    void handleTimeout();
+    void handleNewConnection();
+
+private:
+    struct Receiver {
+        QString name;
+        Source source;
+    };
+
+    bool save(QString *error);
+
+    QVector<Receiver> m_receivers;
+    QString m_fileName;
+    QTimer m_timer;
+    QLocalServer *m_server = nullptr;
+};
+
+#endif // STATSEXPORTER_H
@@ -0,0 +1,20 @@
+# libFuzzer target for TinyGPS::encode; needs clang. The core is built without
+# QtCore so the sanitizers see all of it.
+TEMPLATE = app
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+QMAKE_CC = clang
+QMAKE_CXX = clang++
+QMAKE_LINK = clang++
+QMAKE_CXXFLAGS += -fsanitize=fuzzer,address,undefined -fno-omit-frame-pointer
+QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+
+TARGET = fuzz_encode
+
+DEFINES += GPS_NO_QT
+
+include(../../gps.pri)
+
+SOURCES += \
+    fuzz_encode.cpp
@@ -0,0 +1,106 @@
+// libFuzzer target for the NMEA framing: any input must be parsed in bounded
+// time, and feeding it whole, one character at a time or split in two must
+// publish the same fixes and acknowledgements and count the same rejections.
+//
+//   qmake fuzz.pro && make && ./fuzz_encode -max_len=4096 ../data/
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "tinygps.h"
+
+namespace {
+
+struct Run {
+    std::vector<GpsFix> fixes;
+    std::vector<GpsAck> acks;
+    GpsStats stats;
+};
+
+void collect(const GpsFix &fix, void *context)
+{
+    static_cast<std::vector<GpsFix> *>(context)->push_back(fix);
+}
+
+void collectAck(const GpsAck &ack, void *context)
+{
+    static_cast<std::vector<GpsAck> *>(context)->push_back(ack);
+}
+
+// all but published_ns
+bool same(const GpsFix &a, const GpsFix &b)
+{
+    return a.latitude == b.latitude && a.longitude == b.longitude && a.time == b.time && a.date == b.date
+            && a.speed == b.speed && a.course == b.course && a.altitude == b.altitude && a.hdop == b.hdop
+            && a.satellites == b.satellites && a.talker == b.talker && a.sentence_type == b.sentence_type
+            && a.valid == b.valid && a.epoch_ms == b.epoch_ms;
+}
+
+// the first byte picks the options, the rest is the stream
+void configure(TinyGPS *gps, quint8 options)
+{
+    gps->set_accept_missing_checksum(options & 1);
+    gps->set_max_sentence_length(options & 2 ? 0 : GPS_MAX_SENTENCE_LENGTH);
+}
+
+// split 0 feeds one character at a time
+Run feed(quint8 options, const char *data, size_t size, size_t split)
+{
+    Run run;
+    TinyGPS gps;
+    configure(&gps, options);
+    gps.set_fix_callback(&collect, &run.fixes);
+    gps.set_ack_callback(&collectAck, &run.acks);
+    if (split == 0) {
+        for (size_t i = 0; i < size; ++i)
+            gps.encode(data[i]);
+    } else {
+        gps.encode(data, split);
+        gps.encode(data + split, size - split);
+    }
+    run.stats = {};
+#ifndef GPS_NO_STATS
+    gps.stats(&run.stats);
+#endif
+    return run;
+}
+
+void check(bool condition)
+{
+    if (!condition)
+        abort();
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const quint8 *data, size_t size)
+{
+    if (size == 0)
+        return 0;
+    const quint8 options = data[0];
+    const char *stream = reinterpret_cast<const char *>(data + 1);
+    size -= 1;
+
+    const Run whole = feed(options, stream, size, size);
+    const Run bytes = feed(options, stream, size, 0);
+    const Run halves = feed(options, stream, size, size / 2);
+
+    for (const Run *run : {&bytes, &halves}) {
+        check(run->fixes.size() == whole.fixes.size());
+        for (size_t i = 0; i < whole.fixes.size(); ++i)
+            check(same(run->fixes[i], whole.fixes[i]));
+        check(run->acks.size() == whole.acks.size());
+        for (size_t i = 0; i < whole.acks.size(); ++i)
+            check(memcmp(&run->acks[i], &whole.acks[i], sizeof(GpsAck)) == 0);
+        check(memcmp(&run->stats, &whole.stats, offsetof(GpsStats, sentences_per_second)) == 0);
+    }
+#ifndef GPS_NO_STATS
+    check(whole.stats.chars == size);
+    check(whole.stats.good_sentences <= whole.stats.passed_checksum + whole.stats.missing_checksum);
+    check(whole.stats.dropped_bytes <= size);
+    check(whole.acks.size() <= whole.stats.passed_checksum);
+#endif
+    return 0;
+}
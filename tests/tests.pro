@@ -0,0 +1,47 @@
+QT -= gui
+QT += testlib concurrent serialport
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_tinygps
+
+include(../gps.pri)
+
+# golden NMEA corpora and the fixes they must produce
+DEFINES += GPS_TEST_DATA=\\\"$$PWD/data\\\"
+
+INCLUDEPATH += $$PWD/../sim
+
+SOURCES += \
+    tst_tinygps.cpp \
+    ../receivercommand.cpp \
+    ../receiverconfigurator.cpp \
+    ../serialport.cpp \
+    ../bufferpool.cpp \
+    ../serialiothread.cpp \
+    ../nmeacapture.cpp \
+    ../trackformat.cpp \
+    ../geofence.cpp \
+    ../nmeareplay.cpp \
+    ../sim/nmeasimulator.cpp
+
+HEADERS += \
+    ../receivercommand.h \
+    ../receiverconfigurator.h \
+    ../serialport.h \
+    ../bufferpool.h \
+    ../fixcoalescer.h \
+    ../bytering.h \
+    ../serialiothread.h \
+    ../nmeacapture.h \
+    ../trackformat.h \
+    ../geofence.h \
+    ../nmeareplay.h \
+    ../sim/nmeasimulator.h
+
+# GpsHub reads pseudo-terminals in place of serial ports
+linux {
+    SOURCES += ../gpshub.cpp
+    HEADERS += ../gpshub.h
+}
@@ -0,0 +1,1772 @@
+#include <QFile>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+#include "geodesy.h"
+#include "geofence.h"
+#ifdef Q_OS_LINUX
+#include "gpshub.h"
+#endif
+#include "nmeareplay.h"
+#include "nmeasimulator.h"
+#include "receivercommand.h"
+#include "receiverconfigurator.h"
+#include "serialport.h"
+#include "tinygps.h"
+#include "trackfilter.h"
+#include "trackformat.h"
+
+// Golden corpora live in data/: each NAME.nmea is fed to the parser and every
+// published fix must match the line in NAME.fixes, however the input is split.
+class TestTinyGPS : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void encodeGolden_data();
+    void encodeGolden();
+    void encodeChunking_data();
+    void encodeChunking();
+    void framing_data();
+    void framing();
+    void ubxNavSat();
+    void acknowledgements();
+    void receiverCommands_data();
+    void receiverCommands();
+    void receiverCommandsParse();
+    void simulator();
+    void receiverSpecs();
+    void hubPseudoTerminals();
+    void configurator_data();
+    void configurator();
+
+    void parseDegrees_data();
+    void parseDegrees();
+    void parseDecimals();
+    void crackDatetime_data();
+    void crackDatetime();
+    void crackDatetimeZda();
+    void epochMs_data();
+    void epochMs();
+    void epochMsMidnight();
+    void replayMidnight();
+
+    void cardinal_data();
+    void cardinal();
+    void distanceAndCourse_data();
+    void distanceAndCourse();
+    void geodesyBatchMatchesSingle();
+
+    void trackFilter_data();
+    void trackFilter();
+
+    void geofenceNearest_data();
+    void geofenceNearest();
+    void geofenceContains();
+    void geofenceLoad();
+
+    void trackFormat();
+    void trackFormatDamaged();
+    void trackFormatVersion1();
+
+private:
+    struct Run {
+        QStringList fixes;
+        GpsStats stats;
+    };
+
+    static QByteArray corpus(const QString &name);
+    static QStringList golden(const QString &name);
+    // chunk 0 feeds one character at a time, -1 random chunk sizes, else blocks of chunk
+    static Run feed(const QByteArray &data, int chunk);
+    static QByteArray sentence(const QByteArray &body);
+    static QByteArray ubxFrame(quint8 messageClass, quint8 id, const QByteArray &payload);
+    static void collect(const GpsFix &fix, void *context);
+    static void collectAck(const GpsAck &ack, void *context);
+    static void collectFix(const GpsFix &fix, void *context);
+    // three blocks' worth of fixes, every column moving
+    static std::vector<GpsFix> trackFixes();
+    static qint64 trackColumn(const GpsFix &fix, int column);
+    static void appendLittleEndian(QByteArray *out, quint64 value, int size);
+    static void patchLittleEndian(QByteArray *data, int at, quint64 value, int size);
+};
+
+QByteArray TestTinyGPS::corpus(const QString &name)
+{
+    QFile file(QStringLiteral(GPS_TEST_DATA "/%1.nmea").arg(name));
+    if (!file.open(QIODevice::ReadOnly))
+        qFatal("missing corpus %s", qPrintable(file.fileName()));
+    return file.readAll();
+}
+
+QStringList TestTinyGPS::golden(const QString &name)
+{
+    QFile file(QStringLiteral(GPS_TEST_DATA "/%1.fixes").arg(name));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        qFatal("missing golden file %s", qPrintable(file.fileName()));
+    QStringList lines;
+    while (!file.atEnd()) {
+        const QString line = QString::fromLatin1(file.readLine()).trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            lines.append(line);
+    }
+    return lines;
+}
+
+void TestTinyGPS::collect(const GpsFix &fix, void *context)
+{
+    static_cast<QStringList *>(context)->append(
+                QString::asprintf("%u,%u,%u,%u,%d,%d,%d,%u,%u,%u,%u,%02x",
+                                  fix.sentence_type, fix.talker, fix.date, fix.time,
+                                  fix.latitude, fix.longitude, fix.altitude, fix.speed,
+                                  fix.course, fix.hdop, fix.satellites, fix.valid));
+}
+
+void TestTinyGPS::collectAck(const GpsAck &ack, void *context)
+{
+    static_cast<std::vector<GpsAck> *>(context)->push_back(ack);
+}
+
+void TestTinyGPS::collectFix(const GpsFix &fix, void *context)
+{
+    static_cast<std::vector<GpsFix> *>(context)->push_back(fix);
+}
+
+TestTinyGPS::Run TestTinyGPS::feed(const QByteArray &data, int chunk)
+{
+    Run run;
+    TinyGPS gps;
+    gps.set_fix_callback(&TestTinyGPS::collect, &run.fixes);
+
+    std::mt19937 random(2013);
+    int offset = 0;
+    while (offset < data.size()) {
+        int size = chunk > 0 ? chunk : chunk < 0 ? int(random() % 97) + 1 : 1;
+        size = qMin(size, data.size() - offset);
+        if (chunk == 0)
+            gps.encode(data[offset]);
+        else
+            gps.encode(data.constData() + offset, size_t(size));
+        offset += size;
+    }
+
+    run.stats = {};
+#ifndef GPS_NO_STATS
+    gps.stats(&run.stats);
+#endif
+    return run;
+}
+
+QByteArray TestTinyGPS::sentence(const QByteArray &body)
+{
+    quint8 checksum = 0;
+    for (char c : body)
+        checksum ^= quint8(c);
+    return '$' + body + '*' + QByteArray::number(checksum, 16).toUpper().rightJustified(2, '0') + "\r\n";
+}
+
+QByteArray TestTinyGPS::ubxFrame(quint8 messageClass, quint8 id, const QByteArray &payload)
+{
+    QByteArray frame("\xB5\x62");
+    frame += char(messageClass);
+    frame += char(id);
+    frame += char(payload.size() & 0xFF);
+    frame += char(payload.size() >> 8);
+    frame += payload;
+    quint8 a = 0, b = 0;
+    for (int i = 2; i < frame.size(); ++i) {
+        a += quint8(frame[i]);
+        b += a;
+    }
+    return frame + char(a) + char(b);
+}
+
+void TestTinyGPS::encodeGolden_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<quint64>("passed");
+    QTest::addColumn<quint64>("good");
+    QTest::addColumn<quint64>("failed");
+
+    // every formatter, both hemispheres, negative altitude, void and no-fix sentences
+    QTest::newRow("basic") << "basic" << quint64(12) << quint64(10) << quint64(0);
+    // GN/GL/GA/BD talkers, sentences the parser does not know
+    QTest::newRow("multignss") << "multignss" << quint64(10) << quint64(9) << quint64(0);
+    // bad checksum, lowercase checksum, truncated, missing checksum,
+    // overlong term, binary garbage, malformed checksum, cut off at the end
+    QTest::newRow("corrupted") << "corrupted" << quint64(3) << quint64(3) << quint64(1);
+    // UBX NAV-PVT and NAV-SAT between sentences, '$', CR, LF and 0xB5 in
+    // payloads, nano borrowing into the previous day, bad checksum, no fix,
+    // unknown message, false sync, sentence cut short by a frame
+    QTest::newRow("ubx") << "ubx" << quint64(10) << quint64(8) << quint64(1);
+}
+
+void TestTinyGPS::encodeGolden()
+{
+    QFETCH(QString, name);
+    QFETCH(quint64, passed);
+    QFETCH(quint64, good);
+    QFETCH(quint64, failed);
+
+    const QByteArray data = corpus(name);
+    const Run run = feed(data, 4096);
+
+    QCOMPARE(run.fixes, golden(name));
+#ifndef GPS_NO_STATS
+    QCOMPARE(run.stats.chars, quint64(data.size()));
+    QCOMPARE(run.stats.passed_checksum, passed);
+    QCOMPARE(run.stats.good_sentences, good);
+    QCOMPARE(run.stats.failed_checksum, failed);
+#else
+    Q_UNUSED(passed);
+    Q_UNUSED(good);
+    Q_UNUSED(failed);
+#endif
+}
+
+void TestTinyGPS::encodeChunking_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<int>("chunk");
+
+    for (const char *name : {"basic", "multignss", "corrupted", "ubx"}) {
+        QTest::newRow(QByteArray(name) + "/bytes") << name << 0;
+        QTest::newRow(QByteArray(name) + "/1") << name << 1;
+        QTest::newRow(QByteArray(name) + "/7") << name << 7;
+        QTest::newRow(QByteArray(name) + "/random") << name << -1;
+    }
+}
+
+// the block path must give the same fixes and counters as the character path
+void TestTinyGPS::encodeChunking()
+{
+    QFETCH(QString, name);
+    QFETCH(int, chunk);
+
+    const QByteArray data = corpus(name);
+    const Run whole = feed(data, data.size());
+    const Run split = feed(data, chunk);
+
+    QCOMPARE(split.fixes, whole.fixes);
+    QCOMPARE(split.stats.chars, whole.stats.chars);
+    QCOMPARE(split.stats.passed_checksum, whole.stats.passed_checksum);
+    QCOMPARE(split.stats.good_sentences, whole.stats.good_sentences);
+    QCOMPARE(split.stats.failed_checksum, whole.stats.failed_checksum);
+    QCOMPARE(split.stats.term_overflows, whole.stats.term_overflows);
+    QCOMPARE(split.stats.framing_errors, whole.stats.framing_errors);
+    QCOMPARE(split.stats.missing_checksum, whole.stats.missing_checksum);
+    QCOMPARE(split.stats.malformed_checksum, whole.stats.malformed_checksum);
+    QCOMPARE(split.stats.oversized_sentences, whole.stats.oversized_sentences);
+    QCOMPARE(split.stats.illegal_characters, whole.stats.illegal_characters);
+    QCOMPARE(split.stats.dropped_bytes, whole.stats.dropped_bytes);
+}
+
+void TestTinyGPS::framing_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<bool>("acceptMissing");
+    QTest::addColumn<int>("fixes");
+    QTest::addColumn<QString>("counter");   // the GpsStats counter the rejection lands in
+
+    const QByteArray gga = "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,";
+    const QByteArray good = sentence(gga);
+    QByteArray control = good;
+    control[20] = '\x07';
+    QByteArray high = good;
+    high[20] = '\xB0';
+    QByteArray unchecked = '$' + gga + "\r\n";
+
+    QTest::newRow("valid") << good << false << 1 << QString();
+    QTest::newRow("control character") << control + good << false << 1 << "illegal_characters";
+    QTest::newRow("non-ASCII") << high + good << false << 1 << "illegal_characters";
+    QTest::newRow("overlong term") << sentence("GPGGA,123519,4807.0380000000000,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,") + good
+                                   << false << 1 << "term_overflows";
+    QTest::newRow("oversized") << sentence(gga + "1,2,3,4,5,6,7,8,9,10,11,12") + good << false << 1 << "oversized_sentences";
+    QTest::newRow("one hex digit") << '$' + gga + "*4\r\n" + good << false << 1 << "malformed_checksum";
+    QTest::newRow("three hex digits") << '$' + gga + "*470\r\n" + good << false << 1 << "malformed_checksum";
+    QTest::newRow("not hex") << '$' + gga + "*4G\r\n" + good << false << 1 << "malformed_checksum";
+    QTest::newRow("second star") << '$' + gga + "*4*7\r\n" + good << false << 1 << "malformed_checksum";
+    QTest::newRow("cut short") << '$' + gga.left(20) + good << false << 1 << "framing_errors";
+    QTest::newRow("missing checksum") << unchecked + good << false << 1 << "missing_checksum";
+    QTest::newRow("missing checksum accepted") << unchecked + good << true << 2 << "missing_checksum";
+}
+
+// every rejection drops the sentence, counts its reason and resynchronizes on
+// the next '$', whichever encode() path sees it
+void TestTinyGPS::framing()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, acceptMissing);
+    QFETCH(int, fixes);
+    QFETCH(QString, counter);
+
+    for (int chunk : {0, data.size()}) {
+        QStringList published;
+        TinyGPS gps;
+        gps.set_accept_missing_checksum(acceptMissing);
+        gps.set_fix_callback(&TestTinyGPS::collect, &published);
+        if (chunk == 0) {
+            for (char c : data)
+                gps.encode(c);
+        } else {
+            gps.encode(data.constData(), size_t(data.size()));
+        }
+        QCOMPARE(published.size(), fixes);
+
+#ifndef GPS_NO_STATS
+        GpsStats stats;
+        gps.stats(&stats);
+        const std::pair<const char *, quint64> counters[] = {
+            { "term_overflows", stats.term_overflows },
+            { "framing_errors", stats.framing_errors },
+            { "missing_checksum", stats.missing_checksum },
+            { "malformed_checksum", stats.malformed_checksum },
+            { "oversized_sentences", stats.oversized_sentences },
+            { "illegal_characters", stats.illegal_characters },
+        };
+        for (const auto &c : counters)
+            QCOMPARE(c.second, quint64(counter == c.first ? 1 : 0));
+        QCOMPARE(stats.failed_checksum, quint64(0));
+        // accepted sentences count as passed, with or without a checksum
+        QCOMPARE(stats.passed_checksum, quint64(fixes));
+        QCOMPARE(stats.sentences[TinyGPS::GPS_SENTENCE_GGA], quint64(fixes));
+#endif
+    }
+}
+
+// NAV-SAT replaces the view of every talker and the PRNs used, in NMEA numbering
+void TestTinyGPS::ubxNavSat()
+{
+    struct Sv { quint8 gnss, sv, cno; qint8 elevation; qint16 azimuth; bool used; };
+    const Sv svs[] = {
+        { 0, 5, 42, 45, 120, true },    // GPS
+        { 0, 12, 0, -5, 300, false },   // GPS, not tracked, below the horizon
+        { 1, 124, 33, 20, 180, false }, // SBAS, PRN 37
+        { 6, 7, 35, 30, 45, true },     // GLONASS, PRN 71
+        { 4, 1, 20, 10, 10, false },    // IMES, not reported
+    };
+    QByteArray payload(8, '\0');
+    payload[4] = 1;                     // version
+    payload[5] = char(std::size(svs));
+    for (const Sv &sv : svs) {
+        const char block[12] = { char(sv.gnss), char(sv.sv), char(sv.cno), char(sv.elevation),
+                                 char(sv.azimuth & 0xFF), char(sv.azimuth >> 8), 0, 0,
+                                 char(sv.used ? 0x0F : 0x07), 0, 0, 0 };
+        payload.append(block, sizeof(block));
+    }
+
+    TinyGPS gps;
+    gps.encode(sentence("GPGSV,1,1,01,01,10,010,20"));
+    gps.encode(ubxFrame(0x01, 0x35, payload));
+    QCOMPARE(gps.sentence_type(), quint8(TinyGPS::GPS_SENTENCE_UBX_SAT));
+
+    quint8 count = 0;
+    const GpsSatellite *gpsView = gps.satellite_view(TinyGPS::GPS_TALKER_GP, &count);
+    QCOMPARE(count, quint8(3));
+    QCOMPARE(gpsView[0].prn, quint8(5));
+    QCOMPARE(gpsView[0].elevation, quint8(45));
+    QCOMPARE(gpsView[0].azimuth, quint16(120));
+    QCOMPARE(gpsView[0].snr, quint8(42));
+    QCOMPARE(gpsView[1].elevation, quint8(0));
+    QCOMPARE(gpsView[1].snr, quint8(TinyGPS::GPS_INVALID_SNR));
+    QCOMPARE(gpsView[2].prn, quint8(37));
+    const GpsSatellite *glonassView = gps.satellite_view(TinyGPS::GPS_TALKER_GL, &count);
+    QCOMPARE(count, quint8(1));
+    QCOMPARE(glonassView[0].prn, quint8(71));
+
+    const quint8 *used = gps.satellites_used(&count);
+    QCOMPARE(count, quint8(2));
+    QCOMPARE(used[0], quint8(5));
+    QCOMPARE(used[1], quint8(71));
+}
+
+// $PMTK001 and UBX ACK-* reach the ack callback only when their checksum
+// passes, and publish no fix
+void TestTinyGPS::acknowledgements()
+{
+    QByteArray stream = sentence("PMTK001,314,3") + sentence("PMTK001,220,2");
+    stream += ubxFrame(0x05, 0x01, QByteArray("\x06\x08", 2));
+    stream += ubxFrame(0x05, 0x00, QByteArray("\x06\x01", 2));
+    QByteArray corrupted = sentence("PMTK001,251,3");
+    corrupted[10] = '0';
+    stream += corrupted;
+    stream += sentence("PMTK0010,1,3");
+
+    for (int chunk : {0, 7, int(stream.size())}) {
+        std::vector<GpsAck> acks;
+        QStringList fixes;
+        TinyGPS gps;
+        gps.set_ack_callback(&TestTinyGPS::collectAck, &acks);
+        gps.set_fix_callback(&TestTinyGPS::collect, &fixes);
+        for (int offset = 0; offset < stream.size(); offset += qMax(chunk, 1)) {
+            const int size = qMin(qMax(chunk, 1), int(stream.size()) - offset);
+            gps.encode(stream.constData() + offset, size_t(size));
+        }
+
+        QCOMPARE(int(acks.size()), 4);
+        QCOMPARE(acks[0].protocol, quint8(GpsAck::PMTK));
+        QCOMPARE(acks[0].command, quint16(314));
+        QVERIFY(acks[0].accepted());
+        QCOMPARE(acks[1].command, quint16(220));
+        QCOMPARE(acks[1].result, quint8(GpsAck::PMTK_FAILED));
+        QVERIFY(!acks[1].accepted());
+        QCOMPARE(acks[2].protocol, quint8(GpsAck::UBX));
+        QCOMPARE(acks[2].command, quint16(GPS_UBX_MESSAGE(0x06, 0x08)));
+        QVERIFY(acks[2].accepted());
+        QCOMPARE(acks[3].command, quint16(GPS_UBX_MESSAGE(0x06, 0x01)));
+        QVERIFY(!acks[3].accepted());
+        QVERIFY(fixes.isEmpty());
+    }
+
+    // without '*hh' only if such sentences are accepted
+    for (bool acceptMissing : {false, true}) {
+        std::vector<GpsAck> acks;
+        TinyGPS gps;
+        gps.set_accept_missing_checksum(acceptMissing);
+        gps.set_ack_callback(&TestTinyGPS::collectAck, &acks);
+        gps.encode(QByteArray("$PMTK001,220,3\r\n"));
+        QCOMPARE(int(acks.size()), acceptMissing ? 1 : 0);
+        if (acceptMissing)
+            QCOMPARE(acks[0].command, quint16(220));
+    }
+}
+
+void TestTinyGPS::receiverCommands_data()
+{
+    QTest::addColumn<QByteArray>("bytes");
+    QTest::addColumn<QByteArray>("expected");
+
+    const quint32 rmcGga = 1u << TinyGPS::GPS_SENTENCE_RMC | 1u << TinyGPS::GPS_SENTENCE_GGA;
+    // as published in the MediaTek and u-blox protocol references
+    QTest::newRow("PMTK314") << ReceiverCommand::setSentences(ReceiverCommand::Mtk, rmcGga).value(0).bytes
+                             << QByteArray("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
+    QTest::newRow("PMTK220") << ReceiverCommand::setUpdateInterval(ReceiverCommand::Mtk, 1000).bytes
+                             << QByteArray("$PMTK220,1000*1F\r\n");
+    QTest::newRow("PMTK251") << ReceiverCommand::setBaudRate(ReceiverCommand::Mtk, 115200).bytes
+                             << QByteArray("$PMTK251,115200*1F\r\n");
+    QTest::newRow("CFG-RATE") << ReceiverCommand::setUpdateInterval(ReceiverCommand::Ubx, 200).bytes
+                              << QByteArray::fromHex("b56206080600c80001000100de6a");
+    QTest::newRow("PUBX,40") << ReceiverCommand::setSentences(ReceiverCommand::Pubx, rmcGga).value(0).bytes
+                             << ReceiverCommand::nmeaSentence("PUBX,40,GGA,1,1,1,1,1,0");
+    QTest::newRow("PUBX,41") << ReceiverCommand::setBaudRate(ReceiverCommand::Pubx, 38400).bytes
+                             << ReceiverCommand::nmeaSentence("PUBX,41,1,0007,0003,38400,0");
+}
+
+void TestTinyGPS::receiverCommands()
+{
+    QFETCH(QByteArray, bytes);
+    QFETCH(QByteArray, expected);
+    QCOMPARE(bytes, expected);
+}
+
+// every command is one frame the parser takes as valid, and each set of
+// sentences covers all the parser knows
+void TestTinyGPS::receiverCommandsParse()
+{
+    const quint32 all = (1u << TinyGPS::GPS_SENTENCE_OTHER) - 1;
+    for (ReceiverCommand::Dialect dialect : {ReceiverCommand::Mtk, ReceiverCommand::Pubx, ReceiverCommand::Ubx}) {
+        QVector<ReceiverCommand> commands = ReceiverCommand::setSentences(dialect, all);
+        QCOMPARE(commands.size(), dialect == ReceiverCommand::Mtk ? 1 : int(TinyGPS::GPS_SENTENCE_OTHER));
+        commands.append(ReceiverCommand::setUpdateInterval(dialect, 100));
+        commands.append(ReceiverCommand::setBaudRate(dialect, 57600));
+        QCOMPARE(commands.last().baudRate, 57600);
+        QVERIFY(!commands.last().acknowledged);
+
+        for (const ReceiverCommand &command : commands) {
+            TinyGPS gps;
+            gps.encode(command.bytes);
+            GpsStats stats = {};
+#ifndef GPS_NO_STATS
+            gps.stats(&stats);
+            QCOMPARE(stats.passed_checksum, quint64(1));
+            QCOMPARE(stats.dropped_bytes, quint64(0));
+#endif
+            if (command.acknowledged) {
+                const GpsAck ack = {command.ack.protocol, 1, command.ack.command};
+                QVERIFY(command.matches(ack));
+            }
+        }
+    }
+
+    quint32 sentences = 0;
+    QVERIFY(ReceiverCommand::parseSentences("gga, RMC,UBX-NAV-PVT", &sentences));
+    QCOMPARE(sentences, 1u << TinyGPS::GPS_SENTENCE_GGA | 1u << TinyGPS::GPS_SENTENCE_RMC
+                        | 1u << TinyGPS::GPS_SENTENCE_UBX_PVT);
+    QVERIFY(!ReceiverCommand::parseSentences("GGA,XYZ", &sentences));
+}
+
+// Every simulated sentence passes the parser and every corrupted one fails
+// it; the simulated receivers answer configuration commands
+void TestTinyGPS::simulator()
+{
+    NmeaSimulator::Config config;
+    config.receivers = 4;
+    config.intervalMs = 100;
+    config.startMs = 1700000000000;
+    config.sentences = (1u << TinyGPS::GPS_SENTENCE_OTHER) - 1;
+    const qint64 endMs = config.startMs + 60000;
+
+    for (double corruption : {0.0, 0.05}) {
+        config.faults.corruptSentences = corruption;
+        NmeaSimulator simulator(config);
+        std::vector<TinyGPS> parsers(size_t(config.receivers));
+        std::vector<GpsFix> fixes;
+        for (TinyGPS &gps : parsers)
+            gps.set_fix_callback(&TestTinyGPS::collectFix, &fixes);
+
+        for (qint64 nowMs = config.startMs; nowMs < endMs; nowMs += config.intervalMs) {
+            for (int receiver = 0; receiver < config.receivers; ++receiver) {
+                QByteArray out;
+                if (simulator.poll(receiver, nowMs, &out))
+                    parsers[size_t(receiver)].encode(out.constData(), size_t(out.size()));
+            }
+        }
+
+        const NmeaSimulator::Stats stats = simulator.stats();
+        QCOMPARE(stats.epochs, quint64(config.receivers * 600));
+        QCOMPARE(stats.corrupted > 0, corruption > 0);
+#ifndef GPS_NO_STATS
+        GpsStats total = {};
+        for (TinyGPS &gps : parsers) {
+            GpsStats run;
+            gps.stats(&run);
+            total.passed_checksum += run.passed_checksum;
+            total.failed_checksum += run.failed_checksum;
+            total.dropped_bytes += run.dropped_bytes;
+        }
+        QCOMPARE(quint64(total.passed_checksum), stats.sentences - stats.corrupted);
+        QCOMPARE(quint64(total.failed_checksum), stats.corrupted);
+        QCOMPARE(quint64(total.dropped_bytes), quint64(0));
+#endif
+
+        // the receivers start within 5 km of the default origin
+        QVERIFY(!fixes.empty());
+        for (const GpsFix &fix : fixes) {
+            QVERIFY(fix.has(GpsFix::VALID_POSITION));
+            QVERIFY(qAbs(fix.latitude - 48117300) < 100000);
+            QVERIFY(qAbs(fix.longitude - 11516700) < 150000);
+            if (fix.epoch_ms)
+                QVERIFY(fix.epoch_ms >= config.startMs && fix.epoch_ms < endMs);
+        }
+    }
+
+    NmeaSimulator simulator(config);
+    QByteArray reply;
+    simulator.receive(0, ReceiverCommand::setUpdateInterval(ReceiverCommand::Mtk, 200).bytes, &reply);
+    std::vector<GpsAck> acks;
+    TinyGPS gps;
+    gps.set_ack_callback(&TestTinyGPS::collectAck, &acks);
+    gps.encode(reply.constData(), size_t(reply.size()));
+    QCOMPARE(int(acks.size()), 1);
+    QCOMPARE(acks[0].command, quint16(220));
+    QVERIFY(acks[0].accepted());
+
+    QByteArray out;
+    simulator.poll(0, config.startMs + 1000, &out);
+    const qint64 nextMs = simulator.nextEpochMs(0);
+    simulator.poll(0, nextMs, &out);
+    QCOMPARE(simulator.nextEpochMs(0) - nextMs, qint64(200));
+}
+
+void TestTinyGPS::receiverSpecs()
+{
+#ifdef Q_OS_LINUX
+    ReceiverConfig config;
+    QVERIFY(ReceiverConfig::fromSpec("/dev/ttyUSB0", &config));
+    QCOMPARE(config.name, QString("/dev/ttyUSB0"));
+    QCOMPARE(config.baudRate, 9600);
+    QVERIFY(ReceiverConfig::fromSpec("/dev/ttyUSB1:115200:7E2", &config));
+    QCOMPARE(config.baudRate, 115200);
+    QCOMPARE(int(config.dataBits), 7);
+    QCOMPARE(config.parity, 'E');
+    QCOMPARE(int(config.stopBits), 2);
+    QVERIFY(ReceiverConfig::fromSpec("  /dev/ttyS0   4800 ", &config));
+    QCOMPARE(config.baudRate, 4800);
+    QVERIFY(!ReceiverConfig::fromSpec("/dev/ttyS0:12345", &config));
+    QVERIFY(!ReceiverConfig::fromSpec("/dev/ttyS0:9600:9N1", &config));
+    QVERIFY(!ReceiverConfig::fromSpec("", &config));
+
+    QTemporaryDir dir;
+    QFile file(dir.filePath("receivers.txt"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("# two receivers\n/dev/ttyUSB0:115200\n\n/dev/ttyUSB1 # spare\n");
+    file.close();
+    QString error;
+    const QVector<ReceiverConfig> receivers = ReceiverConfig::fromFile(file.fileName(), &error);
+    QVERIFY(error.isEmpty());
+    QCOMPARE(receivers.size(), 2);
+    QCOMPARE(receivers[1].name, QString("/dev/ttyUSB1"));
+
+    QVERIFY(file.open(QIODevice::Append | QIODevice::Text));
+    file.write("/dev/ttyUSB2:115200:8X1\n");
+    file.close();
+    QVERIFY(ReceiverConfig::fromFile(file.fileName(), &error).isEmpty());
+    QVERIFY(error.contains(":5:"));
+#else
+    QSKIP("GpsHub is Linux only");
+#endif
+}
+
+// Simulated receivers on pseudo-terminals, read by fewer workers than ports
+void TestTinyGPS::hubPseudoTerminals()
+{
+#ifdef Q_OS_LINUX
+    NmeaSimulator::Config config;
+    config.receivers = 5;
+    config.intervalMs = 100;
+    config.startMs = 1700000000000;
+    NmeaSimulator simulator(config);
+
+    std::vector<int> masters;
+    QVector<ReceiverConfig> receivers;
+    for (int i = 0; i < config.receivers; ++i) {
+        const int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        QVERIFY(master >= 0);
+        QVERIFY(grantpt(master) == 0 && unlockpt(master) == 0);
+        masters.push_back(master);
+        ReceiverConfig receiver;
+        QVERIFY(ReceiverConfig::fromSpec(QString::fromLocal8Bit(ptsname(master)) + ":115200", &receiver));
+        receivers.append(receiver);
+    }
+
+    GpsHub hub(receivers, 2);
+    QVERIFY(hub.start());
+    for (int i = 0; i < config.receivers; ++i)
+        QVERIFY(hub.stats(i).open);
+
+    // ten epochs, well within the terminal's input buffer
+    std::vector<quint64> written(masters.size());
+    for (qint64 nowMs = config.startMs; nowMs < config.startMs + 1000; nowMs += config.intervalMs) {
+        for (int i = 0; i < config.receivers; ++i) {
+            QByteArray out;
+            if (simulator.poll(i, nowMs, &out)) {
+                QCOMPARE(::write(masters[size_t(i)], out.constData(), size_t(out.size())), ssize_t(out.size()));
+                written[size_t(i)] += quint64(out.size());
+            }
+        }
+    }
+
+    quint64 sentences = 0;
+    for (int i = 0; i < config.receivers; ++i) {
+        QTRY_COMPARE(hub.stats(i).bytes, written[size_t(i)]);
+        sentences += hub.stats(i).sentences;
+#ifndef GPS_NO_STATS
+        const GpsStats stats = hub.parserStats(i);
+        QCOMPARE(stats.failed_checksum, quint64(0));
+        QCOMPARE(stats.dropped_bytes, quint64(0));
+#endif
+        const GpsFix fix = hub.fix(i);
+        QVERIFY(fix.has(GpsFix::VALID_POSITION | GpsFix::VALID_DATE));
+        QVERIFY(fix.epoch_ms >= config.startMs && fix.epoch_ms < config.startMs + 1000);
+        TrackFilter::Estimate estimate;
+        QVERIFY(hub.estimate(i, fix.published_ns, &estimate));
+    }
+    QCOMPARE(sentences, simulator.stats().sentences);
+
+    hub.stop();
+    QVERIFY(!hub.stats(0).open);
+    for (int master : masters)
+        ::close(master);
+#else
+    QSKIP("GpsHub is Linux only");
+#endif
+}
+
+void TestTinyGPS::configurator_data()
+{
+    QTest::addColumn<int>("dialect");
+    QTest::addColumn<quint32>("sentences");
+    QTest::addColumn<int>("intervalMs");
+    QTest::addColumn<int>("baudRate");
+    QTest::addColumn<int>("lost");          // writes the line loses first, one command each
+    QTest::addColumn<int>("replyDelayMs");
+    QTest::addColumn<bool>("silentAfterBaudRate"); // the receiver is not heard at the new speed
+    QTest::addColumn<QString>("error");     // part of the error, empty for success
+    QTest::addColumn<int>("commands");      // understood by the receiver
+
+    const int mtk = ReceiverCommand::Mtk, pubx = ReceiverCommand::Pubx;
+    const quint32 ggaRmc = 1u << TinyGPS::GPS_SENTENCE_GGA | 1u << TinyGPS::GPS_SENTENCE_RMC;
+    const int pubxCommands = ReceiverCommand::setSentences(ReceiverCommand::Pubx, ggaRmc).size();
+
+    QTest::newRow("acknowledged") << mtk << ggaRmc << 200 << 0 << 0 << 150 << false << QString() << 2;
+    QTest::newRow("resent") << mtk << ggaRmc << 0 << 0 << 2 << 0 << false << QString() << 1;
+    QTest::newRow("unanswered") << mtk << ggaRmc << 0 << 0 << 3 << 0 << false << QString("did not acknowledge") << 0;
+    QTest::newRow("rejected") << mtk << 0u << 50 << 0 << 0 << 0 << false << QString("rejected") << 0;
+    QTest::newRow("settled") << pubx << ggaRmc << 0 << 0 << 0 << 0 << false << QString() << pubxCommands;
+    QTest::newRow("baud rate") << mtk << 0u << 0 << 38400 << 0 << 0 << false << QString() << 1;
+    QTest::newRow("baud rate fallback") << mtk << 0u << 0 << 38400 << 0 << 0 << true << QString("no valid sentences") << 1;
+}
+
+// ReceiverConfigurator against a simulated receiver on a pseudo-terminal;
+// the test plays the line, losing, delaying or silencing what the receiver
+// sends
+void TestTinyGPS::configurator()
+{
+#ifdef Q_OS_LINUX
+    QFETCH(int, dialect);
+    QFETCH(quint32, sentences);
+    QFETCH(int, intervalMs);
+    QFETCH(int, baudRate);
+    QFETCH(int, lost);
+    QFETCH(int, replyDelayMs);
+    QFETCH(bool, silentAfterBaudRate);
+    QFETCH(QString, error);
+    QFETCH(int, commands);
+
+    const int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    QVERIFY(master >= 0);
+    QVERIFY(grantpt(master) == 0 && unlockpt(master) == 0);
+    QVERIFY(fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK) == 0);
+
+    NmeaSimulator::Config config;
+    config.intervalMs = 100;
+    config.startMs = 1700000000000;
+    NmeaSimulator simulator(config);
+
+    {
+        SerialPort port(QString::fromLocal8Bit(ptsname(master)), 9600);
+        ReceiverConfigurator::Settings settings;
+        settings.dialect = ReceiverCommand::Dialect(dialect);
+        settings.sentences = sentences;
+        settings.updateIntervalMs = intervalMs;
+        settings.baudRate = baudRate;
+        settings.ackTimeoutMs = 300;
+        settings.settleMs = 50;
+        settings.trafficTimeoutMs = 1000;
+        ReceiverConfigurator configurator(&port, settings);
+        QSignalSpy finished(&configurator, &ReceiverConfigurator::finished);
+
+        // the receiver's end: commands in, answers and epochs out
+        QElapsedTimer clock;
+        clock.start();
+        QByteArray reply;
+        qint64 replyAtMs = 0;
+        bool silent = false;
+        QTimer line;
+        connect(&line, &QTimer::timeout, [&]() {
+            // the configurator writes the next command only once the last
+            // one is done with
+            QByteArray input;
+            char buffer[256];
+            ssize_t n;
+            while ((n = ::read(master, buffer, sizeof(buffer))) > 0)
+                input.append(buffer, int(n));
+            if (!input.isEmpty()) {
+                if (lost > 0) {
+                    --lost;
+                } else {
+                    if (silentAfterBaudRate && input.contains("$PMTK251"))
+                        silent = true;
+                    simulator.receive(0, input, &reply);
+                    replyAtMs = clock.elapsed() + replyDelayMs;
+                }
+            }
+
+            QByteArray out;
+            if (!reply.isEmpty() && clock.elapsed() >= replyAtMs) {
+                out = reply;
+                reply.clear();
+            }
+            if (!silent)
+                simulator.poll(0, config.startMs + clock.elapsed(), &out);
+            if (!out.isEmpty())
+                QCOMPARE(::write(master, out.constData(), size_t(out.size())), ssize_t(out.size()));
+        });
+        line.start(10);
+
+        configurator.start();
+        QVERIFY(configurator.isRunning());
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        QVERIFY(!configurator.isRunning());
+
+        const QList<QVariant> result = finished.takeFirst();
+        QCOMPARE(result.at(0).toBool(), error.isEmpty());
+        QVERIFY2(result.at(1).toString().contains(error), qPrintable(result.at(1).toString()));
+        QCOMPARE(int(simulator.stats().commands), commands);
+        QCOMPARE(port.baudRate(), baudRate && error.isEmpty() ? baudRate : 9600);
+    }
+    ::close(master);
+#else
+    QSKIP("pseudo-terminals are Linux only here");
+#endif
+}
+
+void TestTinyGPS::parseDegrees_data()
+{
+    QTest::addColumn<QByteArray>("latitude");
+    QTest::addColumn<QByteArray>("longitude");
+    QTest::addColumn<qint64>("expectedLatitude");   // 10^-7 degrees
+    QTest::addColumn<qint64>("expectedLongitude");
+
+    QTest::newRow("north east") << QByteArray("4807.038,N") << QByteArray("01131.000,E") << qint64(481173000) << qint64(115166667);
+    QTest::newRow("south west") << QByteArray("3348.2371234,S") << QByteArray("07012.5,W") << qint64(-338039521) << qint64(-702083333);
+    QTest::newRow("full precision") << QByteArray("4807.0381234,N") << QByteArray("01131.0000001,E") << qint64(481173021) << qint64(115166667);
+    QTest::newRow("no decimals") << QByteArray("4807,N") << QByteArray("01131,E") << qint64(481166667) << qint64(115166667);
+    QTest::newRow("origin") << QByteArray("0000.0000,N") << QByteArray("00000.0000,E") << qint64(0) << qint64(0);
+    QTest::newRow("extremes") << QByteArray("9000.0000,S") << QByteArray("18000.0000,W") << qint64(-900000000) << qint64(-1800000000);
+    // the public GPS_INVALID_ANGLE, a valid position in 10^-7 degrees
+    QTest::newRow("999999999") << QByteArray("4807.038,N") << QByteArray("09959.999994,E") << qint64(481173000) << qint64(999999999);
+}
+
+void TestTinyGPS::parseDegrees()
+{
+    QFETCH(QByteArray, latitude);
+    QFETCH(QByteArray, longitude);
+    QFETCH(qint64, expectedLatitude);
+    QFETCH(qint64, expectedLongitude);
+
+    TinyGPS gps;
+    gps.encode(sentence("GPGLL," + latitude + ',' + longitude + ",123519,A,A"));
+
+    double lat, lon;
+    gps.d_get_position(&lat, &lon);
+    QCOMPARE(qint64(std::llround(lat * 1e7)), expectedLatitude);
+    QCOMPARE(qint64(std::llround(lon * 1e7)), expectedLongitude);
+
+    long microLat, microLon;
+    gps.get_position(&microLat, &microLon);
+    QVERIFY(qAbs(qint64(microLat) * 10 - expectedLatitude) <= 5);
+    QVERIFY(qAbs(qint64(microLon) * 10 - expectedLongitude) <= 5);
+}
+
+void TestTinyGPS::parseDecimals()
+{
+    TinyGPS gps;
+    gps.encode(sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,-12.345,M,46.9,M,,"));
+    QCOMPARE(gps.altitude(), -1234L);
+    QCOMPARE(gps.f_altitude(), -12.345f);
+    QCOMPARE(gps.hdop(), 90UL);
+
+    gps.encode(sentence("GPRMC,123520,A,4807.038,N,01131.000,E,022.456,084.4,230394,003.1,W"));
+    QCOMPARE(gps.speed(), 2245UL);
+    QCOMPARE(gps.f_speed_knots(), 22.456f);
+    QCOMPARE(gps.course(), 8440UL);
+
+    // too large for any field: reported invalid, not wrapped
+    gps.encode(sentence("GPGGA,123521,4807.038,N,01131.000,E,1,08,0.9,99999999999999999999,M,46.9,M,,"));
+    QCOMPARE(gps.altitude(), long(TinyGPS::GPS_INVALID_ALTITUDE));
+}
+
+void TestTinyGPS::crackDatetime_data()
+{
+    QTest::addColumn<QByteArray>("date");
+    QTest::addColumn<QByteArray>("time");
+    QTest::addColumn<int>("year");
+    QTest::addColumn<int>("month");
+    QTest::addColumn<int>("day");
+    QTest::addColumn<int>("hour");
+    QTest::addColumn<int>("minute");
+    QTest::addColumn<int>("second");
+    QTest::addColumn<int>("hundredths");
+
+    QTest::newRow("1994") << QByteArray("230394") << QByteArray("123519") << 1994 << 3 << 23 << 12 << 35 << 19 << 0;
+    QTest::newRow("hundredths") << QByteArray("311299") << QByteArray("235959.99") << 1999 << 12 << 31 << 23 << 59 << 59 << 99;
+    QTest::newRow("2000") << QByteArray("010100") << QByteArray("000000.00") << 2000 << 1 << 1 << 0 << 0 << 0 << 0;
+    QTest::newRow("2002") << QByteArray("040702") << QByteArray("201530.50") << 2002 << 7 << 4 << 20 << 15 << 30 << 50;
+}
+
+void TestTinyGPS::crackDatetime()
+{
+    QFETCH(QByteArray, date);
+    QFETCH(QByteArray, time);
+
+    TinyGPS gps;
+    gps.encode(sentence("GPRMC," + time + ",A,4807.038,N,01131.000,E,022.4,084.4," + date + ",003.1,W"));
+
+    int year;
+    quint8 month, day, hour, minute, second, hundredths;
+    gps.crack_datetime(&year, &month, &day, &hour, &minute, &second, &hundredths);
+    QTEST(year, "year");
+    QTEST(int(month), "month");
+    QTEST(int(day), "day");
+    QTEST(int(hour), "hour");
+    QTEST(int(minute), "minute");
+    QTEST(int(second), "second");
+    QTEST(int(hundredths), "hundredths");
+}
+
+// ZDA carries the century
+void TestTinyGPS::crackDatetimeZda()
+{
+    TinyGPS gps;
+    gps.encode(sentence("GPZDA,201530.00,04,07,2102,00,00"));
+
+    int year;
+    gps.crack_datetime(&year, nullptr, nullptr, nullptr, nullptr, nullptr);
+    QCOMPARE(year, 2102);
+    QCOMPARE(gps.zda_year(), 2102);
+}
+
+void TestTinyGPS::epochMs_data()
+{
+    QTest::addColumn<QByteArray>("sentences");
+    QTest::addColumn<qint64>("floor");
+    QTest::addColumn<qint64>("epoch");
+
+    QTest::newRow("1994") << sentence("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W")
+                          << qint64(0) << Q_INT64_C(764426119000);
+    QTest::newRow("hundredths") << sentence("GPRMC,235959.99,A,4807.038,N,01131.000,E,022.4,084.4,311299,003.1,W")
+                                << qint64(0) << Q_INT64_C(946684799990);
+    QTest::newRow("zda century") << sentence("GPZDA,201530.00,04,07,2102,00,00")
+                                 << qint64(0) << Q_INT64_C(4181487330000);
+    QTest::newRow("week rollover") << sentence("GPRMC,120000,A,4807.038,N,01131.000,E,022.4,084.4,220899,003.1,W")
+                                   << gpstime::LastRolloverMs << Q_INT64_C(1554638400000);
+    QTest::newRow("no date") << sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,")
+                             << qint64(0) << qint64(0);
+    QTest::newRow("bad date") << sentence("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,321394,003.1,W")
+                              << qint64(0) << qint64(0);
+    QTest::newRow("leap day") << sentence("GPRMC,120000,A,4807.038,N,01131.000,E,022.4,084.4,290224,003.1,W")
+                              << qint64(0) << Q_INT64_C(1709208000000);
+    QTest::newRow("29 february") << sentence("GPRMC,120000,A,4807.038,N,01131.000,E,022.4,084.4,290223,003.1,W")
+                                 << qint64(0) << qint64(0);
+    QTest::newRow("30 february") << sentence("GPRMC,120000,A,4807.038,N,01131.000,E,022.4,084.4,300294,003.1,W")
+                                 << qint64(0) << qint64(0);
+    QTest::newRow("31 april") << sentence("GPRMC,120000,A,4807.038,N,01131.000,E,022.4,084.4,310494,003.1,W")
+                              << qint64(0) << qint64(0);
+}
+
+void TestTinyGPS::epochMs()
+{
+    QFETCH(QByteArray, sentences);
+    QFETCH(qint64, floor);
+
+    TinyGPS gps;
+    gps.set_rollover_floor(floor);
+    gps.encode(sentences);
+    QTEST(gps.epoch_ms(), "epoch");
+
+    GpsFix fix;
+    gps.get_fix(&fix);
+    QTEST(fix.epoch_ms, "epoch");
+}
+
+// a GGA past midnight comes before the RMC with the new date
+void TestTinyGPS::epochMsMidnight()
+{
+    TinyGPS gps;
+    gps.encode(sentence("GPRMC,235959,A,4807.038,N,01131.000,E,022.4,084.4,290224,003.1,W"));
+    QCOMPARE(gps.epoch_ms(), Q_INT64_C(1709251199000));
+    gps.encode(sentence("GPGGA,000001,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,"));
+    QCOMPARE(gps.epoch_ms(), Q_INT64_C(1709251201000));
+
+    int year;
+    quint8 month, day;
+    gps.crack_datetime(&year, &month, &day, nullptr, nullptr, nullptr);
+    QCOMPARE(year, 2024);
+    QCOMPARE(int(month), 3);
+    QCOMPARE(int(day), 1);
+
+    gps.encode(sentence("GPRMC,000002,A,4807.038,N,01131.000,E,022.4,084.4,010324,003.1,W"));
+    QCOMPARE(gps.epoch_ms(), Q_INT64_C(1709251202000));
+}
+
+// A chunk that starts with GGAs past midnight continues from the previous
+// chunk's epoch, and the fixes come out as a single parser would give them
+void TestTinyGPS::replayMidnight()
+{
+    auto hhmmss = [](int centiseconds) {
+        const int seconds = centiseconds / 100;
+        return QByteArray(QString::asprintf("%02d%02d%02d.%02d", seconds / 3600, seconds / 60 % 60,
+                                            seconds % 60, centiseconds % 100).toLatin1());
+    };
+
+    // ~300 KB of RMC and GGA before midnight, then ~560 KB of GGA only
+    QByteArray log;
+    const int pairs = 2200;
+    for (int i = 0; i < pairs; ++i) {
+        const QByteArray time = hhmmss(8640000 - (pairs - i) * 20);
+        log += sentence("GPRMC," + time + ",A,4807.038,N,01131.000,E,022.4,084.4,290224,003.1,W");
+        log += sentence("GPGGA," + time + ",4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+    }
+    const int ggas = 8000;
+    for (int i = 0; i < ggas; ++i)
+        log += sentence("GPGGA," + hhmmss(i * 10) + ",4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+    log += sentence("GPRMC," + hhmmss(ggas * 10) + ",A,4807.038,N,01131.000,E,022.4,084.4,010324,003.1,W");
+
+    QTemporaryDir dir;
+    QFile file(dir.filePath("midnight.nmea"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(log);
+    file.close();
+
+    NmeaReplay replay(file.fileName());
+    QVERIFY(replay.open());
+    const std::vector<GpsFix> single = replay.parse(1);
+    QCOMPARE(int(single.size()), 2 * pairs + ggas + 1);
+    QCOMPARE(single[2 * pairs].epoch_ms, Q_INT64_C(1709251200000));
+    QCOMPARE(single[2 * pairs].date, 10324u);
+    for (size_t i = 1; i < single.size(); ++i)
+        QVERIFY(single[i].epoch_ms >= single[i - 1].epoch_ms);
+
+    for (int threads : {2, 3}) {
+        const std::vector<GpsFix> chunked = replay.parse(threads);
+        QCOMPARE(replay.stats().chunks, threads);
+        QCOMPARE(chunked.size(), single.size());
+        for (size_t i = 0; i < single.size(); ++i) {
+            QCOMPARE(chunked[i].epoch_ms, single[i].epoch_ms);
+            QCOMPARE(chunked[i].date, single[i].date);
+            QCOMPARE(chunked[i].time, single[i].time);
+        }
+    }
+}
+
+void TestTinyGPS::cardinal_data()
+{
+    QTest::addColumn<float>("course");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("0") << 0.0f << "N";
+    QTest::newRow("11.24") << 11.24f << "N";
+    QTest::newRow("11.25") << 11.25f << "NNE";
+    QTest::newRow("90") << 90.0f << "E";
+    QTest::newRow("180") << 180.0f << "S";
+    QTest::newRow("270") << 270.0f << "W";
+    QTest::newRow("337.5") << 337.5f << "NNW";
+    QTest::newRow("348.75") << 348.75f << "N";
+    QTest::newRow("359.9") << 359.9f << "N";
+}
+
+void TestTinyGPS::cardinal()
+{
+    QFETCH(float, course);
+    QTEST(QString(TinyGPS::cardinal(course)), "expected");
+}
+
+void TestTinyGPS::distanceAndCourse_data()
+{
+    QTest::addColumn<float>("lat1");
+    QTest::addColumn<float>("long1");
+    QTest::addColumn<float>("lat2");
+    QTest::addColumn<float>("long2");
+    QTest::addColumn<double>("distance");   // double precision, same sphere
+    QTest::addColumn<double>("course");
+
+    QTest::newRow("london paris") << 51.5074f << -0.1278f << 48.8566f << 2.3522f << 343652.9 << 148.12;
+    QTest::newRow("same point") << 48.1173f << 11.516667f << 48.1173f << 11.516667f << 0.0 << 0.0;
+    QTest::newRow("sydney melbourne") << -33.8688f << 151.2093f << -37.8136f << 144.9631f << 713628.5 << 230.28;
+    QTest::newRow("new york tokyo") << 40.7128f << -74.0060f << 35.6762f << 139.6503f << 10854790.3 << 332.99;
+    QTest::newRow("equator quarter") << 0.0f << 0.0f << 0.0f << 90.0f << 10010363.0 << 90.0;
+    QTest::newRow("antimeridian") << 0.0f << 179.5f << 0.0f << -179.5f << 111226.3 << 90.0;
+    QTest::newRow("over the pole") << 89.9f << 0.0f << 89.9f << 180.0f << 22245.3 << 0.0;
+}
+
+void TestTinyGPS::distanceAndCourse()
+{
+    QFETCH(float, lat1);
+    QFETCH(float, long1);
+    QFETCH(float, lat2);
+    QFETCH(float, long2);
+    QFETCH(double, distance);
+    QFETCH(double, course);
+
+    // geodesy.h: within 4.3 m of double precision; the float inputs add
+    // up to half a meter per coordinate
+    QVERIFY2(qAbs(TinyGPS::distance_between(lat1, long1, lat2, long2) - distance) < 6.0,
+             qPrintable(QString::number(TinyGPS::distance_between(lat1, long1, lat2, long2))));
+
+    if (distance > 100) {
+        double error = std::fmod(qAbs(TinyGPS::course_to(lat1, long1, lat2, long2) - course), 360.0);
+        QVERIFY2(qMin(error, 360.0 - error) < 0.5,
+                 qPrintable(QString::number(TinyGPS::course_to(lat1, long1, lat2, long2))));
+    }
+}
+
+// every build, SIMD or not, gives the same results for batches and single pairs
+void TestTinyGPS::geodesyBatchMatchesSingle()
+{
+    const size_t count = 1001;
+    std::vector<float> lat1(count), long1(count), lat2(count), long2(count), distance(count), course(count);
+    std::mt19937 random(6372795);
+    std::uniform_real_distribution<float> latitude(-90.0f, 90.0f), longitude(-180.0f, 180.0f);
+    for (size_t i = 0; i < count; ++i) {
+        lat1[i] = latitude(random);
+        long1[i] = longitude(random);
+        lat2[i] = latitude(random);
+        long2[i] = longitude(random);
+    }
+
+    geodesy::distance_between(lat1.data(), long1.data(), lat2.data(), long2.data(), distance.data(), count);
+    geodesy::course_to(lat1.data(), long1.data(), lat2.data(), long2.data(), course.data(), count);
+    for (size_t i = 0; i < count; ++i) {
+        QCOMPARE(distance[i], TinyGPS::distance_between(lat1[i], long1[i], lat2[i], long2[i]));
+        QCOMPARE(course[i], TinyGPS::course_to(lat1[i], long1[i], lat2[i], long2[i]));
+    }
+}
+
+void TestTinyGPS::trackFilter_data()
+{
+    QTest::addColumn<double>("latitude");
+    QTest::addColumn<double>("longitude");
+    QTest::addColumn<double>("speed");      // m/s, due east
+
+    QTest::newRow("road") << 48.1173 << 11.5167 << 10.0;
+    QTest::newRow("recentered") << 48.1173 << 11.5167 << 150.0;  // 9 km in the minute
+    QTest::newRow("antimeridian") << -0.5 << 179.97 << 150.0;     // crossed after 22 s
+}
+
+// A receiver reporting GGA and RMC once a second along a parallel, where the
+// filter's flat-earth frame is exact
+void TestTinyGPS::trackFilter()
+{
+    QFETCH(double, latitude);
+    QFETCH(double, longitude);
+    QFETCH(double, speed);
+
+    const double degToRad = 0.017453292519943295;
+    const double s = std::sin(latitude * degToRad);
+    const double metersPerDegree = 6378137.0 / std::sqrt(1.0 - 6.69437999014e-3 * s * s)
+            * std::cos(latitude * degToRad) * degToRad;
+    auto longitudeAt = [&](double seconds) {
+        const double l = longitude + speed * seconds / metersPerDegree;
+        return l > 180.0 ? l - 360.0 : l;
+    };
+    // meters from where the receiver is at seconds
+    auto offset = [&](const TrackFilter::Estimate &estimate, double seconds) {
+        double east = estimate.longitude - longitudeAt(seconds);
+        east = east > 180.0 ? east - 360.0 : east <= -180.0 ? east + 360.0 : east;
+        return std::hypot(east * metersPerDegree, (estimate.latitude - latitude) * 111000.0);
+    };
+    auto fixAt = [&](int seconds, quint8 type) {
+        GpsFix fix = {};
+        fix.sentence_type = type;
+        fix.latitude = qint32(std::lround(latitude * 1e6));
+        fix.longitude = qint32(std::lround(longitudeAt(seconds) * 1e6));
+        fix.time = quint32(120000 + seconds / 60 * 100 + seconds % 60) * 100;
+        fix.speed = quint32(std::lround(speed / GPS_MPS_PER_KNOT * 100.0));
+        fix.course = 9000;
+        fix.hdop = 100;
+        fix.valid = GpsFix::VALID_TIME;
+        if (type != TinyGPS::GPS_SENTENCE_VTG)
+            fix.valid |= GpsFix::VALID_POSITION | GpsFix::VALID_HDOP;
+        if (type != TinyGPS::GPS_SENTENCE_GGA)
+            fix.valid |= GpsFix::VALID_SPEED | GpsFix::VALID_COURSE;
+        return fix;
+    };
+    auto compareStates = [](const TrackFilter::State &a, const TrackFilter::State &b) {
+        QCOMPARE(a.origin_longitude, b.origin_longitude);
+        QCOMPARE(a.east[0], b.east[0]);
+        QCOMPARE(a.east[1], b.east[1]);
+        QCOMPARE(a.north[0], b.north[0]);
+        QCOMPARE(a.north[1], b.north[1]);
+        QCOMPARE(a.east_cov[0], b.east_cov[0]);
+        QCOMPARE(a.north_cov[2], b.north_cov[2]);
+        QCOMPARE(a.time_ns, b.time_ns);
+    };
+
+    const quint64 second = 1000000000;
+    const quint64 startNs = 1000 * second;
+    TrackFilter filter;
+    TrackFilter::State state = TrackFilter::initial_state();
+    TrackFilter::Estimate estimate;
+    QVERIFY(!filter.predict(state, startNs, &estimate));
+
+    for (int t = 0; t <= 60; ++t) {
+        const quint64 now = startNs + quint64(t) * second;
+        filter.update(&state, fixAt(t, TinyGPS::GPS_SENTENCE_GGA), now);
+
+        // the RMC of the epoch adds its velocity but not its position again,
+        // as a VTG would; a repeated RMC adds nothing
+        TrackFilter::State vtg = state;
+        filter.update(&vtg, fixAt(t, TinyGPS::GPS_SENTENCE_VTG), now);
+        filter.update(&state, fixAt(t, TinyGPS::GPS_SENTENCE_RMC), now);
+        compareStates(state, vtg);
+        filter.update(&vtg, fixAt(t, TinyGPS::GPS_SENTENCE_RMC), now + second / 10);
+        compareStates(state, vtg);
+
+        // the origin follows the track, across the antimeridian too
+        QVERIFY(std::fabs(state.east[0]) <= 5000.0 && std::fabs(state.north[0]) <= 5000.0);
+        QVERIFY(state.origin_longitude > -180.0 && state.origin_longitude <= 180.0);
+
+        if (t < 5)
+            continue;
+        QVERIFY(filter.predict(state, now, &estimate));
+        QVERIFY2(offset(estimate, t) < 0.5, qPrintable(QString::number(offset(estimate, t))));
+        QVERIFY(qAbs(estimate.speed - speed) < speed * 1e-3);
+        QVERIFY(qAbs(estimate.course - 90.0) < 0.01);
+        QVERIFY(estimate.longitude > -180.0 && estimate.longitude <= 180.0);
+
+        // dead-reckoned, and less certain, two seconds on
+        const double error = estimate.position_error;
+        QVERIFY(filter.predict(state, now + 2 * second, &estimate));
+        QVERIFY2(offset(estimate, t + 2) < 0.5, qPrintable(QString::number(offset(estimate, t + 2))));
+        QCOMPARE(estimate.age, 2.0);
+        QVERIFY(estimate.position_error > error);
+    }
+
+    // after more than the reset gap without a fix the track is gone, and the
+    // next fix starts it over where it is, standing still
+    const quint64 lastNs = startNs + 60 * second;
+    QVERIFY(filter.predict(state, lastNs + 10 * second, &estimate));
+    QVERIFY(!filter.predict(state, lastNs + 11 * second, &estimate));
+    QVERIFY(!estimate.valid);
+    filter.update(&state, fixAt(90, TinyGPS::GPS_SENTENCE_GGA), lastNs + 30 * second);
+    QVERIFY(filter.predict(state, lastNs + 30 * second, &estimate));
+    QVERIFY(offset(estimate, 90) < 0.1);
+    QCOMPARE(estimate.speed, 0.0);
+    QCOMPARE(estimate.age, 0.0);
+}
+
+void TestTinyGPS::geofenceNearest_data()
+{
+    QTest::addColumn<double>("latitude");
+
+    QTest::newRow("munich") << 48.1173;
+    QTest::newRow("tromso") << 69.6492;
+    QTest::newRow("svalbard") << 78.2232;
+    QTest::newRow("near the north pole") << 88.9;
+    QTest::newRow("near the south pole") << -89.3;
+}
+
+// nearest() against a scan of every POI, with the same equirectangular
+// distances; near the poles a cell is only a few hundred meters wide and the
+// ring search has to reach far along the parallel
+void TestTinyGPS::geofenceNearest()
+{
+    QFETCH(double, latitude);
+
+    const double degToRad = 0.017453292519943295;
+    auto distance = [&](qint32 lat1, qint32 lon1, qint32 lat2, qint32 lon2) {
+        const double meanLatitude = (double(lat1) + lat2) / 2.0 / 1000000.0 * degToRad;
+        const double dx = (double(lon2) - lon1) * std::cos(meanLatitude);
+        const double dy = double(lat2) - lat1;
+        return std::sqrt(dx * dx + dy * dy) * 6371008.8 * degToRad / 1000000.0;
+    };
+
+    // a square of about 110 km, and queries reaching a little beyond it
+    const double spread = qMin(10.0, 0.5 / std::cos(latitude * degToRad));
+    std::mt19937 random(20000);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    auto point = [&](double scale, qint32 *lat, qint32 *lon) {
+        *lat = qint32(std::lround(qBound(-90.0, latitude + 0.5 * scale * unit(random), 90.0) * 1e6));
+        *lon = qint32(std::lround((11.5 + spread * scale * unit(random)) * 1e6));
+    };
+
+    GeofenceIndex index;
+    for (int i = 0; i < 20000; ++i) {
+        qint32 lat, lon;
+        point(1.0, &lat, &lon);
+        index.addPoi(i, lat, lon, QString());
+    }
+    index.build();
+
+    const int k = 8;
+    std::vector<GeofenceIndex::Neighbor> neighbors;
+    std::vector<double> expected(index.pois().size());
+    for (int query = 0; query < 100; ++query) {
+        qint32 lat, lon;
+        point(1.5, &lat, &lon);
+        index.nearest(lat, lon, k, &neighbors);
+
+        for (size_t i = 0; i < expected.size(); ++i)
+            expected[i] = distance(lat, lon, index.pois()[i].latitude, index.pois()[i].longitude);
+        std::partial_sort(expected.begin(), expected.begin() + k, expected.end());
+
+        QCOMPARE(int(neighbors.size()), k);
+        for (int i = 0; i < k; ++i) {
+            const GeofenceIndex::Poi &poi = index.pois()[size_t(neighbors[size_t(i)].poi)];
+            QVERIFY(qAbs(neighbors[size_t(i)].distance - distance(lat, lon, poi.latitude, poi.longitude)) < 1e-6);
+            QVERIFY2(qAbs(neighbors[size_t(i)].distance - expected[size_t(i)]) < 1e-6,
+                     qPrintable(QString("query %1: %2 m, expected %3 m").arg(query)
+                                .arg(neighbors[size_t(i)].distance).arg(expected[size_t(i)])));
+        }
+    }
+
+    index.nearest(0, 0, 0, &neighbors);
+    QVERIFY(neighbors.empty());
+    GeofenceIndex empty;
+    empty.build();
+    empty.nearest(0, 0, k, &neighbors);
+    QVERIFY(neighbors.empty());
+}
+
+// Points on an edge belong to the fence on its south or west side, so fences
+// that share edges cover the plane without gaps or overlaps
+void TestTinyGPS::geofenceContains()
+{
+    GeofenceIndex index(100);
+    for (qint32 row = 0; row < 2; ++row) {
+        for (qint32 column = 0; column < 2; ++column) {
+            const qint32 lat = row * 100, lon = column * 100;
+            QCOMPARE(index.addFence(row * 2 + column, QString(),
+                                    {lat, lon, lat, lon + 100, lat + 100, lon + 100, lat + 100, lon}),
+                     int(row * 2 + column));
+        }
+    }
+    // a U open to the north: its notch is outside, its arms inside
+    const int u = index.addFence(4, "u", {1000, 1000, 1000, 1300, 1300, 1300, 1300, 1200,
+                                          1100, 1200, 1100, 1100, 1300, 1100, 1300, 1000});
+    // a diamond, whose left and right vertices lie on the rays of points
+    // level with them
+    const int diamond = index.addFence(5, "diamond", {2000, 2100, 2100, 2200, 2000, 2300, 1900, 2200});
+    const int around = index.addFence(6, "around u", {900, 900, 900, 1400, 1400, 1400, 1400, 900});
+    QCOMPARE(index.addFence(7, "line", {0, 0, 100, 100}), -1);
+    QCOMPARE(index.addFence(7, "odd", {0, 0, 100, 100, 0}), -1);
+    index.build();
+    QCOMPARE(index.fenceCount(), 7);
+    QCOMPARE(index.fenceName(u), QString("u"));
+    QCOMPARE(index.fenceId(diamond), 5);
+
+    std::vector<int> fences;
+    for (qint32 lat = 0; lat <= 200; lat += 50) {
+        for (qint32 lon = 0; lon <= 200; lon += 50) {
+            index.containing(lat, lon, &fences);
+            if (lat == 200 || lon == 200) {
+                QVERIFY(fences.empty());
+            } else {
+                QCOMPARE(int(fences.size()), 1);
+                QCOMPARE(fences[0], int(lat / 100 * 2 + lon / 100));
+            }
+        }
+    }
+
+    QVERIFY(index.contains(u, 1050, 1150));
+    QVERIFY(index.contains(u, 1200, 1050));
+    QVERIFY(index.contains(u, 1200, 1250));
+    QVERIFY(!index.contains(u, 1200, 1150));
+    QVERIFY(!index.contains(u, 1300, 1050));
+
+    QVERIFY(index.contains(diamond, 2000, 2200));
+    QVERIFY(index.contains(diamond, 2000, 2100));
+    QVERIFY(!index.contains(diamond, 2000, 2050));
+    QVERIFY(!index.contains(diamond, 2000, 2300));
+    QVERIFY(!index.contains(diamond, 2000, 2350));
+    QVERIFY(!index.contains(diamond, 2100, 2200));
+
+    // overlapping fences come back in ascending order
+    index.containing(1200, 1050, &fences);
+    QCOMPARE(fences, std::vector<int>({u, around}));
+    index.containing(1200, 1150, &fences);
+    QCOMPARE(fences, std::vector<int>({around}));
+
+    // most of the world, where the cross products need all 64 bits
+    GeofenceIndex world(10000000);
+    QCOMPARE(world.addFence(1, "world", {-89000000, -179000000, -89000000, 179000000,
+                                         89000000, 179000000, 89000000, -179000000}), 0);
+    world.build();
+    QVERIFY(world.contains(0, 0, 0));
+    QVERIFY(world.contains(0, -89000000, -179000000));
+    QVERIFY(world.contains(0, 88999999, 178999999));
+    QVERIFY(!world.contains(0, 89000000, 0));
+    QVERIFY(!world.contains(0, 0, 179500000));
+    world.containing(-45000000, 90000000, &fences);
+    QCOMPARE(fences, std::vector<int>({0}));
+}
+
+void TestTinyGPS::geofenceLoad()
+{
+    QTemporaryDir dir;
+    QFile file(dir.filePath("fences.txt"));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("# depots\n"
+               "fence 7 north depot   # inline comment\n"
+               "  48.1  11.5\n"
+               "48.1 11.6\n"
+               "48.2\t11.6\n"
+               "end\n"
+               "\n"
+               "poi 3 48.1500001 11.55 gate two\n"
+               "poi -4 -33.8688 151.2093 sydney\n");
+    file.close();
+
+    GeofenceIndex index;
+    QString error;
+    QVERIFY2(index.load(file.fileName(), &error), qPrintable(error));
+    QCOMPARE(index.fenceCount(), 1);
+    QCOMPARE(index.fenceId(0), 7);
+    QCOMPARE(index.fenceName(0), QString("north depot"));
+    QVERIFY(index.contains(0, 48150000, 11590000));
+    QVERIFY(!index.contains(0, 48150000, 11510000));
+    QCOMPARE(int(index.pois().size()), 2);
+    QCOMPARE(index.pois()[0].id, 3);
+    QCOMPARE(index.pois()[0].latitude, 48150000);
+    QCOMPARE(index.pois()[0].longitude, 11550000);
+    QCOMPARE(index.pois()[0].name, QString("gate two"));
+    QCOMPARE(index.pois()[1].id, -4);
+    QCOMPARE(index.pois()[1].latitude, -33868800);
+    QCOMPARE(index.pois()[1].longitude, 151209300);
+
+    // built by load(): queries work straight away
+    std::vector<GeofenceIndex::Neighbor> neighbors;
+    index.nearest(48150000, 11550000, 1, &neighbors);
+    QCOMPARE(int(neighbors.size()), 1);
+    QCOMPARE(neighbors[0].poi, 0);
+
+    struct Broken {
+        const char *text;
+        const char *error;
+    };
+    const Broken broken[] = {
+        {"poi 1 48.1 11.5 a\npoi x 48.1 11.5 b\n", ":2: invalid line \"poi x 48.1 11.5 b\""},
+        {"poi 1 48.1\n", ":1:"},
+        {"fence 1 a\n48.1 11.5\n48.1 east\n", ":3:"},
+        {"fence 1 a\n48.1 11.5 0\n", ":2:"},
+        {"fence 1 a\n48.1 11.5\n48.2 11.5\nend\n", ":4:"},     // two vertices
+        {"fence 1 a\n48.1 11.5\n48.1 11.6\n48.2 11.6\n", "fence 1 has no \"end\""},
+        {"end\n", ":1:"},
+        {"circle 1 48.1 11.5 100\n", ":1:"},
+    };
+    for (const Broken &b : broken) {
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text));
+        file.write(b.text);
+        file.close();
+        GeofenceIndex failed;
+        QVERIFY2(!failed.load(file.fileName(), &error), b.text);
+        QVERIFY2(error.startsWith(file.fileName()) && error.contains(b.error), qPrintable(error));
+    }
+
+    QVERIFY(!index.load(dir.filePath("missing.txt"), &error));
+    QVERIFY(!error.isEmpty());
+}
+
+std::vector<GpsFix> TestTinyGPS::trackFixes()
+{
+    std::vector<GpsFix> fixes;
+    std::mt19937 random(4096);
+    GpsFix fix = {};
+    fix.sentence_type = TinyGPS::GPS_SENTENCE_GGA;
+    fix.latitude = -33868800;
+    fix.longitude = 151209300;
+    fix.epoch_ms = 1704067190000;
+    for (int i = 0; i < 10000; ++i) {
+        fix.date = 10124 + quint32(i / 5000) * 10000;
+        fix.time = quint32(i);
+        fix.latitude += int(random() % 2001) - 1000;
+        fix.longitude += int(random() % 2001) - 1000;
+        fix.altitude = int(random() % 200000) - 50000;
+        fix.speed = random() % 100000;
+        fix.course = random() % 36000;
+        fix.hdop = i < 6000 ? 90 : random() % 5000;
+        fix.satellites = quint8(random() % 40);
+        fix.valid = quint8(random());
+        fix.epoch_ms += 100;
+        fixes.push_back(fix);
+    }
+    return fixes;
+}
+
+qint64 TestTinyGPS::trackColumn(const GpsFix &fix, int column)
+{
+    switch (column) {
+    case Track::Date: return fix.date;
+    case Track::Time: return fix.time;
+    case Track::Latitude: return fix.latitude;
+    case Track::Longitude: return fix.longitude;
+    case Track::Altitude: return fix.altitude;
+    case Track::Speed: return fix.speed;
+    case Track::Course: return fix.course;
+    case Track::Hdop: return fix.hdop;
+    case Track::Satellites: return fix.satellites;
+    case Track::Valid: return fix.valid;
+    case Track::Epoch: return fix.epoch_ms;
+    }
+    return 0;
+}
+
+void TestTinyGPS::appendLittleEndian(QByteArray *out, quint64 value, int size)
+{
+    for (int i = 0; i < size; ++i)
+        out->append(char(value >> 8 * i));
+}
+
+void TestTinyGPS::patchLittleEndian(QByteArray *data, int at, quint64 value, int size)
+{
+    for (int i = 0; i < size; ++i)
+        (*data)[at + i] = char(value >> 8 * i);
+}
+
+// What the writer stores the reader gives back, all of it or column by column
+void TestTinyGPS::trackFormat()
+{
+    const std::vector<GpsFix> fixes = trackFixes();
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("track.gpst");
+    {
+        TrackWriter writer(fileName, 4096);
+        QVERIFY(writer.open());
+        for (const GpsFix &fix : fixes)
+            writer.append(fix);
+        QCOMPARE(writer.rows(), quint64(fixes.size()));
+        QVERIFY(writer.close());
+        QVERIFY(!writer.close());
+    }
+
+    TrackReader reader(fileName);
+    QString error;
+    QVERIFY2(reader.open(&error), qPrintable(error));
+
+    // the index finds a block by its first and last times without reading it
+    const std::vector<Track::BlockInfo> &blocks = reader.blocks();
+    QCOMPARE(int(blocks.size()), 3);
+    size_t first = 0;
+    for (size_t block = 0; block < blocks.size(); ++block) {
+        QCOMPARE(blocks[block].rows, quint32(block < 2 ? 4096 : fixes.size() - 2 * 4096));
+        QVERIFY(block ? blocks[block].offset > blocks[block - 1].offset : blocks[block].offset == 8);
+        const size_t last = first + blocks[block].rows - 1;
+        QCOMPARE(blocks[block].firstDate, fixes[first].date);
+        QCOMPARE(blocks[block].firstTime, fixes[first].time);
+        QCOMPARE(blocks[block].lastDate, fixes[last].date);
+        QCOMPARE(blocks[block].lastTime, fixes[last].time);
+        first = last + 1;
+    }
+
+    std::vector<GpsFix> read;
+    QVERIFY(reader.readAll(Track::AllColumns, &read));
+    QCOMPARE(read.size(), fixes.size());
+    for (size_t row = 0; row < fixes.size(); ++row) {
+        for (int column = 0; column < Track::ColumnCount; ++column)
+            QCOMPARE(trackColumn(read[row], column), trackColumn(fixes[row], column));
+        QCOMPARE(int(read[row].sentence_type), 0);
+    }
+
+    // a mask decodes its columns and leaves the others zero
+    for (int column = 0; column < Track::ColumnCount; ++column) {
+        read.clear();
+        QVERIFY(reader.readBlock(1, 1u << column, &read));
+        QCOMPARE(read.size(), size_t(4096));
+        for (size_t row = 0; row < read.size(); ++row) {
+            for (int other = 0; other < Track::ColumnCount; ++other)
+                QCOMPARE(trackColumn(read[row], other), other == column ? trackColumn(fixes[4096 + row], column) : 0);
+        }
+    }
+
+    // blocks are appended in any order
+    read.clear();
+    QVERIFY(reader.readBlock(2, Track::TimeColumn | Track::EpochColumn, &read));
+    QVERIFY(reader.readBlock(0, Track::TimeColumn | Track::EpochColumn, &read));
+    QCOMPARE(read.size(), fixes.size() - 4096);
+    QCOMPARE(read.front().time, fixes[2 * 4096].time);
+    QCOMPARE(read[fixes.size() - 2 * 4096].epoch_ms, fixes[0].epoch_ms);
+    QVERIFY(!reader.readBlock(3, Track::AllColumns, &read));
+    QVERIFY(!reader.readBlock(-1, Track::AllColumns, &read));
+    reader.close();
+    QVERIFY(reader.blocks().empty());
+
+    // only position reports become rows
+    GpsFix fix = fixes[0];
+    fix.valid = GpsFix::VALID_POSITION | GpsFix::VALID_TIME;
+    QVERIFY(TrackWriter::records(fix));
+    for (quint8 type : {TinyGPS::GPS_SENTENCE_RMC, TinyGPS::GPS_SENTENCE_GLL, TinyGPS::GPS_SENTENCE_UBX_PVT}) {
+        fix.sentence_type = type;
+        QVERIFY(TrackWriter::records(fix));
+    }
+    for (quint8 type : {TinyGPS::GPS_SENTENCE_GSA, TinyGPS::GPS_SENTENCE_GSV, TinyGPS::GPS_SENTENCE_VTG,
+                        TinyGPS::GPS_SENTENCE_ZDA, TinyGPS::GPS_SENTENCE_UBX_SAT}) {
+        fix.sentence_type = type;
+        QVERIFY(!TrackWriter::records(fix));
+    }
+    fix.sentence_type = TinyGPS::GPS_SENTENCE_GGA;
+    fix.valid = GpsFix::VALID_TIME;
+    QVERIFY(!TrackWriter::records(fix));
+}
+
+// Cut short or with a bad length, a file is refused, not misread
+void TestTinyGPS::trackFormatDamaged()
+{
+    const std::vector<GpsFix> fixes = trackFixes();
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath("track.gpst");
+    TrackWriter writer(fileName, 4096);
+    QVERIFY(writer.open());
+    for (const GpsFix &fix : fixes)
+        writer.append(fix);
+    QVERIFY(writer.close());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray bytes = file.readAll();
+    file.close();
+
+    const QString damagedName = dir.filePath("damaged.gpst");
+    auto damage = [&](const QByteArray &data) {
+        QFile damaged(damagedName);
+        return damaged.open(QIODevice::WriteOnly | QIODevice::Truncate) && damaged.write(data) == data.size();
+    };
+    QString error;
+
+    for (int size : {0, 6, 8, 9, bytes.size() / 2, bytes.size() - 16, bytes.size() - 4, bytes.size() - 1}) {
+        QVERIFY(damage(bytes.left(size)));
+        TrackReader reader(damagedName);
+        QVERIFY2(!reader.open(&error), qPrintable(QString::number(size)));
+        QVERIFY2(error.contains(size < 8 ? "not a track file" : "truncated"), qPrintable(error));
+    }
+
+    // header: another version, or a column count that does not match it
+    QByteArray data = bytes;
+    patchLittleEndian(&data, 4, 3, 2);
+    QVERIFY(damage(data));
+    QVERIFY(!TrackReader(damagedName).open(&error));
+    QVERIFY(error.contains("not a track file"));
+    data = bytes;
+    patchLittleEndian(&data, 6, Track::Epoch, 2);
+    QVERIFY(damage(data));
+    QVERIFY(!TrackReader(damagedName).open(&error));
+    QVERIFY(error.contains("not a track file"));
+
+    // footer: more blocks than the index holds
+    data = bytes;
+    patchLittleEndian(&data, data.size() - 8, 1000, 4);
+    QVERIFY(damage(data));
+    QVERIFY(!TrackReader(damagedName).open(&error));
+    QVERIFY(error.contains("truncated block index"));
+
+    // block 0's Latitude column claims to run past the end of the file: the
+    // columns before it still read, the ones from it on fail; so does a
+    // Date column too short for its rows
+    data = bytes;
+    patchLittleEndian(&data, 8 + 4 * (1 + Track::Latitude), 0x7FFFFFFF, 4);
+    QVERIFY(damage(data));
+    {
+        TrackReader reader(damagedName);
+        QVERIFY(reader.open());
+        std::vector<GpsFix> read;
+        QVERIFY(reader.readBlock(0, Track::DateColumn | Track::TimeColumn, &read));
+        QVERIFY(!reader.readBlock(0, Track::LatitudeColumn, &read));
+        QVERIFY(!reader.readBlock(0, Track::LongitudeColumn, &read));
+        QCOMPARE(read.size(), size_t(4096));
+        QCOMPARE(read.back().time, fixes[4095].time);
+        read.clear();
+        QVERIFY(reader.readBlock(1, Track::AllColumns, &read));
+        QCOMPARE(read.back().latitude, fixes[2 * 4096 - 1].latitude);
+        QVERIFY(!reader.readAll(Track::AllColumns, &read));
+    }
+    data = bytes;
+    patchLittleEndian(&data, 8 + 4 * (1 + Track::Date), 1, 4);
+    QVERIFY(damage(data));
+    {
+        TrackReader reader(damagedName);
+        QVERIFY(reader.open());
+        std::vector<GpsFix> read;
+        QVERIFY(!reader.readBlock(0, Track::DateColumn, &read));
+        QVERIFY(read.empty());
+    }
+
+    // block 0's row count, damaged alike in the index and its header: more
+    // rows than bytes are left is refused by open(), not allocated for
+    const int indexOffset = int(qFromLittleEndian<quint64>(bytes.constData() + bytes.size() - 16));
+    data = bytes;
+    patchLittleEndian(&data, 8, 0x10000000, 4);
+    patchLittleEndian(&data, indexOffset + 8, 0x10000000, 4);
+    QVERIFY(damage(data));
+    {
+        TrackReader reader(damagedName);
+        bool opened = true;
+        bool readAll = true;
+        std::vector<GpsFix> read;
+        try {
+            opened = reader.open(&error);
+            readAll = reader.readAll(Track::AllColumns, &read);
+        } catch (...) {
+            QFAIL("damaged row count threw");
+        }
+        QVERIFY(!opened);
+        QVERIFY(!readAll);
+        QVERIFY2(error.contains("corrupt block index"), qPrintable(error));
+        QVERIFY(reader.blocks().empty());
+        QVERIFY(read.empty());
+    }
+
+    // block 1 (index entries are 28 bytes) starting inside the header or past
+    // the index
+    for (quint64 offset : {quint64(4), quint64(indexOffset), quint64(bytes.size()) + 4096}) {
+        data = bytes;
+        patchLittleEndian(&data, indexOffset + 28, offset, 8);
+        QVERIFY(damage(data));
+        QVERIFY(!TrackReader(damagedName).open(&error));
+        QVERIFY2(error.contains("corrupt block index"), qPrintable(error));
+    }
+
+    // a row count within bounds but past the end of the columns opens, and
+    // fails when its block is read
+    data = bytes;
+    patchLittleEndian(&data, 8, 4096 + 100, 4);
+    patchLittleEndian(&data, indexOffset + 8, 4096 + 100, 4);
+    QVERIFY(damage(data));
+    {
+        TrackReader reader(damagedName);
+        QVERIFY(reader.open());
+        std::vector<GpsFix> read;
+        QVERIFY(!reader.readAll(Track::AllColumns, &read));
+        QVERIFY(read.empty());
+    }
+
+    QVERIFY(!TrackReader(dir.filePath("missing.gpst")).open(&error));
+    QVERIFY(!error.isEmpty());
+}
+
+// Version 1 files have no Epoch column; a hand-made one reads with epoch 0
+void TestTinyGPS::trackFormatVersion1()
+{
+    const std::vector<GpsFix> fixes = trackFixes();
+    const int rows = 3;
+
+    auto varint = [](QByteArray *out, qint64 value) {
+        quint64 zigzag = (quint64(value) << 1) ^ quint64(value >> 63);
+        for (; zigzag >= 0x80; zigzag >>= 7)
+            out->append(char(zigzag | 0x80));
+        out->append(char(zigzag));
+    };
+    QByteArray columns[Track::Epoch];
+    for (int column = 0; column < Track::Epoch; ++column) {
+        qint64 previous = 0;
+        for (int row = 0; row < rows; ++row) {
+            varint(&columns[column], trackColumn(fixes[size_t(row)], column) - previous);
+            previous = trackColumn(fixes[size_t(row)], column);
+        }
+    }
+
+    QByteArray file("GPST");
+    appendLittleEndian(&file, 1, 2);
+    appendLittleEndian(&file, Track::Epoch, 2);
+    appendLittleEndian(&file, rows, 4);
+    for (const QByteArray &column : columns)
+        appendLittleEndian(&file, quint64(column.size()), 4);
+    for (const QByteArray &column : columns)
+        file += column;
+    const quint64 indexOffset = quint64(file.size());
+    appendLittleEndian(&file, 8, 8);
+    appendLittleEndian(&file, rows, 4);
+    appendLittleEndian(&file, fixes[0].date, 4);
+    appendLittleEndian(&file, fixes[0].time, 4);
+    appendLittleEndian(&file, fixes[rows - 1].date, 4);
+    appendLittleEndian(&file, fixes[rows - 1].time, 4);
+    appendLittleEndian(&file, indexOffset, 8);
+    appendLittleEndian(&file, 1, 4);
+    file += "GPSI";
+
+    QTemporaryDir dir;
+    QFile out(dir.filePath("version1.gpst"));
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    QCOMPARE(out.write(file), qint64(file.size()));
+    out.close();
+
+    TrackReader reader(out.fileName());
+    QString error;
+    QVERIFY2(reader.open(&error), qPrintable(error));
+    QCOMPARE(int(reader.blocks().size()), 1);
+    QCOMPARE(reader.blocks()[0].lastTime, fixes[rows - 1].time);
+    std::vector<GpsFix> read;
+    QVERIFY(reader.readAll(Track::AllColumns, &read));
+    QCOMPARE(int(read.size()), rows);
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < Track::Epoch; ++column)
+            QCOMPARE(trackColumn(read[size_t(row)], column), trackColumn(fixes[size_t(row)], column));
+        QCOMPARE(read[size_t(row)].epoch_ms, qint64(0));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestTinyGPS)
+
+#include "tst_tinygps.moc"
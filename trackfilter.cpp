@@ -0,0 +1,235 @@
+#include "trackfilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "basictinygps.h"
+
+namespace {
+
+const double DegToRad = 0.017453292519943295;
+const double RadToDeg = 57.295779513082321;
+const double Wgs84A = 6378137.0;
+const double Wgs84E2 = 6.69437999014e-3;
+const double MinCosLatitude = 1e-6;
+const quint32 NoTime = 0xFFFFFFFF;
+
+// the local frame is moved along with the track, so the flat-earth scale
+// factors stay accurate to well under a millimeter per meter
+const double RecenterDistance = 5000.0;
+
+// variance of a velocity nothing is known about yet, (50 m/s)^2
+const double UnknownVelocityVariance = 2500.0;
+
+void set_scale(TrackFilter::State *state)
+{
+    double s = std::sin(state->origin_latitude * DegToRad);
+    double w = 1.0 - Wgs84E2 * s * s;
+    double meridian = Wgs84A * (1.0 - Wgs84E2) / (w * std::sqrt(w));
+    double normal = Wgs84A / std::sqrt(w);
+    state->meters_per_degree_lat = meridian * DegToRad;
+    state->meters_per_degree_long = normal * std::max(std::cos(state->origin_latitude * DegToRad), MinCosLatitude) * DegToRad;
+}
+
+// longitude difference in (-180, 180]
+double delta_longitude(double a, double b)
+{
+    double delta = a - b;
+    if (delta > 180.0)
+        delta -= 360.0;
+    else if (delta <= -180.0)
+        delta += 360.0;
+    return delta;
+}
+
+double wrap_longitude(double longitude)
+{
+    return longitude > 180.0 ? longitude - 360.0 : longitude <= -180.0 ? longitude + 360.0 : longitude;
+}
+
+// Kalman measurement updates of one axis, x = (position, velocity)
+void measure_position(double *x, double *p, double z, double r)
+{
+    double s = p[0] + r;
+    double k0 = p[0] / s, k1 = p[1] / s;
+    double y = z - x[0];
+    x[0] += k0 * y;
+    x[1] += k1 * y;
+    double p0 = p[0], p1 = p[1];
+    p[0] = p0 - k0 * p0;
+    p[1] = p1 - k0 * p1;
+    p[2] = p[2] - k1 * p1;
+}
+
+void measure_velocity(double *x, double *p, double z, double r)
+{
+    double s = p[2] + r;
+    double k0 = p[1] / s, k1 = p[2] / s;
+    double y = z - x[1];
+    x[0] += k0 * y;
+    x[1] += k1 * y;
+    double p1 = p[1], p2 = p[2];
+    p[0] = p[0] - k0 * p1;
+    p[1] = p1 - k0 * p2;
+    p[2] = p2 - k1 * p2;
+}
+
+// position variance of one axis dt seconds ahead
+double predicted_variance(const double *p, double dt, double q)
+{
+    double dt2 = dt * dt;
+    return p[0] + 2.0 * dt * p[1] + dt2 * p[2] + q * dt2 * dt2 / 4.0;
+}
+
+} // namespace
+
+TrackFilter::TrackFilter()
+{
+    m_config.acceleration_noise = 1.0;
+    m_config.position_noise = 5.0;
+    m_config.velocity_noise = 0.3;
+    m_config.course_noise = 2.0;
+    m_config.reset_gap = 10.0;
+}
+
+TrackFilter::TrackFilter(const Config &config)
+    : m_config(config)
+{
+}
+
+void TrackFilter::update(State *state, const GpsFix &fix, quint64 now_ns) const
+{
+    const quint8 type = fix.sentence_type;
+    const quint32 time = fix.has(GpsFix::VALID_TIME) ? fix.time : NoTime;
+
+    // GGA and RMC of one epoch carry the same position, RMC and VTG the same
+    // velocity; NAV-PVT carries both
+    bool position = (type == TinyGPSBase::GPS_SENTENCE_GGA || type == TinyGPSBase::GPS_SENTENCE_RMC
+                     || type == TinyGPSBase::GPS_SENTENCE_GLL || type == TinyGPSBase::GPS_SENTENCE_UBX_PVT)
+            && fix.has(GpsFix::VALID_POSITION);
+    bool velocity = (type == TinyGPSBase::GPS_SENTENCE_RMC || type == TinyGPSBase::GPS_SENTENCE_VTG
+                     || type == TinyGPSBase::GPS_SENTENCE_UBX_PVT)
+            && fix.has(GpsFix::VALID_SPEED | GpsFix::VALID_COURSE);
+
+    if (state->initialized && time != NoTime) {
+        if (time == state->position_time)
+            position = false;
+        if (time == state->velocity_time)
+            velocity = false;
+    }
+    if (!position && !velocity)
+        return;
+
+    const double latitude = fix.latitude / 1000000.0;
+    const double longitude = fix.longitude / 1000000.0;
+    const double hdop = fix.has(GpsFix::VALID_HDOP) ? std::max(fix.hdop / 100.0, 0.5) : 2.0;
+    const double sigma = m_config.position_noise * hdop;
+
+    double dt = state->initialized && now_ns > state->time_ns ? (now_ns - state->time_ns) / 1e9 : 0.0;
+    if (!state->initialized || dt > m_config.reset_gap) {
+        // a velocity alone cannot place the track
+        if (!position)
+            return;
+        start(state, latitude, longitude, sigma * sigma, now_ns);
+        state->position_time = time;
+        position = false;
+    } else {
+        advance(state, dt);
+        if (now_ns > state->time_ns)
+            state->time_ns = now_ns;
+    }
+
+    if (position) {
+        double r = sigma * sigma;
+        measure_position(state->east, state->east_cov,
+                         delta_longitude(longitude, state->origin_longitude) * state->meters_per_degree_long, r);
+        measure_position(state->north, state->north_cov,
+                         (latitude - state->origin_latitude) * state->meters_per_degree_lat, r);
+        state->position_time = time;
+    }
+
+    if (velocity) {
+        double speed = fix.speed / 100.0 * GPS_MPS_PER_KNOT;
+        double course = fix.course / 100.0 * DegToRad;
+        // the course error shows across the track, more so the faster we go
+        double cross = speed * m_config.course_noise * DegToRad;
+        double r = m_config.velocity_noise * m_config.velocity_noise + cross * cross;
+        measure_velocity(state->east, state->east_cov, speed * std::sin(course), r);
+        measure_velocity(state->north, state->north_cov, speed * std::cos(course), r);
+        state->velocity_time = time;
+    }
+
+    if (std::fabs(state->east[0]) > RecenterDistance || std::fabs(state->north[0]) > RecenterDistance)
+        recenter(state);
+}
+
+bool TrackFilter::predict(const State &state, quint64 at_ns, Estimate *estimate) const
+{
+    // a time before the state's, from a clock read just before the last
+    // update landed, is taken as the state's own
+    double dt = at_ns > state.time_ns ? (at_ns - state.time_ns) / 1e9 : 0.0;
+    if (!state.initialized || dt > m_config.reset_gap) {
+        *estimate = Estimate();
+        return false;
+    }
+
+    const double q = m_config.acceleration_noise * m_config.acceleration_noise;
+    double east = state.east[0] + state.east[1] * dt;
+    double north = state.north[0] + state.north[1] * dt;
+
+    estimate->latitude = state.origin_latitude + north / state.meters_per_degree_lat;
+    estimate->longitude = wrap_longitude(state.origin_longitude + east / state.meters_per_degree_long);
+    estimate->speed = std::hypot(state.east[1], state.north[1]);
+    double course = std::atan2(state.east[1], state.north[1]) * RadToDeg;
+    estimate->course = course < 0 ? course + 360.0 : course;
+    estimate->position_error = std::sqrt(predicted_variance(state.east_cov, dt, q)
+                                         + predicted_variance(state.north_cov, dt, q));
+    estimate->age = dt;
+    estimate->valid = true;
+    return true;
+}
+
+void TrackFilter::predict(const State *states, size_t count, quint64 at_ns, Estimate *estimates) const
+{
+    for (size_t i = 0; i < count; ++i)
+        predict(states[i], at_ns, &estimates[i]);
+}
+
+void TrackFilter::start(State *state, double latitude, double longitude, double variance, quint64 now_ns)
+{
+    *state = State();
+    state->origin_latitude = latitude;
+    state->origin_longitude = longitude;
+    set_scale(state);
+    state->east_cov[0] = state->north_cov[0] = variance;
+    state->east_cov[2] = state->north_cov[2] = UnknownVelocityVariance;
+    state->time_ns = now_ns;
+    state->position_time = state->velocity_time = NoTime;
+    state->initialized = true;
+}
+
+// Constant-velocity prediction with white acceleration noise
+void TrackFilter::advance(State *state, double dt) const
+{
+    if (dt <= 0)
+        return;
+    const double q = m_config.acceleration_noise * m_config.acceleration_noise;
+    const double dt2 = dt * dt;
+    for (int axis = 0; axis < 2; ++axis) {
+        double *x = axis ? state->north : state->east;
+        double *p = axis ? state->north_cov : state->east_cov;
+        x[0] += x[1] * dt;
+        p[0] += 2.0 * dt * p[1] + dt2 * p[2] + q * dt2 * dt2 / 4.0;
+        p[1] += dt * p[2] + q * dt2 * dt / 2.0;
+        p[2] += q * dt2;
+    }
+}
+
+// Moves the origin under the track; velocities and covariances carry over
+void TrackFilter::recenter(State *state)
+{
+    state->origin_latitude += state->north[0] / state->meters_per_degree_lat;
+    state->origin_longitude = wrap_longitude(state->origin_longitude + state->east[0] / state->meters_per_degree_long);
+    state->east[0] = state->north[0] = 0.0;
+    set_scale(state);
+}
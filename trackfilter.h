@@ -0,0 +1,86 @@
+#ifndef TRACKFILTER_H
+#define TRACKFILTER_H
+
+#include <cstddef>
+
+#include "gpsfix.h"
+
+// Smooths the fixes of a receiver and dead-reckons between them.
+//
+// The track is kept in meters east and north of a local origin near it, each
+// axis an independent constant-velocity Kalman filter (position, velocity)
+// driven by white acceleration noise. Positions from GGA, RMC and GLL and
+// velocities from RMC and VTG are the measurements, each taken once per
+// receiver epoch; HDOP scales the position noise. predict() extrapolates a
+// state to any time without changing it, so consumers can poll far faster
+// than the receiver reports.
+//
+// State is a fixed-size trivially copyable value, one per track: updates and
+// predictions are constant time, never allocate, and a state can be handed
+// between threads through a SeqLock. The filter itself only holds the tuning
+// and can be shared by any number of tracks.
+class TrackFilter
+{
+public:
+    struct Config {
+        double acceleration_noise;  // m/s^2, 1 sigma of unmodelled acceleration
+        double position_noise;      // m, 1 sigma of a position at HDOP 1
+        double velocity_noise;      // m/s, 1 sigma of a speed
+        double course_noise;        // degrees, 1 sigma of a course
+        double reset_gap;           // s without measurements after which a track restarts
+    };
+
+    struct State {
+        double origin_latitude;     // degrees
+        double origin_longitude;
+        double meters_per_degree_lat;
+        double meters_per_degree_long;
+        double east[2];             // m and m/s from the origin
+        double north[2];
+        double east_cov[3];         // covariance of (position, velocity): pp, pv, vv
+        double north_cov[3];
+        quint64 time_ns;            // the state's time, gps_clock_ns() of the last measurement
+        quint32 position_time;      // receiver time (hhmmsscc) of the last measurement
+        quint32 velocity_time;
+        bool initialized;
+    };
+
+    struct Estimate {
+        double latitude;            // degrees
+        double longitude;
+        double speed;               // m/s
+        double course;              // degrees, North=0, East=90
+        double position_error;      // m, 1 sigma, horizontal
+        double age;                 // s since the last measurement
+        bool valid;                 // false for tracks without a recent measurement
+    };
+
+    // 1 m/s^2, 5 m, 0.3 m/s, 2 degrees and 10 s suit road vehicles
+    TrackFilter();
+    explicit TrackFilter(const Config &config);
+
+    const Config &config() const { return m_config; }
+
+    // an empty track
+    static State initial_state() { return State(); }
+
+    // feeds one published fix observed at now_ns; fixes of other sentence
+    // types, or repeating an epoch already measured, leave the state as is
+    void update(State *state, const GpsFix &fix, quint64 now_ns) const;
+
+    // the state extrapolated to at_ns; false if the track has no measurement
+    // younger than the reset gap
+    bool predict(const State &state, quint64 at_ns, Estimate *estimate) const;
+
+    // predict() for many tracks at once
+    void predict(const State *states, size_t count, quint64 at_ns, Estimate *estimates) const;
+
+private:
+    static void start(State *state, double latitude, double longitude, double variance, quint64 now_ns);
+    void advance(State *state, double dt) const;
+    static void recenter(State *state);
+
+    Config m_config;
+};
+
+#endif // TRACKFILTER_H
@@ -0,0 +1,349 @@
+#include "trackformat.h"
+
+#include <QtEndian>
+
+#include "tinygps.h"
+
+using namespace Track;
+
+namespace {
+
+const char HeaderMagic[4] = {'G', 'P', 'S', 'T'};
+const char FooterMagic[4] = {'G', 'P', 'S', 'I'};
+const quint16 FormatVersion = 2;
+const int Version1ColumnCount = Epoch;
+const int HeaderSize = 8;
+const int FooterSize = 16;
+const int IndexEntrySize = 28;
+
+template <typename T>
+void put(QByteArray &out, T value)
+{
+    char bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+T get(const char *p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+void putVarint(QByteArray &out, qint64 value)
+{
+    quint64 zigzag = (quint64(value) << 1) ^ quint64(value >> 63);
+    while (zigzag >= 0x80) {
+        out.append(char(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    out.append(char(zigzag));
+}
+
+// returns nullptr on truncated input
+const char *getVarint(const char *p, const char *end, qint64 *value)
+{
+    quint64 zigzag = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        quint8 byte = quint8(*p++);
+        zigzag |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = qint64(zigzag >> 1) ^ -qint64(zigzag & 1);
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+qint64 columnValue(const GpsFix &fix, int column)
+{
+    switch (column) {
+    case Date: return fix.date;
+    case Time: return fix.time;
+    case Latitude: return fix.latitude;
+    case Longitude: return fix.longitude;
+    case Altitude: return fix.altitude;
+    case Speed: return fix.speed;
+    case Course: return fix.course;
+    case Hdop: return fix.hdop;
+    case Satellites: return fix.satellites;
+    case Valid: return fix.valid;
+    case Epoch: return fix.epoch_ms;
+    }
+    return 0;
+}
+
+void setColumnValue(GpsFix &fix, int column, qint64 value)
+{
+    switch (column) {
+    case Date: fix.date = quint32(value); break;
+    case Time: fix.time = quint32(value); break;
+    case Latitude: fix.latitude = qint32(value); break;
+    case Longitude: fix.longitude = qint32(value); break;
+    case Altitude: fix.altitude = qint32(value); break;
+    case Speed: fix.speed = quint32(value); break;
+    case Course: fix.course = quint32(value); break;
+    case Hdop: fix.hdop = quint32(value); break;
+    case Satellites: fix.satellites = quint8(value); break;
+    case Valid: fix.valid = quint8(value); break;
+    case Epoch: fix.epoch_ms = value; break;
+    }
+}
+
+} // namespace
+
+TrackWriter::TrackWriter(const QString &fileName, int blockRows)
+    : m_file(fileName)
+    , m_blockRows(blockRows > 0 ? blockRows : 4096)
+{
+    m_pending.reserve(size_t(m_blockRows));
+}
+
+TrackWriter::~TrackWriter()
+{
+    close();
+}
+
+bool TrackWriter::open(QString *error)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    QByteArray header(HeaderMagic, sizeof(HeaderMagic));
+    put<quint16>(header, FormatVersion);
+    put<quint16>(header, ColumnCount);
+    m_file.write(header);
+    return true;
+}
+
+bool TrackWriter::records(const GpsFix &fix)
+{
+    switch (fix.sentence_type) {
+    case TinyGPS::GPS_SENTENCE_GGA:
+    case TinyGPS::GPS_SENTENCE_RMC:
+    case TinyGPS::GPS_SENTENCE_GLL:
+    case TinyGPS::GPS_SENTENCE_UBX_PVT:
+        return fix.has(GpsFix::VALID_POSITION);
+    default:
+        return false;
+    }
+}
+
+void TrackWriter::append(const GpsFix &fix)
+{
+    m_pending.push_back(fix);
+    ++m_rows;
+    if (int(m_pending.size()) == m_blockRows)
+        flush();
+}
+
+bool TrackWriter::close()
+{
+    if (!m_file.isOpen())
+        return false;
+
+    flush();
+
+    QByteArray index;
+    quint64 indexOffset = quint64(m_file.pos());
+    for (const BlockInfo &block : m_index) {
+        put<quint64>(index, block.offset);
+        put<quint32>(index, block.rows);
+        put<quint32>(index, block.firstDate);
+        put<quint32>(index, block.firstTime);
+        put<quint32>(index, block.lastDate);
+        put<quint32>(index, block.lastTime);
+    }
+    put<quint64>(index, indexOffset);
+    put<quint32>(index, quint32(m_index.size()));
+    index.append(FooterMagic, sizeof(FooterMagic));
+    m_file.write(index);
+
+    bool ok = m_file.error() == QFileDevice::NoError;
+    m_file.close();
+    m_index.clear();
+    return ok;
+}
+
+// Encodes the pending rows as one block
+void TrackWriter::flush()
+{
+    if (m_pending.empty())
+        return;
+
+    for (int column = 0; column < ColumnCount; ++column) {
+        QByteArray &out = m_columns[column];
+        out.clear();
+        qint64 previous = 0;
+        for (const GpsFix &fix : m_pending) {
+            qint64 value = columnValue(fix, column);
+            putVarint(out, value - previous);
+            previous = value;
+        }
+    }
+
+    BlockInfo block;
+    block.offset = quint64(m_file.pos());
+    block.rows = quint32(m_pending.size());
+    block.firstDate = m_pending.front().date;
+    block.firstTime = m_pending.front().time;
+    block.lastDate = m_pending.back().date;
+    block.lastTime = m_pending.back().time;
+    m_index.push_back(block);
+
+    QByteArray header;
+    put<quint32>(header, block.rows);
+    for (const QByteArray &column : m_columns)
+        put<quint32>(header, quint32(column.size()));
+    m_file.write(header);
+    for (const QByteArray &column : m_columns)
+        m_file.write(column);
+
+    m_pending.clear();
+}
+
+TrackReader::TrackReader(const QString &fileName)
+    : m_file(fileName)
+{
+}
+
+bool TrackReader::open(QString *error)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        if (error) *error = m_file.errorString();
+        return false;
+    }
+
+    QByteArray header = m_file.read(HeaderSize);
+    const quint16 version = header.size() == HeaderSize ? get<quint16>(header.constData() + 4) : 0;
+    m_columnCount = version == 1 ? Version1ColumnCount : ColumnCount;
+    if (header.size() != HeaderSize || !header.startsWith(QByteArray(HeaderMagic, sizeof(HeaderMagic)))
+            || (version != 1 && version != FormatVersion)
+            || get<quint16>(header.constData() + 6) != m_columnCount) {
+        if (error) *error = QObject::tr("%1: not a track file").arg(m_file.fileName());
+        m_file.close();
+        return false;
+    }
+
+    qint64 size = m_file.size();
+    m_file.seek(size - FooterSize);
+    QByteArray footer = m_file.read(FooterSize);
+    if (footer.size() != FooterSize || !footer.endsWith(QByteArray(FooterMagic, sizeof(FooterMagic)))) {
+        if (error) *error = QObject::tr("%1: truncated track file").arg(m_file.fileName());
+        m_file.close();
+        return false;
+    }
+
+    quint64 indexOffset = get<quint64>(footer.constData());
+    quint32 blockCount = get<quint32>(footer.constData() + 8);
+    QByteArray index;
+    if (indexOffset <= quint64(size) && quint64(blockCount) * IndexEntrySize <= quint64(size) - indexOffset) {
+        m_file.seek(qint64(indexOffset));
+        index = m_file.read(qint64(blockCount) * IndexEntrySize);
+    }
+    if (quint64(index.size()) != quint64(blockCount) * IndexEntrySize) {
+        if (error) *error = QObject::tr("%1: truncated block index").arg(m_file.fileName());
+        m_file.close();
+        return false;
+    }
+
+    m_index.resize(blockCount);
+    const char *p = index.constData();
+    for (BlockInfo &block : m_index) {
+        block.offset = get<quint64>(p);
+        block.rows = get<quint32>(p + 8);
+        block.firstDate = get<quint32>(p + 12);
+        block.firstTime = get<quint32>(p + 16);
+        block.lastDate = get<quint32>(p + 20);
+        block.lastTime = get<quint32>(p + 24);
+        p += IndexEntrySize;
+
+        // blocks lie between the header and the index, and every row takes
+        // at least a byte in each column, so a larger count is damage that
+        // readBlock() must not allocate for
+        if (block.offset < quint64(HeaderSize) || block.offset >= indexOffset
+                || block.rows > indexOffset - block.offset) {
+            if (error) *error = QObject::tr("%1: corrupt block index").arg(m_file.fileName());
+            m_index.clear();
+            m_file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TrackReader::close()
+{
+    m_file.close();
+    m_index.clear();
+}
+
+bool TrackReader::readBlock(int block, quint32 mask, std::vector<GpsFix> *fixes)
+{
+    if (block < 0 || size_t(block) >= m_index.size())
+        return false;
+
+    const BlockInfo &info = m_index[size_t(block)];
+    const int headerSize = 4 * (1 + m_columnCount);
+    m_file.seek(qint64(info.offset));
+    QByteArray header = m_file.read(headerSize);
+    if (header.size() != headerSize || get<quint32>(header.constData()) != info.rows)
+        return false;
+
+    size_t first = fixes->size();
+    fixes->resize(first + info.rows, GpsFix());
+
+    const qint64 fileSize = m_file.size();
+    qint64 offset = qint64(info.offset) + headerSize;
+    for (int column = 0; column < m_columnCount; ++column) {
+        quint32 length = get<quint32>(header.constData() + 4 * (1 + column));
+        if (mask & (1u << column)) {
+            // only the requested columns are read and decoded; a length
+            // past the end of the file is damage, not something to allocate
+            QByteArray data;
+            if (offset + length <= fileSize) {
+                m_file.seek(offset);
+                data = m_file.read(length);
+            }
+            if (data.size() != int(length)) {
+                fixes->resize(first);
+                return false;
+            }
+
+            const char *p = data.constData();
+            const char *end = p + data.size();
+            qint64 value = 0;
+            for (size_t row = first; row < fixes->size(); ++row) {
+                qint64 delta;
+                p = getVarint(p, end, &delta);
+                if (!p) {
+                    fixes->resize(first);
+                    return false;
+                }
+                value += delta;
+                setColumnValue((*fixes)[row], column, value);
+            }
+        }
+        offset += length;
+    }
+    return true;
+}
+
+bool TrackReader::readAll(quint32 mask, std::vector<GpsFix> *fixes)
+{
+    if (!m_file.isOpen())
+        return false;
+
+    size_t rows = fixes->size();
+    for (const BlockInfo &block : m_index)
+        rows += block.rows;
+    fixes->reserve(rows);
+
+    for (int block = 0; block < int(m_index.size()); ++block) {
+        if (!readBlock(block, mask, fixes))
+            return false;
+    }
+    return true;
+}
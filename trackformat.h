@@ -0,0 +1,113 @@
+#ifndef TRACKFORMAT_H
+#define TRACKFORMAT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+#include "gpsfix.h"
+
+// Binary track files: GpsFix rows stored column by column in blocks.
+//
+//   header   "GPST" u16 version u16 column count
+//   block    u32 rows, u32 byte size of each column, then the columns
+//   index    per block: u64 offset, u32 rows, u32 first date, u32 first time,
+//            u32 last date, u32 last time
+//   footer   u64 index offset, u32 block count, "GPSI"
+//
+// Each column is a zigzag LEB128 varint of the first value followed by the
+// deltas of the remaining rows. All integers are little endian. Version 1
+// files, without the Epoch column, are read with epoch_ms 0.
+namespace Track {
+
+enum Column {
+    Date,
+    Time,
+    Latitude,
+    Longitude,
+    Altitude,
+    Speed,
+    Course,
+    Hdop,
+    Satellites,
+    Valid,
+    Epoch,
+    ColumnCount
+};
+
+enum ColumnMask : quint32 {
+    DateColumn = 1 << Date,
+    TimeColumn = 1 << Time,
+    LatitudeColumn = 1 << Latitude,
+    LongitudeColumn = 1 << Longitude,
+    AltitudeColumn = 1 << Altitude,
+    SpeedColumn = 1 << Speed,
+    CourseColumn = 1 << Course,
+    HdopColumn = 1 << Hdop,
+    SatellitesColumn = 1 << Satellites,
+    ValidColumn = 1 << Valid,
+    EpochColumn = 1 << Epoch,
+    AllColumns = (1 << ColumnCount) - 1
+};
+
+struct BlockInfo {
+    quint64 offset;
+    quint32 rows;
+    quint32 firstDate, firstTime;
+    quint32 lastDate, lastTime;
+};
+
+} // namespace Track
+
+class TrackWriter
+{
+public:
+    explicit TrackWriter(const QString &fileName, int blockRows = 4096);
+    ~TrackWriter();
+
+    bool open(QString *error = nullptr);
+    void append(const GpsFix &fix);
+    bool close();
+
+    quint64 rows() const { return m_rows; }
+
+    // whether fix is worth a row: a valid position from GGA, RMC, GLL or
+    // UBX-NAV-PVT; GSA, GSV, VTG and ZDA only repeat the last one
+    static bool records(const GpsFix &fix);
+
+private:
+    void flush();
+
+    QFile m_file;
+    const int m_blockRows;
+    std::vector<GpsFix> m_pending;
+    std::vector<Track::BlockInfo> m_index;
+    QByteArray m_columns[Track::ColumnCount];
+    quint64 m_rows = 0;
+};
+
+class TrackReader
+{
+public:
+    explicit TrackReader(const QString &fileName);
+
+    bool open(QString *error = nullptr);
+    void close();
+
+    const std::vector<Track::BlockInfo> &blocks() const { return m_index; }
+
+    // appends the rows of block, decoding only the columns in mask; the other
+    // fields of the rows are zero. False for a damaged block, which adds no
+    // rows.
+    bool readBlock(int block, quint32 mask, std::vector<GpsFix> *fixes);
+    bool readAll(quint32 mask, std::vector<GpsFix> *fixes);
+
+private:
+    QFile m_file;
+    int m_columnCount = Track::ColumnCount;
+    std::vector<Track::BlockInfo> m_index;
+};
+
+#endif // TRACKFORMAT_H